@@ -0,0 +1,226 @@
+#include "anomaly_detector.h"
+
+#include <QSqlQuery>
+#include <QReadLocker>
+#include <QWriteLocker>
+#include <QDebug>
+#include <cmath>
+
+// 偏离基线达到多少个标准差算异常
+static const double Z_THRESHOLD = 3.0;
+
+// 标准差至少按均值的 10% 计：金额几乎不变的分类（如固定套餐）稍有浮动不至于被标记
+static const double MIN_RELATIVE_STDDEV = 0.1;
+
+// 比均值高出不到 20 元的不标记
+static const qint64 MIN_EXCESS_CENTS = 2000;
+
+void AnomalyDetector::Moments::add(double x)
+{
+    ++count;
+    double delta = x - mean;
+    mean += delta / count;
+    m2 += delta * (x - mean);
+}
+
+void AnomalyDetector::Moments::remove(double x)
+{
+    if (count <= 1) {
+        *this = Moments();
+        return;
+    }
+    double oldMean = mean;
+    --count;
+    mean = (oldMean * (count + 1) - x) / count;
+    m2 -= (x - mean) * (x - oldMean);
+    if (m2 < 0)
+        m2 = 0;     // 反复加减后的舍入误差
+}
+
+void AnomalyDetector::Moments::merge(const Moments &other)
+{
+    if (other.count == 0)
+        return;
+    if (count == 0) {
+        *this = other;
+        return;
+    }
+    qint64 total = count + other.count;
+    double delta = other.mean - mean;
+    mean += delta * other.count / total;
+    m2 += other.m2 + delta * delta * (static_cast<double>(count) * other.count / total);
+    count = total;
+}
+
+double AnomalyDetector::Moments::stddev() const
+{
+    return count > 1 ? std::sqrt(m2 / (count - 1)) : 0;
+}
+
+AnomalyDetector::AnomalyDetector()
+{
+}
+
+bool AnomalyDetector::isLoaded() const
+{
+    QReadLocker locker(&lock);
+    return loaded;
+}
+
+void AnomalyDetector::clear()
+{
+    QWriteLocker locker(&lock);
+    categoryMoments.clear();
+    for (Moments &moments : weekdayMoments)
+        moments = Moments();
+    dailyCents.clear();
+    loaded = false;
+}
+
+void AnomalyDetector::adopt(AnomalyDetector &other)
+{
+    QWriteLocker locker(&lock);
+    QWriteLocker otherLocker(&other.lock);
+    categoryMoments.swap(other.categoryMoments);
+    dailyCents.swap(other.dailyCents);
+    for (int i = 0; i < 7; ++i) {
+        weekdayMoments[i] = other.weekdayMoments[i];
+        other.weekdayMoments[i] = Moments();
+    }
+    loaded = other.loaded;
+    other.categoryMoments.clear();
+    other.dailyCents.clear();
+    other.loaded = false;
+}
+
+// 儒略日 0 是星期一
+int AnomalyDetector::weekdayIndex(qint32 day)
+{
+    return day % 7;
+}
+
+void AnomalyDetector::load(QSqlQuery &query)
+{
+    QWriteLocker locker(&lock);
+    while (query.next()) {
+        qint32 day = query.value(0).toInt();
+        qint64 cents = query.value(2).toLongLong();
+        categoryMoments[query.value(1).toInt()].add(cents);
+        dailyCents[day] += cents;
+    }
+}
+
+// 每天的合计要等所有批次读完才确定，星期几基线最后一次算出
+void AnomalyDetector::finishLoad()
+{
+    QWriteLocker locker(&lock);
+    for (Moments &moments : weekdayMoments)
+        moments = Moments();
+    for (auto it = dailyCents.begin(); it != dailyCents.end(); ) {
+        if (it.value() <= 0) {
+            it = dailyCents.erase(it);
+            continue;
+        }
+        weekdayMoments[weekdayIndex(it.key())].add(it.value());
+        ++it;
+    }
+
+    qint64 rows = 0;
+    for (const Moments &moments : categoryMoments)
+        rows += moments.count;
+    loaded = true;
+    qDebug() << "异常检测基线加载完成，支出笔数:" << rows << "天数:" << dailyCents.size();
+}
+
+// 某天支出合计变化 cents：星期几基线撤出旧合计、加入新合计
+void AnomalyDetector::changeDay(qint32 day, qint64 cents)
+{
+    Moments &weekday = weekdayMoments[weekdayIndex(day)];
+    qint64 before = dailyCents.value(day, 0);
+    qint64 after = before + cents;
+    if (before > 0)
+        weekday.remove(before);
+    if (after > 0) {
+        weekday.add(after);
+        dailyCents.insert(day, after);
+    } else {
+        dailyCents.remove(day);
+    }
+}
+
+void AnomalyDetector::apply(const QDate &day, qint64 cents, bool income, int categoryId)
+{
+    if (income || !day.isValid() || cents == 0)
+        return;
+
+    QWriteLocker locker(&lock);
+    if (!loaded)
+        return;
+    if (cents > 0)
+        categoryMoments[categoryId].add(cents);
+    else
+        categoryMoments[categoryId].remove(-cents);
+    changeDay(static_cast<qint32>(day.toJulianDay()), cents);
+}
+
+void AnomalyDetector::accumulate(Delta *delta, const QDate &day, qint64 cents, bool income, int categoryId)
+{
+    if (income || !day.isValid() || cents <= 0)
+        return;
+    delta->categories[categoryId].add(cents);
+    delta->dayCents[static_cast<qint32>(day.toJulianDay())] += cents;
+}
+
+void AnomalyDetector::apply(const Delta &delta)
+{
+    QWriteLocker locker(&lock);
+    if (!loaded)
+        return;
+    for (auto it = delta.categories.constBegin(); it != delta.categories.constEnd(); ++it)
+        categoryMoments[it.key()].merge(it.value());
+    for (auto it = delta.dayCents.constBegin(); it != delta.dayCents.constEnd(); ++it)
+        changeDay(it.key(), it.value());
+}
+
+// baseline 按值传入：先撤出被打分的值本身，避免一笔大额拉高自己的基线
+bool AnomalyDetector::score(Moments baseline, double value, Score *result)
+{
+    baseline.remove(value);
+    result->value = value;
+    result->mean = baseline.mean;
+    result->samples = baseline.count;
+    result->stddev = baseline.stddev();
+    result->zScore = 0;
+    if (baseline.count < MIN_SAMPLES)
+        return false;
+
+    double stddev = qMax(result->stddev, baseline.mean * MIN_RELATIVE_STDDEV);
+    if (stddev <= 0)
+        return false;
+    result->zScore = (value - baseline.mean) / stddev;
+    return result->zScore >= Z_THRESHOLD && value - baseline.mean >= MIN_EXCESS_CENTS;
+}
+
+bool AnomalyDetector::scoreRecord(qint64 cents, int categoryId, Score *result) const
+{
+    QReadLocker locker(&lock);
+    return score(categoryMoments.value(categoryId), cents, result);
+}
+
+bool AnomalyDetector::scoreDay(const QDate &day, Score *result) const
+{
+    QReadLocker locker(&lock);
+    qint32 key = static_cast<qint32>(day.toJulianDay());
+    qint64 cents = dailyCents.value(key, 0);
+    if (cents <= 0) {
+        *result = Score();
+        return false;
+    }
+    return score(weekdayMoments[weekdayIndex(key)], cents, result);
+}
+
+qint64 AnomalyDetector::dayCents(const QDate &day) const
+{
+    QReadLocker locker(&lock);
+    return dailyCents.value(static_cast<qint32>(day.toJulianDay()), 0);
+}
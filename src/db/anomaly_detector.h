@@ -0,0 +1,87 @@
+#ifndef ANOMALY_DETECTOR_H
+#define ANOMALY_DETECTOR_H
+
+#include <QHash>
+#include <QDate>
+#include <QReadWriteLock>
+
+class QSqlQuery;
+
+// 支出异常检测的基线，只统计支出：
+// - 每个分类一组单笔金额的均值 / 方差，用来判断某一笔是否远高于平常；
+// - 每个星期几一组"有支出的日子"当天合计的均值 / 方差，用来判断某一天是否花得异常多。
+// 均值与方差用 Welford 算法流式维护：新增一笔加入、删除一笔撤出、修改拆成撤出加加入，
+// 批量导入先在批内累计再按 Chan 公式合并，写入只改动一个分类和一个星期几，不重新扫描历史。
+class AnomalyDetector
+{
+public:
+    // 流式均值与方差（Welford）
+    struct Moments {
+        qint64 count = 0;
+        double mean = 0;
+        double m2 = 0;          // 与均值之差的平方和
+
+        void add(double x);
+        void remove(double x);  // add 的逆运算，x 必须是之前加入过的值
+        void merge(const Moments &other);
+        double stddev() const;  // 样本标准差，少于两个样本时为 0
+    };
+
+    // 一次打分：value 相对基线偏离多少个标准差
+    struct Score {
+        double value = 0;
+        double mean = 0;
+        double stddev = 0;
+        double zScore = 0;
+        qint64 samples = 0;
+    };
+
+    // 批量导入的累计变化，事务提交成功后一次合并
+    struct Delta {
+        QHash<int, Moments> categories;     // 分类 -> 本批单笔金额
+        QHash<qint32, qint64> dayCents;     // 儒略日 -> 本批支出合计（分）
+    };
+
+    // 基线样本少于此数时不做判断
+    static const int MIN_SAMPLES = 10;
+
+    AnomalyDetector();
+
+    bool isLoaded() const;
+    void clear();   // 清空并标记为未加载，下次使用时重新加载
+
+    // 追加一批逐条支出的查询结果，列顺序：儒略日, category_id, 金额(分)；
+    // 分区较多时分批传入，全部传完后调用 finishLoad() 算出星期几基线
+    void load(QSqlQuery &query);
+    void finishLoad();
+    // 换入另一份在锁外加载好的基线，other 随后被清空
+    void adopt(AnomalyDetector &other);
+
+    // 单条写入后的增量修补：新增传正金额，删除传负金额，修改拆成一次删除加一次新增；收入忽略
+    void apply(const QDate &day, qint64 cents, bool income, int categoryId);
+
+    // 批量导入：逐条累计到 delta，提交后一次合并
+    static void accumulate(Delta *delta, const QDate &day, qint64 cents, bool income, int categoryId);
+    void apply(const Delta &delta);
+
+    // 单笔支出相对同分类其它账单的偏离（基线不含这一笔本身），超过阈值时返回 true
+    bool scoreRecord(qint64 cents, int categoryId, Score *score) const;
+    // 某天支出合计相对同一星期几其它日子的偏离，超过阈值时返回 true
+    bool scoreDay(const QDate &day, Score *score) const;
+    // 某天的支出合计（单位：分）
+    qint64 dayCents(const QDate &day) const;
+
+private:
+    static int weekdayIndex(qint32 day);
+    static bool score(Moments baseline, double value, Score *result);
+    void changeDay(qint32 day, qint64 cents);
+
+    QHash<int, Moments> categoryMoments;
+    Moments weekdayMoments[7];              // 下标 0 为星期一
+    QHash<qint32, qint64> dailyCents;       // 儒略日 -> 当天支出合计，只保存有支出的日子
+
+    bool loaded = false;
+    mutable QReadWriteLock lock;
+};
+
+#endif // ANOMALY_DETECTOR_H
@@ -0,0 +1,331 @@
+#include "bill_column_store.h"
+
+#include <QSqlQuery>
+#include <QReadLocker>
+#include <QWriteLocker>
+#include <QDebug>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+BillColumnStore::BillColumnStore()
+{
+}
+
+bool BillColumnStore::isLoaded() const
+{
+    QReadLocker locker(&lock);
+    return loaded;
+}
+
+void BillColumnStore::clear()
+{
+    QWriteLocker locker(&lock);
+    dayKey.clear();
+    cents.clear();
+    income.clear();
+    categoryId.clear();
+    counterpartyId.clear();
+    billId.clear();
+    idDay.clear();
+    loaded = false;
+}
+
+int BillColumnStore::size() const
+{
+    QReadLocker locker(&lock);
+    return dayKey.size();
+}
+
+qint64 BillColumnStore::toCents(double amount)
+{
+    return static_cast<qint64>(std::llround(amount * 100));
+}
+
+void BillColumnStore::load(QSqlQuery &query)
+{
+    QWriteLocker locker(&lock);
+    // 查询已按日期排序，这里只做顺序追加
+    while (query.next()) {
+        billId.append(query.value(0).toInt());
+        dayKey.append(static_cast<qint32>(query.value(1).toLongLong()));
+        idDay.insert(billId.last(), dayKey.last());
+        cents.append(query.value(2).toLongLong());
+        income.append(query.value(3).toInt() ? 1 : 0);
+        categoryId.append(query.value(4).toInt());
+        counterpartyId.append(query.value(5).toInt());
+    }
+}
+
+void BillColumnStore::finishLoad()
+{
+    QWriteLocker locker(&lock);
+    loaded = true;
+    qDebug() << "列式快照已加载，账单数:" << dayKey.size();
+}
+
+void BillColumnStore::adopt(BillColumnStore &other)
+{
+    QWriteLocker locker(&lock);
+    QWriteLocker otherLocker(&other.lock);
+    dayKey.swap(other.dayKey);
+    cents.swap(other.cents);
+    income.swap(other.income);
+    categoryId.swap(other.categoryId);
+    counterpartyId.swap(other.counterpartyId);
+    billId.swap(other.billId);
+    idDay.swap(other.idDay);
+    loaded = other.loaded;
+
+    other.dayKey.clear();
+    other.cents.clear();
+    other.income.clear();
+    other.categoryId.clear();
+    other.counterpartyId.clear();
+    other.billId.clear();
+    other.idDay.clear();
+    other.loaded = false;
+}
+
+void BillColumnStore::insert(int id, const QDate &day, qint64 amountCents, bool isIncome, int category, int counterparty)
+{
+    QWriteLocker locker(&lock);
+    if (!loaded || !day.isValid())
+        return;
+
+    // 插到同一天的末尾，保持按日期有序
+    qint32 key = static_cast<qint32>(day.toJulianDay());
+    int pos = std::upper_bound(dayKey.constBegin(), dayKey.constEnd(), key) - dayKey.constBegin();
+
+    dayKey.insert(pos, key);
+    cents.insert(pos, amountCents);
+    income.insert(pos, isIncome ? 1 : 0);
+    categoryId.insert(pos, category);
+    counterpartyId.insert(pos, counterparty);
+    billId.insert(pos, id);
+    idDay.insert(id, key);
+}
+
+void BillColumnStore::remove(int id)
+{
+    QWriteLocker locker(&lock);
+    if (!loaded)
+        return;
+
+    auto found = idDay.find(id);
+    if (found == idDay.end())
+        return;
+    qint32 key = found.value();
+    idDay.erase(found);
+
+    int pos = std::lower_bound(dayKey.constBegin(), dayKey.constEnd(), key) - dayKey.constBegin();
+    while (pos < dayKey.size() && dayKey[pos] == key && billId[pos] != id)
+        ++pos;
+    if (pos >= dayKey.size() || billId[pos] != id)
+        return;
+
+    dayKey.remove(pos);
+    cents.remove(pos);
+    income.remove(pos);
+    categoryId.remove(pos);
+    counterpartyId.remove(pos);
+    billId.remove(pos);
+}
+
+void BillColumnStore::dayRange(const QDate &from, const QDate &to, int *begin, int *end) const
+{
+    qint32 lo = from.isValid() ? static_cast<qint32>(from.toJulianDay()) : std::numeric_limits<qint32>::min();
+    qint32 hi = to.isValid() ? static_cast<qint32>(to.toJulianDay()) : std::numeric_limits<qint32>::max();
+
+    *begin = std::lower_bound(dayKey.constBegin(), dayKey.constEnd(), lo) - dayKey.constBegin();
+    *end = std::upper_bound(dayKey.constBegin(), dayKey.constEnd(), hi) - dayKey.constBegin();
+    if (*end < *begin)
+        *end = *begin;
+}
+
+BillColumnStore::Totals BillColumnStore::totals(const QDate &from, const QDate &to) const
+{
+    QReadLocker locker(&lock);
+    Totals result;
+
+    int begin, end;
+    dayRange(from, to, &begin, &end);
+
+    // 无分支累加：收入标记为 0/1，乘法代替条件判断
+    const qint64 *c = cents.constData();
+    const quint8 *in = income.constData();
+    qint64 incomeSum = 0;
+    qint64 totalSum = 0;
+    int incomeCount = 0;
+    for (int i = begin; i < end; ++i) {
+        totalSum += c[i];
+        incomeSum += c[i] * in[i];
+        incomeCount += in[i];
+    }
+
+    result.incomeCents = incomeSum;
+    result.expenseCents = totalSum - incomeSum;
+    result.incomeCount = incomeCount;
+    result.expenseCount = (end - begin) - incomeCount;
+    return result;
+}
+
+QVector<qint64> BillColumnStore::categoryTotals(const QDate &from, const QDate &to, bool isIncome,
+                                                QVector<int> *counts) const
+{
+    QReadLocker locker(&lock);
+
+    int begin, end;
+    dayRange(from, to, &begin, &end);
+
+    const qint32 *cat = categoryId.constData();
+    const qint64 *c = cents.constData();
+    const quint8 *in = income.constData();
+    quint8 wanted = isIncome ? 1 : 0;
+
+    int maxCategory = 0;
+    for (int i = begin; i < end; ++i)
+        maxCategory = std::max(maxCategory, static_cast<int>(cat[i]));
+
+    QVector<qint64> result(maxCategory + 1, 0);
+    qint64 *out = result.data();
+    for (int i = begin; i < end; ++i) {
+        int slot = cat[i] > 0 ? cat[i] : 0;
+        out[slot] += c[i] * (in[i] == wanted);
+    }
+    if (counts) {
+        counts->fill(0, maxCategory + 1);
+        int *n = counts->data();
+        for (int i = begin; i < end; ++i)
+            n[cat[i] > 0 ? cat[i] : 0] += (in[i] == wanted);
+    }
+    return result;
+}
+
+QVector<qint64> BillColumnStore::dailyTotals(const QDate &from, const QDate &to, bool isIncome) const
+{
+    QReadLocker locker(&lock);
+    if (!from.isValid() || !to.isValid() || to < from)
+        return QVector<qint64>();
+
+    int begin, end;
+    dayRange(from, to, &begin, &end);
+
+    qint32 base = static_cast<qint32>(from.toJulianDay());
+    QVector<qint64> result(static_cast<int>(from.daysTo(to)) + 1, 0);
+
+    const qint32 *day = dayKey.constData();
+    const qint64 *c = cents.constData();
+    const quint8 *in = income.constData();
+    quint8 wanted = isIncome ? 1 : 0;
+    qint64 *out = result.data();
+    for (int i = begin; i < end; ++i)
+        out[day[i] - base] += c[i] * (in[i] == wanted);
+    return result;
+}
+
+QHash<int, qint64> BillColumnStore::counterpartyTotals(const QDate &from, const QDate &to, bool isIncome,
+                                                      QHash<int, int> *counts) const
+{
+    QReadLocker locker(&lock);
+
+    int begin, end;
+    dayRange(from, to, &begin, &end);
+
+    const qint32 *party = counterpartyId.constData();
+    const qint64 *c = cents.constData();
+    const quint8 *in = income.constData();
+    quint8 wanted = isIncome ? 1 : 0;
+
+    QHash<int, qint64> result;
+    for (int i = begin; i < end; ++i) {
+        if (in[i] != wanted || party[i] <= 0)
+            continue;
+        result[party[i]] += c[i];
+        if (counts)
+            ++(*counts)[party[i]];
+    }
+    return result;
+}
+
+int BillColumnStore::rowCount(const QDate &from, const QDate &to) const
+{
+    QReadLocker locker(&lock);
+    int begin, end;
+    dayRange(from, to, &begin, &end);
+    return end - begin;
+}
+
+QVector<BillColumnStore::Charge> BillColumnStore::charges(bool isIncome) const
+{
+    QReadLocker locker(&lock);
+
+    const int n = dayKey.size();
+    const qint32 *day = dayKey.constData();
+    const qint32 *party = counterpartyId.constData();
+    const qint64 *c = cents.constData();
+    const quint8 *in = income.constData();
+    quint8 wanted = isIncome ? 1 : 0;
+
+    QVector<Charge> result;
+    result.reserve(n);
+    for (int i = 0; i < n; ++i) {
+        if (in[i] != wanted || party[i] <= 0)
+            continue;
+        Charge charge;
+        charge.day = day[i];
+        charge.counterpartyId = party[i];
+        charge.cents = c[i];
+        result.append(charge);
+    }
+    return result;
+}
+
+// 行按交易日升序，首末交易日就是第一笔和最后一笔匹配行的日期
+BillColumnStore::Extent BillColumnStore::extent(const QDate &from, const QDate &to, bool isIncome, int category) const
+{
+    QReadLocker locker(&lock);
+    Extent result;
+
+    int begin = 0;
+    int end = 0;
+    dayRange(from, to, &begin, &end);
+    quint8 wanted = isIncome ? 1 : 0;
+
+    for (int i = begin; i < end; ++i) {
+        if (income[i] != wanted || (category > 0 && categoryId[i] != category))
+            continue;
+        if (result.count == 0) {
+            result.firstDay = dayKey[i];
+            result.minCents = cents[i];
+        }
+        result.lastDay = dayKey[i];
+        result.minCents = qMin(result.minCents, cents[i]);
+        result.maxCents = qMax(result.maxCents, cents[i]);
+        ++result.count;
+    }
+    return result;
+}
+
+QVector<BillColumnStore::Row> BillColumnStore::rows(const QDate &from, const QDate &to, bool isIncome) const
+{
+    QReadLocker locker(&lock);
+
+    int begin = 0;
+    int end = 0;
+    dayRange(from, to, &begin, &end);
+    quint8 wanted = isIncome ? 1 : 0;
+
+    QVector<Row> result;
+    for (int i = begin; i < end; ++i) {
+        if (income[i] != wanted)
+            continue;
+        Row row;
+        row.id = billId[i];
+        row.day = dayKey[i];
+        row.cents = cents[i];
+        row.categoryId = categoryId[i];
+        result.append(row);
+    }
+    return result;
+}
@@ -0,0 +1,104 @@
+#ifndef BILL_COLUMN_STORE_H
+#define BILL_COLUMN_STORE_H
+
+#include <QVector>
+#include <QHash>
+#include <QDate>
+#include <QReadWriteLock>
+
+class QSqlQuery;
+
+// bill_record 的内存列式快照：每列一个连续数组，按交易日升序排列。
+// 金额以分为单位存整数，统计循环只做整数加法，便于编译器向量化。
+class BillColumnStore
+{
+public:
+    // 某个日期区间内的收支合计（单位：分）
+    struct Totals {
+        qint64 expenseCents = 0;
+        qint64 incomeCents = 0;
+        int expenseCount = 0;
+        int incomeCount = 0;
+    };
+
+    // 一笔带交易对方的收支，供周期扣费检测排序
+    struct Charge {
+        qint32 day = 0;             // 儒略日
+        qint32 counterpartyId = 0;
+        qint64 cents = 0;
+    };
+
+    // 一笔收支的统计字段，供异常检测逐笔打分
+    struct Row {
+        qint32 id = 0;
+        qint32 day = 0;             // 儒略日
+        qint64 cents = 0;
+        qint32 categoryId = 0;
+    };
+
+    // 区间内一种收支的笔数、单笔最小/最大金额和首末交易日（儒略日），无记录时均为 0
+    struct Extent {
+        int count = 0;
+        qint64 minCents = 0;
+        qint64 maxCents = 0;
+        qint32 firstDay = 0;
+        qint32 lastDay = 0;
+    };
+
+    BillColumnStore();
+
+    bool isLoaded() const;
+    void clear();   // 清空并标记为未加载，下次使用时重新加载
+    int size() const;
+
+    // 追加一批查询结果，列顺序：id, 儒略日, 金额(分), 是否收入, category_id, counterparty_id；
+    // 分区较多时分批加载，各批按日期升序依次传入，全部传完后调用 finishLoad()
+    void load(QSqlQuery &query);
+    void finishLoad();
+    // 换入另一份在锁外加载好的快照，other 随后被清空
+    void adopt(BillColumnStore &other);
+
+    // 单条写入后的增量修补；删除先由 id 查到交易日，只在那一天的行里找，不做全表扫描
+    void insert(int id, const QDate &day, qint64 cents, bool income, int categoryId, int counterpartyId);
+    void remove(int id);
+
+    /*区间统计（闭区间，无效日期表示不设限）*/
+    Totals totals(const QDate &from, const QDate &to) const;
+    // 按分类汇总，返回以 category_id 为下标的金额数组（单位：分），未知分类记在下标 0；
+    // counts 非空时同时给出同样下标的笔数
+    QVector<qint64> categoryTotals(const QDate &from, const QDate &to, bool income,
+                                   QVector<int> *counts = nullptr) const;
+    // 按天汇总，返回 from..to 每天一个元素（单位：分）
+    QVector<qint64> dailyTotals(const QDate &from, const QDate &to, bool income) const;
+    // 按交易对方汇总：counterparty_id -> 金额（单位：分），counts 非空时同时给出笔数
+    QHash<int, qint64> counterpartyTotals(const QDate &from, const QDate &to, bool income,
+                                          QHash<int, int> *counts = nullptr) const;
+    // 区间内某种收支的笔数与最值，categoryId 为 0 时不按分类筛选
+    Extent extent(const QDate &from, const QDate &to, bool income, int categoryId = 0) const;
+    // 区间内的账单条数，只做两次二分查找
+    int rowCount(const QDate &from, const QDate &to) const;
+    // 全部有交易对方的收入或支出，按日期升序
+    QVector<Charge> charges(bool income) const;
+    // 区间内的收入或支出，按日期升序
+    QVector<Row> rows(const QDate &from, const QDate &to, bool income) const;
+
+    static qint64 toCents(double amount);
+
+private:
+    // 返回 [from, to] 在数组中的下标区间 [begin, end)
+    void dayRange(const QDate &from, const QDate &to, int *begin, int *end) const;
+
+    QVector<qint32> dayKey;          // 儒略日
+    QVector<qint64> cents;
+    QVector<quint8> income;          // 1 收入 / 0 支出
+    QVector<qint32> categoryId;
+    QVector<qint32> counterpartyId;
+    QVector<qint32> billId;
+    // id -> 儒略日。行下标随插入删除整体移动，记交易日不用跟着改，删除时在当天的行里二分定位
+    QHash<qint32, qint32> idDay;
+
+    bool loaded = false;
+    mutable QReadWriteLock lock;
+};
+
+#endif // BILL_COLUMN_STORE_H
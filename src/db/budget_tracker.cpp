@@ -0,0 +1,133 @@
+#include "budget_tracker.h"
+
+#include <QSqlQuery>
+#include <QReadLocker>
+#include <QWriteLocker>
+#include <QDebug>
+
+BudgetTracker::BudgetTracker()
+{
+}
+
+bool BudgetTracker::isLoaded() const
+{
+    QReadLocker locker(&lock);
+    return loaded;
+}
+
+void BudgetTracker::clear()
+{
+    QWriteLocker locker(&lock);
+    limitCents.clear();
+    spent.clear();
+    loaded = false;
+}
+
+int BudgetTracker::monthIndex(const QDate &day)
+{
+    return day.year() * 12 + day.month() - 1;
+}
+
+qint64 BudgetTracker::counterKey(int month, int categoryId)
+{
+    return (static_cast<qint64>(month) << 32) | static_cast<quint32>(categoryId);
+}
+
+QHash<int, qint64> BudgetTracker::readLimits(QSqlQuery &query)
+{
+    QHash<int, qint64> limits;
+    while (query.next()) {
+        qint64 cents = query.value(1).toLongLong();
+        if (cents > 0)
+            limits.insert(query.value(0).toInt(), cents);
+    }
+    return limits;
+}
+
+void BudgetTracker::loadLimits(const QHash<int, qint64> &limits)
+{
+    QWriteLocker locker(&lock);
+    limitCents = limits;
+    loaded = true;
+}
+
+void BudgetTracker::setLimit(int categoryId, qint64 cents)
+{
+    QWriteLocker locker(&lock);
+    if (cents > 0)
+        limitCents.insert(categoryId, cents);
+    else
+        limitCents.remove(categoryId);
+}
+
+QHash<int, qint64> BudgetTracker::limits() const
+{
+    QReadLocker locker(&lock);
+    return limitCents;
+}
+
+bool BudgetTracker::hasMonth(const QDate &day) const
+{
+    QReadLocker locker(&lock);
+    return spent.contains(monthIndex(day));
+}
+
+QHash<int, qint64> BudgetTracker::readMonth(QSqlQuery &query)
+{
+    QHash<int, qint64> totals;
+    while (query.next())
+        totals[query.value(0).toInt()] += query.value(1).toLongLong();
+    return totals;
+}
+
+void BudgetTracker::loadMonth(const QDate &day, const QHash<int, qint64> &totals)
+{
+    QWriteLocker locker(&lock);
+    if (!spent.contains(monthIndex(day)))
+        spent.insert(monthIndex(day), totals);
+}
+
+void BudgetTracker::apply(const QDate &day, qint64 cents, bool income, int categoryId)
+{
+    if (income || !day.isValid() || cents == 0)
+        return;
+
+    QWriteLocker locker(&lock);
+    auto it = spent.find(monthIndex(day));
+    if (it != spent.end())
+        it.value()[categoryId] += cents;
+}
+
+void BudgetTracker::accumulate(Delta *delta, const QDate &day, qint64 cents, bool income, int categoryId)
+{
+    if (income || !day.isValid() || cents == 0)
+        return;
+    (*delta)[counterKey(monthIndex(day), categoryId)] += cents;
+}
+
+void BudgetTracker::apply(const Delta &delta)
+{
+    QWriteLocker locker(&lock);
+    for (auto it = delta.constBegin(); it != delta.constEnd(); ++it) {
+        auto month = spent.find(static_cast<int>(it.key() >> 32));
+        if (month != spent.end())
+            month.value()[static_cast<int>(static_cast<quint32>(it.key()))] += it.value();
+    }
+}
+
+QVector<BudgetTracker::Status> BudgetTracker::evaluate(const QDate &day) const
+{
+    QVector<Status> result;
+    QReadLocker locker(&lock);
+    result.reserve(limitCents.size());
+
+    const QHash<int, qint64> totals = spent.value(monthIndex(day));
+    for (auto it = limitCents.constBegin(); it != limitCents.constEnd(); ++it) {
+        Status status;
+        status.categoryId = it.key();
+        status.limitCents = it.value();
+        status.spentCents = totals.value(it.key(), 0);
+        result.append(status);
+    }
+    return result;
+}
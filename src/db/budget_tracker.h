@@ -0,0 +1,64 @@
+#ifndef BUDGET_TRACKER_H
+#define BUDGET_TRACKER_H
+
+#include <QVector>
+#include <QHash>
+#include <QDate>
+#include <QReadWriteLock>
+
+class QSqlQuery;
+
+// 分类月度预算的执行情况：预算额度和按（月份, 分类）维护的支出计数器。
+// 某月的计数器在第一次评估时由一次分组查询装入，之后每次增删改、每批导入只调整受影响的计数器，
+// 不再回扫账单；评估一个月只遍历设了预算的分类，代价与账单历史长度无关。
+// 金额以分为单位存整数。
+class BudgetTracker
+{
+public:
+    // 一个分类在某月的预算执行情况（单位：分）
+    struct Status {
+        int categoryId = 0;
+        qint64 limitCents = 0;
+        qint64 spentCents = 0;
+    };
+
+    // 批量写入（导入）时先在这里累计，提交成功后一次合入
+    typedef QHash<qint64, qint64> Delta;
+
+    BudgetTracker();
+
+    bool isLoaded() const;   // 预算额度是否已加载
+    void clear();            // 清空额度和全部计数器，下次使用时重新加载
+
+    // 从预算表读出额度，列顺序：category_id, 额度(分)；读取在锁外进行，loadLimits 换入
+    static QHash<int, qint64> readLimits(QSqlQuery &query);
+    void loadLimits(const QHash<int, qint64> &limits);
+    // 设置或取消（额度 <= 0）某个分类的预算
+    void setLimit(int categoryId, qint64 cents);
+    QHash<int, qint64> limits() const;
+
+    // 某月的计数器是否已装入
+    bool hasMonth(const QDate &day) const;
+    // 读出某月各分类的支出合计，列顺序：category_id, 金额(分)；loadMonth 装入，已装入的月份不覆盖
+    static QHash<int, qint64> readMonth(QSqlQuery &query);
+    void loadMonth(const QDate &day, const QHash<int, qint64> &totals);
+
+    // 单条写入后的修补：新增传正金额，删除传负金额；收入和未装入的月份忽略
+    void apply(const QDate &day, qint64 cents, bool income, int categoryId);
+    static void accumulate(Delta *delta, const QDate &day, qint64 cents, bool income, int categoryId);
+    void apply(const Delta &delta);
+
+    // 某月设了预算的分类的执行情况，O(分类数)
+    QVector<Status> evaluate(const QDate &day) const;
+
+private:
+    static int monthIndex(const QDate &day);
+    static qint64 counterKey(int month, int categoryId);
+
+    QHash<int, qint64> limitCents;               // category_id -> 月度额度
+    QHash<int, QHash<int, qint64> > spent;       // 年 * 12 + 月 - 1 -> (category_id -> 支出)
+    bool loaded = false;
+    mutable QReadWriteLock lock;
+};
+
+#endif // BUDGET_TRACKER_H
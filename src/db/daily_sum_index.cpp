@@ -0,0 +1,260 @@
+#include "daily_sum_index.h"
+
+#include <QSqlQuery>
+#include <QReadLocker>
+#include <QWriteLocker>
+#include <QDebug>
+
+// 扩容时至少多留一年，连续录入新日期时不必每天重建
+static const int MIN_GROWTH_DAYS = 366;
+
+DailySumIndex::DailySumIndex()
+{
+}
+
+bool DailySumIndex::isLoaded() const
+{
+    QReadLocker locker(&lock);
+    return loaded;
+}
+
+void DailySumIndex::clear()
+{
+    QWriteLocker locker(&lock);
+    trees.clear();
+    loaded = false;
+}
+
+void DailySumIndex::adopt(DailySumIndex &other)
+{
+    QWriteLocker locker(&lock);
+    QWriteLocker otherLocker(&other.lock);
+    trees.swap(other.trees);
+    loaded = other.loaded;
+    other.trees.clear();
+    other.loaded = false;
+}
+
+int DailySumIndex::windowDays(Window window)
+{
+    static const int days[WindowCount] = { 7, 30, 90 };
+    return days[window];
+}
+
+qint64 DailySumIndex::seriesKey(bool income, int categoryId)
+{
+    return (static_cast<qint64>(income ? 1 : 0) << 32) | static_cast<quint32>(categoryId);
+}
+
+// 线性时间建树：每个节点把自己的值推给父节点
+void DailySumIndex::build(Tree *tree)
+{
+    const int n = tree->daily.size();
+    tree->nodes.fill(0, n + 1);
+    qint64 *nodes = tree->nodes.data();
+    const qint64 *daily = tree->daily.constData();
+    for (int i = 1; i <= n; ++i) {
+        nodes[i] += daily[i - 1];
+        int parent = i + (i & -i);
+        if (parent <= n)
+            nodes[parent] += nodes[i];
+    }
+}
+
+// 保证树覆盖这一天；超出范围时向该方向多扩一截再重建
+void DailySumIndex::reserveDay(Tree *tree, qint32 day)
+{
+    const int size = tree->daily.size();
+    if (size == 0) {
+        tree->origin = day;
+        tree->daily.fill(0, MIN_GROWTH_DAYS);
+        build(tree);
+        return;
+    }
+
+    if (day < tree->origin) {
+        int extra = qMax(tree->origin - day, qMax(size / 2, MIN_GROWTH_DAYS));
+        tree->daily.insert(0, extra, 0);
+        tree->origin -= extra;
+        build(tree);
+    } else if (day - tree->origin >= size) {
+        int extra = qMax(day - tree->origin - size + 1, qMax(size / 2, MIN_GROWTH_DAYS));
+        tree->daily.resize(size + extra);
+        build(tree);
+    }
+}
+
+void DailySumIndex::add(Tree *tree, qint32 day, qint64 cents)
+{
+    reserveDay(tree, day);
+    int index = day - tree->origin;
+    tree->daily[index] += cents;
+
+    const int n = tree->daily.size();
+    qint64 *nodes = tree->nodes.data();
+    for (int i = index + 1; i <= n; i += i & -i)
+        nodes[i] += cents;
+}
+
+qint64 DailySumIndex::prefix(const Tree &tree, qint32 day)
+{
+    int index = day - tree.origin;
+    if (index < 0 || tree.daily.isEmpty())
+        return 0;
+    index = qMin(index, tree.daily.size() - 1);
+
+    qint64 sum = 0;
+    const qint64 *nodes = tree.nodes.constData();
+    for (int i = index + 1; i > 0; i -= i & -i)
+        sum += nodes[i];
+    return sum;
+}
+
+void DailySumIndex::load(QSqlQuery &query)
+{
+    QWriteLocker locker(&lock);
+    // 先铺逐日金额，finishLoad 时每棵树线性建一次
+    while (query.next()) {
+        qint32 day = static_cast<qint32>(query.value(0).toLongLong());
+        bool income = query.value(1).toInt() != 0;
+        int categoryId = query.value(2).toInt();
+        qint64 cents = query.value(3).toLongLong();
+
+        for (int category : { 0, categoryId }) {
+            Tree &tree = trees[seriesKey(income, category)];
+            if (tree.daily.isEmpty())
+                tree.origin = day;
+            int index = day - tree.origin;
+            if (index >= tree.daily.size())
+                tree.daily.resize(index + 1);
+            tree.daily[index] += cents;
+            if (categoryId == 0)
+                break;
+        }
+    }
+}
+
+void DailySumIndex::finishLoad()
+{
+    QWriteLocker locker(&lock);
+    // 查询按日期升序，origin 就是每棵树的第一天；末尾留出余量给之后的新记录
+    for (auto it = trees.begin(); it != trees.end(); ++it) {
+        it.value().daily.resize(it.value().daily.size() + MIN_GROWTH_DAYS);
+        build(&it.value());
+    }
+
+    loaded = true;
+    qDebug() << "区间合计索引已加载，树数:" << trees.size();
+}
+
+void DailySumIndex::apply(const QDate &day, qint64 cents, bool income, int categoryId)
+{
+    QWriteLocker locker(&lock);
+    if (!loaded || !day.isValid() || cents == 0)
+        return;
+
+    qint32 key = static_cast<qint32>(day.toJulianDay());
+    add(&trees[seriesKey(income, 0)], key, cents);
+    if (categoryId != 0)
+        add(&trees[seriesKey(income, categoryId)], key, cents);
+}
+
+qint64 DailySumIndex::rangeSum(const QDate &from, const QDate &to, bool income, int categoryId) const
+{
+    QReadLocker locker(&lock);
+    auto it = trees.constFind(seriesKey(income, categoryId));
+    if (it == trees.constEnd())
+        return 0;
+
+    const Tree &tree = it.value();
+    qint32 last = to.isValid() ? static_cast<qint32>(to.toJulianDay()) : tree.origin + tree.daily.size() - 1;
+    qint64 sum = prefix(tree, last);
+    if (from.isValid())
+        sum -= prefix(tree, static_cast<qint32>(from.toJulianDay()) - 1);
+    return sum;
+}
+
+QVector<qint64> DailySumIndex::dailyAmounts(const QDate &from, const QDate &to, bool income, int categoryId) const
+{
+    QVector<qint64> result;
+    if (!from.isValid() || !to.isValid() || to < from)
+        return result;
+    result.fill(0, static_cast<int>(from.daysTo(to)) + 1);
+
+    QReadLocker locker(&lock);
+    auto it = trees.constFind(seriesKey(income, categoryId));
+    if (it == trees.constEnd())
+        return result;
+
+    // 只复制与树的日期范围重叠的一段，其余日期没有记录
+    const Tree &tree = it.value();
+    qint32 first = static_cast<qint32>(from.toJulianDay());
+    int begin = qMax(0, tree.origin - first);
+    int end = qMin(result.size(), tree.origin + tree.daily.size() - first);
+    for (int i = begin; i < end; ++i)
+        result[i] = tree.daily[first + i - tree.origin];
+    return result;
+}
+
+QVector<qint64> DailySumIndex::cumulative(const QDate &from, const QDate &to, bool income, int categoryId) const
+{
+    QVector<qint64> result;
+    if (!from.isValid() || !to.isValid() || to < from)
+        return result;
+    result.resize(static_cast<int>(from.daysTo(to)) + 1);
+
+    QReadLocker locker(&lock);
+    auto it = trees.constFind(seriesKey(income, categoryId));
+    if (it == trees.constEnd()) {
+        result.fill(0);
+        return result;
+    }
+
+    // 起点前一天的前缀和查一次树，之后逐日累加
+    const Tree &tree = it.value();
+    qint32 first = static_cast<qint32>(from.toJulianDay());
+    qint64 running = prefix(tree, first - 1);
+    for (int i = 0; i < result.size(); ++i) {
+        int index = first + i - tree.origin;
+        if (index >= 0 && index < tree.daily.size())
+            running += tree.daily[index];
+        result[i] = running;
+    }
+    return result;
+}
+
+QVector<DailySumIndex::WindowPoint> DailySumIndex::rolling(const QDate &from, const QDate &to, bool income, int categoryId) const
+{
+    QVector<WindowPoint> points;
+    if (!from.isValid() || !to.isValid() || to < from)
+        return points;
+
+    points.resize(static_cast<int>(from.daysTo(to)) + 1);
+    for (int i = 0; i < points.size(); ++i)
+        points[i].date = from.addDays(i);
+
+    QReadLocker locker(&lock);
+    auto it = trees.constFind(seriesKey(income, categoryId));
+    if (it == trees.constEnd())
+        return points;
+
+    // 与 cumulative() 相同：最宽窗口起点前一天的前缀和查一次树，之后逐日累加，窗口起点的前缀和按天号复用
+    const Tree &tree = it.value();
+    const qint32 first = static_cast<qint32>(from.toJulianDay());
+    const int widest = windowDays(Days90);
+    QVector<qint64> prefixes(points.size() + widest);
+    qint64 running = prefix(tree, first - widest - 1);
+    for (int i = 0; i < prefixes.size(); ++i) {
+        int index = first - widest + i - tree.origin;
+        if (index >= 0 && index < tree.daily.size())
+            running += tree.daily[index];
+        prefixes[i] = running;
+    }
+
+    for (int i = 0; i < points.size(); ++i) {
+        qint64 end = prefixes[i + widest];
+        for (int w = 0; w < WindowCount; ++w)
+            points[i].totalCents[w] = end - prefixes[i + widest - windowDays(static_cast<Window>(w))];
+    }
+    return points;
+}
@@ -0,0 +1,73 @@
+#ifndef DAILY_SUM_INDEX_H
+#define DAILY_SUM_INDEX_H
+
+#include <QVector>
+#include <QHash>
+#include <QDate>
+#include <QReadWriteLock>
+
+class QSqlQuery;
+
+// 逐日金额上的树状数组（Fenwick 树），按（收支类型, 分类）各一棵，分类 0 表示全部分类。
+// 任意区间合计是两次前缀和之差，单条写入只更新 O(log n) 个节点，耗时与账单历史长度无关。
+// 7/30/90 天滚动合计同样由前缀和相减得到，不另存逐日窗口。
+// 金额以分为单位存整数；日期超出已有范围时按倍数扩容后整体重建（均摊 O(1)）。
+class DailySumIndex
+{
+public:
+    enum Window { Days7 = 0, Days30 = 1, Days90 = 2, WindowCount = 3 };
+
+    // 某一天结尾的三个窗口合计（单位：分）
+    struct WindowPoint {
+        QDate date;
+        qint64 totalCents[WindowCount] = { 0, 0, 0 };
+    };
+
+    DailySumIndex();
+
+    static int windowDays(Window window);
+
+    bool isLoaded() const;
+    void clear();   // 清空并标记为未加载，下次使用时重新加载
+
+    // 追加一批按天、类型、分类分组的查询结果，列顺序：儒略日, 是否收入, category_id, 金额(分)；
+    // 各批按日期升序依次传入，全部传完后调用 finishLoad() 建树
+    void load(QSqlQuery &query);
+    void finishLoad();
+    // 换入另一份在锁外加载好的数据，other 随后被清空
+    void adopt(DailySumIndex &other);
+
+    // 单条写入后的增量修补：新增传正金额，删除传负金额
+    void apply(const QDate &day, qint64 cents, bool income, int categoryId);
+
+    // 闭区间合计（单位：分），无效日期表示该端不设限
+    qint64 rangeSum(const QDate &from, const QDate &to, bool income, int categoryId = 0) const;
+
+    // [from, to] 每天一个元素：当天的合计（单位：分），直接读逐日金额，不查树
+    QVector<qint64> dailyAmounts(const QDate &from, const QDate &to, bool income, int categoryId = 0) const;
+
+    // [from, to] 每天一个元素：从最早的账单累计到当天的合计（单位：分）
+    QVector<qint64> cumulative(const QDate &from, const QDate &to, bool income, int categoryId = 0) const;
+
+    // [from, to] 每天一个点：以当天结尾的 7/30/90 天合计，即 prefix(day) - prefix(day - w)
+    QVector<WindowPoint> rolling(const QDate &from, const QDate &to, bool income, int categoryId = 0) const;
+
+private:
+    struct Tree {
+        qint32 origin = 0;          // 下标 0 对应的儒略日
+        QVector<qint64> daily;      // 逐日金额，扩容和重建时使用
+        QVector<qint64> nodes;      // 1 起始的 Fenwick 节点，nodes.size() == daily.size() + 1
+    };
+
+    static qint64 seriesKey(bool income, int categoryId);
+    static void build(Tree *tree);
+    static void reserveDay(Tree *tree, qint32 day);
+    static void add(Tree *tree, qint32 day, qint64 cents);
+    static qint64 prefix(const Tree &tree, qint32 day);    // origin..day 的合计
+
+    QHash<qint64, Tree> trees;
+    bool loaded = false;
+    mutable QReadWriteLock lock;
+};
+
+#endif // DAILY_SUM_INDEX_H
@@ -3,8 +3,51 @@
 #include <QSqlError>
 #include <QDebug>
 #include <QFile>
+#include <QFileInfo>
+#include <QSqlRecord>
+#include <QDir>
+#include <QUrl>
 #include <QDateTime>
 #include <QRegularExpression>
+#include <QThread>
+#include <QMutexLocker>
+#include <QElapsedTimer>
+#include <algorithm>
+
+// SQLite 默认最多附加 10 个数据库
+static const int MAX_ATTACHED_PARTITIONS = 10;
+
+// 分区文件中的账单表：列顺序与主库 bill_record 一致，便于 SELECT * 直接 UNION ALL；
+// id 由主库统一分配，跨库无法声明外键
+static const char *PARTITION_BILL_SQL =
+    "CREATE TABLE IF NOT EXISTS %1.bill_record ("
+    " id INTEGER PRIMARY KEY,"
+    " transaction_date TEXT,"
+    " year INTEGER,"
+    " month INTEGER,"
+    " week INTEGER,"
+    " amount REAL,"
+    " transaction_type TEXT CHECK(transaction_type IN ('income','expense')),"
+    " category_id INTEGER,"
+    " transaction_method_id INTEGER,"
+    " counterparty TEXT,"
+    " description TEXT,"
+    " remark TEXT,"
+    " source_id TEXT UNIQUE,"
+    " counterparty_id INTEGER"
+    ");";
+
+static QString partitionSchema(int year)
+{
+    return QString("p%1").arg(year);
+}
+
+// 按交易时间的覆盖索引列
+static const char *DATE_COVER_COLUMNS =
+    "transaction_date, transaction_type, amount, category_id, transaction_method_id";
+
+// 没有对应分区时使用的空数据源
+static const char *EMPTY_BILL_SOURCE = "(SELECT * FROM main.bill_record WHERE 0)";
 
 DatabaseManager::DatabaseManager()
 {
@@ -12,8 +55,49 @@ DatabaseManager::DatabaseManager()
 
 DatabaseManager::~DatabaseManager()
 {
-    if (db.isOpen())
-        db.close();
+    if (primary.db.isOpen())
+        primary.db.close();
+}
+
+DatabaseManager::Connection::~Connection()
+{
+    // 主连接（默认连接）随程序退出关闭；只读连接随所属线程结束移除
+    if (name.isEmpty())
+        return;
+    statements.setDatabase(QSqlDatabase());
+    db.close();
+    db = QSqlDatabase();
+    QSqlDatabase::removeDatabase(name);
+}
+
+// 当前线程的连接。QSqlDatabase 连接只能在创建它的线程中使用，
+// 工作线程第一次查询时打开自己的只读连接，线程结束时由 QThreadStorage 释放
+DatabaseManager::Connection &DatabaseManager::conn()
+{
+    if (QThread::currentThread() == primaryThread)
+        return primary;
+
+    if (!readers.hasLocalData()) {
+        Connection *reader = new Connection;
+        reader->name = QString("reader_%1").arg(reinterpret_cast<quintptr>(QThread::currentThread()));
+        reader->db = QSqlDatabase::addDatabase("QSQLITE", reader->name);
+        reader->db.setDatabaseName(dbPath);
+        reader->db.setConnectOptions("QSQLITE_OPEN_READONLY;QSQLITE_OPEN_URI");
+        if (reader->db.open()) {
+            QSqlQuery q(reader->db);
+            q.exec("PRAGMA foreign_keys = ON;");
+        } else {
+            qDebug() << "只读连接打开失败:" << reader->db.lastError().text();
+        }
+        reader->statements.setDatabase(reader->db);
+        readers.setLocalData(reader);
+    }
+    return *readers.localData();
+}
+
+QSqlDatabase DatabaseManager::connection()
+{
+    return conn().db;
 }
 
 // 数据库实例
@@ -26,20 +110,41 @@ DatabaseManager& DatabaseManager::instance()
 // 打开数据库
 bool DatabaseManager::openDatabase()
 {
-    db = QSqlDatabase::addDatabase("QSQLITE");
-    db.setDatabaseName("app.db");
-
-    if (!db.open()) {
-        qDebug() << "数据库打开失败:" << db.lastError().text();
+    primary.db = QSqlDatabase::addDatabase("QSQLITE");
+    primary.db.setDatabaseName("app.db");
+    primaryThread = QThread::currentThread();
+    dbPath = QFileInfo("app.db").absoluteFilePath();
+    // 只读/不可变分区通过 URI 参数附加
+    primary.db.setConnectOptions("QSQLITE_OPEN_URI");
+
+    if (!primary.db.open()) {
+        qDebug() << "数据库打开失败:" << primary.db.lastError().text();
         ready = false;
         return false;
     } else {
         qDebug() << "数据库打开成功!";
     }
 
-    QSqlQuery q;
+    QSqlQuery q(connection());
     q.exec("PRAGMA foreign_keys = ON;");
-
+    // 必须在切换 WAL 和建表之前设置：切换 WAL 会先写入文件头，之后再设 auto_vacuum 不生效。
+    // 只对新建的空库生效；旧库要在“整理数据库”中执行一次完整 VACUUM 才会切换
+    q.exec("PRAGMA auto_vacuum = INCREMENTAL;");
+    // WAL 下后台维护连接与界面线程互不阻塞读
+    q.exec("PRAGMA journal_mode = WAL;");
+
+    counterpartyCache.clear();
+    primary.attachedPartitions.clear();
+    columns.clear();
+    sums.clear();
+    merchants.clear();
+    budgets.clear();
+    recurring.clear();
+    anomalies.clear();
+    results.invalidateAll();
+    primary.statements.setDatabase(primary.db);
+    commentCache.clear();
+    commentCacheLoaded = false;
     ready = true;
     return true;
 }
@@ -49,7 +154,7 @@ bool DatabaseManager::createTables()
 {
     if (!ready) return false;
 
-    QSqlQuery query;
+    QSqlQuery query(connection());
 
     // 分类表
     QString categorySql =
@@ -76,6 +181,18 @@ bool DatabaseManager::createTables()
         return false;
     }
 
+    // 交易对方字典表：账单只保存整数 id，同一商户名只存一份
+    QString counterpartySql =
+        "CREATE TABLE IF NOT EXISTS counterparty ("
+        " id INTEGER PRIMARY KEY,"
+        " name TEXT NOT NULL UNIQUE"
+        ");";
+
+    if (!query.exec(counterpartySql)) {
+        qDebug() << "创建 counterparty 失败:" << query.lastError().text();
+        return false;
+    }
+
     // 账单表
     QString billSql =
         "CREATE TABLE IF NOT EXISTS bill_record ("
@@ -92,8 +209,10 @@ bool DatabaseManager::createTables()
         " description TEXT,"
         " remark TEXT,"
         " source_id TEXT UNIQUE,"
+        " counterparty_id INTEGER,"
         " FOREIGN KEY(category_id) REFERENCES category(id),"
-        " FOREIGN KEY(transaction_method_id) REFERENCES transaction_method(id)"
+        " FOREIGN KEY(transaction_method_id) REFERENCES transaction_method(id),"
+        " FOREIGN KEY(counterparty_id) REFERENCES counterparty(id)"
         ");";
 
     if (!query.exec(billSql)) {
@@ -114,9 +233,659 @@ bool DatabaseManager::createTables()
         return false;
     }
 
+    // 分类月度预算：每个支出分类一行
+    QString budgetSql =
+        "CREATE TABLE IF NOT EXISTS budget ("
+        " category_id INTEGER PRIMARY KEY,"
+        " amount REAL NOT NULL,"
+        " FOREIGN KEY(category_id) REFERENCES category(id)"
+        ");";
+
+    if (!query.exec(budgetSql)) {
+        qDebug() << "创建 budget 失败:" << query.lastError().text();
+        return false;
+    }
+
+    if (!migrateCounterparty()) {
+        return false;
+    }
+
+    // 周期统计按 year + month / year + week 走索引范围；按交易时间的区间统计走覆盖索引，
+    // 汇总、逐日和分类统计需要的列都在索引里，不回表。它以 transaction_date 开头，替代原来的单列索引
+    if (!query.exec("CREATE INDEX IF NOT EXISTS idx_bill_year_month ON bill_record(year, month);") ||
+        !query.exec("CREATE INDEX IF NOT EXISTS idx_bill_year_week ON bill_record(year, week);") ||
+        !query.exec(QString("CREATE INDEX IF NOT EXISTS idx_bill_date_cover ON bill_record(%1);").arg(DATE_COVER_COLUMNS)) ||
+        !query.exec("DROP INDEX IF EXISTS idx_bill_date;")) {
+        qDebug() << "创建周期索引失败:" << query.lastError().text();
+    }
+
+    if (!query.exec("CREATE INDEX IF NOT EXISTS idx_bill_counterparty ON bill_record(counterparty_id);")) {
+        qDebug() << "创建 idx_bill_counterparty 失败:" << query.lastError().text();
+        return false;
+    }
+
+    // 全文索引失败不影响记账功能，搜索会退回 LIKE 扫描
+    searchIndexReady = createSearchIndex();
+
+    // 存储布局与分区状态
+    QString metaSql =
+        "CREATE TABLE IF NOT EXISTS storage_meta ("
+        " key TEXT PRIMARY KEY,"
+        " value TEXT"
+        ");";
+    QString partitionSql =
+        "CREATE TABLE IF NOT EXISTS partition_state ("
+        " year INTEGER PRIMARY KEY,"
+        " mode INTEGER NOT NULL DEFAULT 0"
+        ");";
+
+    if (!query.exec(metaSql) || !query.exec(partitionSql)) {
+        qDebug() << "创建分区元数据表失败:" << query.lastError().text();
+        return false;
+    }
+
+    loadStorageLayout();
+
+    return true;
+}
+
+// 读取存储布局：分区模式下扫描同目录的 app_<year>.db
+void DatabaseManager::loadStorageLayout()
+{
+    QMutexLocker locker(&stateLock);
+    QSqlQuery query(connection());
+    query.exec("SELECT value FROM storage_meta WHERE key = 'layout';");
+    partitioned = query.next() && query.value(0).toString() == "partitioned";
+
+    partitionModes.clear();
+    query.exec("SELECT year, mode FROM partition_state;");
+    while (query.next()) {
+        partitionModes.insert(query.value(0).toInt(), query.value(1).toInt());
+    }
+
+    partitionYears.clear();
+    if (!partitioned)
+        return;
+
+    QDir dir = QFileInfo(dbPath).absoluteDir();
+    QRegularExpression pattern("^app_(\\d{4})\\.db$");
+    for (const QString &name : dir.entryList(QStringList() << "app_*.db", QDir::Files, QDir::Name)) {
+        QRegularExpressionMatch match = pattern.match(name);
+        if (match.hasMatch())
+            partitionYears.append(match.captured(1).toInt());
+    }
+}
+
+bool DatabaseManager::isPartitioned() const
+{
+    return partitioned;
+}
+
+QString DatabaseManager::partitionPath(int year) const
+{
+    QDir dir = QFileInfo(dbPath).absoluteDir();
+    return dir.absoluteFilePath(QString("app_%1.db").arg(year));
+}
+
+// 附加某年分区；create 为 false 且文件不存在时返回 false
+bool DatabaseManager::attachPartition(int year, bool create)
+{
+    if (conn().attachedPartitions.contains(year)) {
+        conn().attachedPartitions.removeOne(year);
+        conn().attachedPartitions.append(year);
+        return true;
+    }
+
+    QString path = partitionPath(year);
+    if (!create && !QFile::exists(path))
+        return false;
+
+    // 达到附加上限时卸下最久未用的分区（仍有活动语句的分区会卸载失败，跳过）
+    if (conn().attachedPartitions.size() >= MAX_ATTACHED_PARTITIONS) {
+        bool freed = false;
+        for (int candidate : QList<int>(conn().attachedPartitions)) {
+            if (detachPartition(candidate)) {
+                freed = true;
+                break;
+            }
+        }
+        if (!freed) {
+            qDebug() << "分区附加数已达上限，无法附加" << year;
+            return false;
+        }
+    }
+
+    Connection &c = conn();
+    QMutexLocker locker(&stateLock);
+    int mode = partitionModes.value(year, PartitionReadWrite);
+    QString uri = QUrl::fromLocalFile(path).toString(QUrl::FullyEncoded);
+    if (mode == PartitionReadOnly)
+        uri += "?mode=ro";
+    else if (mode == PartitionImmutable)
+        uri += "?mode=ro&immutable=1";
+
+    QSqlQuery query(connection());
+    query.prepare(QString("ATTACH DATABASE :uri AS %1;").arg(partitionSchema(year)));
+    query.bindValue(":uri", uri);
+    if (!query.exec()) {
+        qDebug() << "附加分区失败:" << year << query.lastError().text();
+        return false;
+    }
+
+    // 只读连接附加的分区同样只读，建表建索引由主连接负责
+    if (mode == PartitionReadWrite && &c == &primary) {
+        QString schema = partitionSchema(year);
+        // 新建的分区文件在建表前开启增量回收，已有的文件不受影响
+        query.exec(QString("PRAGMA %1.auto_vacuum = INCREMENTAL;").arg(schema));
+        if (!query.exec(QString(PARTITION_BILL_SQL).arg(schema)) ||
+            !query.exec(QString("CREATE INDEX IF NOT EXISTS %1.idx_bill_counterparty "
+                                "ON bill_record(counterparty_id);").arg(schema)) ||
+            !query.exec(QString("CREATE INDEX IF NOT EXISTS %1.idx_bill_year_month "
+                                "ON bill_record(year, month);").arg(schema)) ||
+            !query.exec(QString("CREATE INDEX IF NOT EXISTS %1.idx_bill_year_week "
+                                "ON bill_record(year, week);").arg(schema)) ||
+            !query.exec(QString("CREATE INDEX IF NOT EXISTS %1.idx_bill_date_cover "
+                                "ON bill_record(%2);").arg(schema, DATE_COVER_COLUMNS)) ||
+            !query.exec(QString("DROP INDEX IF EXISTS %1.idx_bill_date;").arg(schema))) {
+            qDebug() << "创建分区表失败:" << year << query.lastError().text();
+        }
+    }
+
+    c.attachedPartitions.append(year);
+    if (!partitionYears.contains(year)) {
+        partitionYears.append(year);
+        std::sort(partitionYears.begin(), partitionYears.end());
+    }
+    return true;
+}
+
+bool DatabaseManager::detachPartition(int year)
+{
+    // 缓存的语句可能引用该分区，先全部释放
+    conn().statements.clear();
+
+    QSqlQuery query(connection());
+    if (!query.exec(QString("DETACH DATABASE %1;").arg(partitionSchema(year)))) {
+        qDebug() << "卸载分区失败:" << year << query.lastError().text();
+        return false;
+    }
+    conn().attachedPartitions.removeOne(year);
+    return true;
+}
+
+// 单个年份的账单表；分区模式下只附加该年份，读取不存在的年份时返回空数据源
+QString DatabaseManager::billTable(int year, bool create)
+{
+    if (!partitioned)
+        return "bill_record";
+
+    if (!attachPartition(year, create))
+        return EMPTY_BILL_SOURCE;
+
+    return partitionSchema(year) + ".bill_record";
+}
+
+// 范围内已有的分区按附加上限切成若干批
+QList<QList<int> > DatabaseManager::partitionBatches(int fromYear, int toYear, bool newestFirst)
+{
+    stateLock.lock();
+    QList<int> available = partitionYears;
+    stateLock.unlock();
+
+    QList<int> years;
+    for (int year : available) {
+        if (year >= fromYear && year <= toYear)
+            years.append(year);
+    }
+
+    QList<QList<int> > batches;
+    for (int i = 0; i < years.size(); i += MAX_ATTACHED_PARTITIONS)
+        batches.append(years.mid(i, MAX_ATTACHED_PARTITIONS));
+    if (newestFirst)
+        std::reverse(batches.begin(), batches.end());
+    return batches;
+}
+
+// 单批数据源：把范围内的分区 UNION ALL 成一个派生视图。
+// 只给范围有限的查询使用，范围内分区超过附加上限时不截断，返回空字符串由调用方报错
+QString DatabaseManager::billSource(int fromYear, int toYear)
+{
+    if (!partitioned)
+        return "bill_record";
+
+    QList<QList<int> > batches = partitionBatches(fromYear, toYear);
+    if (batches.isEmpty())
+        return EMPTY_BILL_SOURCE;
+    if (batches.size() > 1) {
+        qDebug() << "跨年查询涉及的分区超过附加上限" << MAX_ATTACHED_PARTITIONS << "，无法在一条语句中查询:"
+                 << fromYear << "-" << toYear;
+        return QString();
+    }
+
+    QStringList parts;
+    for (int year : batches.first()) {
+        if (!attachPartition(year, false)) {
+            qDebug() << "附加分区失败，跨年查询中止:" << year;
+            return QString();
+        }
+        parts << QString("SELECT * FROM %1.bill_record").arg(partitionSchema(year));
+    }
+    if (parts.size() == 1)
+        return partitionSchema(batches.first().first()) + ".bill_record";
+    return "(" + parts.join(" UNION ALL ") + ")";
+}
+
+// 分批执行：一批最多附加 MAX_ATTACHED_PARTITIONS 个分区，下一批附加时按最久未用卸下上一批。
+// 各批年份互不重叠，按天、按月分组的结果直接拼接，按名称分组的由调用方再合并一次
+bool DatabaseManager::forEachBillSource(int fromYear, int toYear, const std::function<bool(const QString &)> &visit,
+                                        bool newestFirst)
+{
+    if (!partitioned) {
+        visit("bill_record");
+        return true;
+    }
+
+    QList<QList<int> > batches = partitionBatches(fromYear, toYear, newestFirst);
+    if (batches.isEmpty()) {
+        visit(EMPTY_BILL_SOURCE);
+        return true;
+    }
+
+    for (const QList<int> &batch : batches) {
+        QStringList parts;
+        for (int year : batch) {
+            if (!attachPartition(year, false)) {
+                qDebug() << "附加分区失败，跨年查询中止:" << year;
+                return false;
+            }
+            parts << QString("SELECT * FROM %1.bill_record").arg(partitionSchema(year));
+        }
+        QString source = parts.size() == 1 ? partitionSchema(batch.first()) + ".bill_record"
+                                           : "(" + parts.join(" UNION ALL ") + ")";
+        if (!visit(source))
+            break;
+    }
+    return true;
+}
+
+// 全部历史逐批执行 sql（%1 为数据源），供内存索引加载
+bool DatabaseManager::scanHistory(const QString &sql, const std::function<void(QSqlQuery &)> &consume)
+{
+    bool ok = true;
+    bool attached = forEachBillSource(0, 9999, [&](const QString &source) {
+        QSqlQuery query(connection());
+        query.setForwardOnly(true);
+        query.prepare(sql.arg(source));
+        if (!query.exec()) {
+            qDebug() << "读取账单历史失败:" << query.lastError().text();
+            ok = false;
+            return false;
+        }
+        consume(query);
+        return true;
+    });
+    return ok && attached;
+}
+
+// 分区模式下账单 id 由主库统一分配，保证跨年份唯一；失败返回 -1，调用方放弃插入
+qint64 DatabaseManager::allocateBillId()
+{
+    QSqlQuery update = conn().statements.statement("allocateBillId.update",
+        "UPDATE storage_meta SET value = CAST(value AS INTEGER) + 1 WHERE key = 'next_bill_id';");
+    if (!update.exec()) {
+        qDebug() << "分配账单 id 失败:" << update.lastError().text();
+        return -1;
+    }
+    if (update.numRowsAffected() != 1) {
+        qDebug() << "分配账单 id 失败: storage_meta 缺少 next_bill_id";
+        return -1;
+    }
+
+    QSqlQuery query = conn().statements.statement("allocateBillId.select",
+        "SELECT CAST(value AS INTEGER) - 1 FROM storage_meta WHERE key = 'next_bill_id';");
+    if (!query.exec()) {
+        qDebug() << "分配账单 id 失败:" << query.lastError().text();
+        return -1;
+    }
+    qint64 id = query.next() ? query.value(0).toLongLong() : -1;
+    query.finish();
+    return id > 0 ? id : -1;
+}
+
+// 根据 id 找到账单所在的分区年份，找不到返回 0
+int DatabaseManager::findRecordYear(int id)
+{
+    stateLock.lock();
+    QList<int> available = partitionYears;
+    stateLock.unlock();
+
+    for (int i = available.size() - 1; i >= 0; --i) {
+        int year = available[i];
+        if (!attachPartition(year, false))
+            continue;
+
+        QSqlQuery query(connection());
+        query.prepare(QString("SELECT 1 FROM %1.bill_record WHERE id = :id;").arg(partitionSchema(year)));
+        query.bindValue(":id", id);
+        if (query.exec() && query.next())
+            return year;
+    }
+    return 0;
+}
+
+// 账单所在的年份，找不到返回 0
+int DatabaseManager::recordYear(int id)
+{
+    if (partitioned)
+        return findRecordYear(id);
+
+    QSqlQuery query(connection());
+    query.prepare("SELECT year FROM bill_record WHERE id = :id;");
+    query.bindValue(":id", id);
+    if (query.exec() && query.next())
+        return query.value(0).toInt();
+    return 0;
+}
+
+bool DatabaseManager::recordFacts(const QString &table, int id, QDate *day, qint64 *cents, bool *income, int *categoryId)
+{
+    QSqlQuery query(connection());
+    query.prepare(QString("SELECT transaction_date, amount, transaction_type, COALESCE(category_id, 0) "
+                          "FROM %1 WHERE id = :id;").arg(table));
+    query.bindValue(":id", id);
+    if (!query.exec() || !query.next())
+        return false;
+
+    *day = QDate::fromString(query.value(0).toString().left(10), "yyyy-MM-dd");
+    *cents = BillColumnStore::toCents(query.value(1).toDouble());
+    *income = query.value(2).toString() == "income";
+    *categoryId = query.value(3).toInt();
+    return true;
+}
+
+// 单库 -> 分区：按 year 列把账单搬到各自的年份文件
+bool DatabaseManager::convertToPartitionedLayout()
+{
+    if (!ready || partitioned)
+        return partitioned;
+
+    QSqlQuery query(connection());
+    QList<int> years;
+    query.exec("SELECT DISTINCT year FROM bill_record WHERE year IS NOT NULL ORDER BY year;");
+    while (query.next()) {
+        years.append(query.value(0).toInt());
+    }
+
+    qint64 nextId = 1;
+    query.exec("SELECT COALESCE(MAX(id), 0) + 1 FROM bill_record;");
+    if (query.next())
+        nextId = query.value(0).toLongLong();
+
+    // 第一步：逐年复制到分区文件并核对条数，主库保持不动。
+    // 中途失败时布局标记仍是单库，数据都还在主库；重新执行时 INSERT OR REPLACE 覆盖上次复制了一半的分区
+    for (int year : years) {
+        if (!attachPartition(year, true)) {
+            qDebug() << "迁移分区失败，无法附加:" << year;
+            return false;
+        }
+
+        primary.db.transaction();
+        QString schema = partitionSchema(year);
+        query.prepare(QString("INSERT OR REPLACE INTO %1.bill_record SELECT * FROM main.bill_record WHERE year = :year;").arg(schema));
+        query.bindValue(":year", year);
+        bool ok = query.exec();
+        if (ok) {
+            query.prepare(QString("SELECT (SELECT COUNT(*) FROM main.bill_record WHERE year = :year) "
+                                  "= (SELECT COUNT(*) FROM %1.bill_record WHERE year = :year);").arg(schema));
+            query.bindValue(":year", year);
+            ok = query.exec() && query.next() && query.value(0).toInt() == 1;
+            query.finish();
+        }
+        if (!ok || !primary.db.commit()) {
+            qDebug() << "迁移分区失败:" << year << query.lastError().text();
+            primary.db.rollback();
+            return false;
+        }
+    }
+
+    // 第二步：布局标记、id 分配起点和主库删除放在同一个事务里，要么全部生效要么都不生效
+    primary.db.transaction();
+    query.prepare("INSERT OR REPLACE INTO storage_meta(key, value) VALUES ('next_bill_id', :next);");
+    query.bindValue(":next", nextId);
+    bool ok = query.exec()
+           && query.exec("INSERT OR REPLACE INTO storage_meta(key, value) VALUES ('layout', 'partitioned');")
+           && query.exec("DELETE FROM main.bill_record WHERE year IS NOT NULL;");
+    if (!ok || !primary.db.commit()) {
+        qDebug() << "切换分区布局失败:" << query.lastError().text();
+        primary.db.rollback();
+        return false;
+    }
+    partitioned = true;
+
+    results.invalidateAll();
+    qDebug() << "已切换为按年分区存储，分区数:" << years.size();
+    return true;
+}
+
+bool DatabaseManager::setPartitionMode(int year, PartitionMode mode)
+{
+    QSqlQuery query(connection());
+    query.prepare("INSERT OR REPLACE INTO partition_state(year, mode) VALUES (:year, :mode);");
+    query.bindValue(":year", year);
+    query.bindValue(":mode", static_cast<int>(mode));
+    if (!query.exec()) {
+        qDebug() << "设置分区模式失败:" << query.lastError().text();
+        return false;
+    }
+    stateLock.lock();
+    partitionModes.insert(year, mode);
+    stateLock.unlock();
+
+    // 已附加的分区按新模式重新附加
+    if (conn().attachedPartitions.contains(year) && detachPartition(year))
+        attachPartition(year, false);
+    return true;
+}
+
+QList<int> DatabaseManager::partitionYearList()
+{
+    QMutexLocker locker(&stateLock);
+    return partitionYears;
+}
+
+DatabaseManager::PartitionMode DatabaseManager::partitionMode(int year)
+{
+    QMutexLocker locker(&stateLock);
+    return static_cast<PartitionMode>(partitionModes.value(year, PartitionReadWrite));
+}
+
+// 完整 VACUUM 会重写整个文件并在期间占住写锁，耗时随库大小增长，所以后台维护不做，
+// 只在用户确认后执行；旧库借此切换到 auto_vacuum=INCREMENTAL，之后由维护线程增量回收
+bool DatabaseManager::compactDatabase()
+{
+    if (!ready)
+        return false;
+
+    QElapsedTimer timer;
+    timer.start();
+
+    // 缓存的语句持有未完成的读取时 VACUUM 会失败，先全部释放
+    conn().statements.clear();
+    QStringList schemas;
+    schemas << "main";
+    stateLock.lock();
+    QList<int> years = partitionYears;
+    stateLock.unlock();
+    for (int year : years) {
+        stateLock.lock();
+        int mode = partitionModes.value(year, PartitionReadWrite);
+        stateLock.unlock();
+        if (mode == PartitionReadWrite && attachPartition(year, false))
+            schemas << partitionSchema(year);
+    }
+
+    QSqlQuery query(connection());
+    for (const QString &schema : schemas) {
+        if (!query.exec(QString("PRAGMA %1.auto_vacuum = INCREMENTAL;").arg(schema)) ||
+            !query.exec(QString("VACUUM %1;").arg(schema))) {
+            qDebug() << "整理数据库失败:" << schema << query.lastError().text();
+            return false;
+        }
+    }
+    qDebug() << "整理数据库完成，共" << schemas.size() << "个文件，耗时" << timer.elapsed() << "ms";
+    return true;
+}
+
+// 全文索引：外部内容 FTS5 表，内容来自 bill_search_source 视图，由触发器保持同步
+bool DatabaseManager::createSearchIndex()
+{
+    QSqlQuery query(connection());
+
+    // 交易对方已字典化，视图负责把名称还原给 FTS5
+    QString viewSql =
+        "CREATE VIEW IF NOT EXISTS bill_search_source AS "
+        "SELECT b.id AS id, b.description AS description, "
+        "COALESCE(cp.name, b.counterparty) AS counterparty, b.remark AS remark "
+        "FROM bill_record b "
+        "LEFT JOIN counterparty cp ON cp.id = b.counterparty_id;";
+
+    if (!query.exec(viewSql)) {
+        qDebug() << "创建 bill_search_source 失败:" << query.lastError().text();
+        return false;
+    }
+
+    query.exec("SELECT 1 FROM sqlite_master WHERE type = 'table' AND name = 'bill_fts';");
+    bool existed = query.next();
+
+    if (!existed) {
+        // trigram 分词对中文按三字滑窗切分；旧版 SQLite 没有 trigram 时退回 unicode61
+        QString ftsSql =
+            "CREATE VIRTUAL TABLE bill_fts USING fts5("
+            "description, counterparty, remark, "
+            "content='bill_search_source', content_rowid='id', tokenize='%1');";
+
+        if (!query.exec(ftsSql.arg("trigram")) && !query.exec(ftsSql.arg("unicode61"))) {
+            qDebug() << "创建 bill_fts 失败:" << query.lastError().text();
+            return false;
+        }
+    }
+
+    QStringList triggers = {
+        "CREATE TRIGGER IF NOT EXISTS bill_fts_ai AFTER INSERT ON bill_record BEGIN "
+        " INSERT INTO bill_fts(rowid, description, counterparty, remark) "
+        " VALUES (new.id, new.description, "
+        " COALESCE((SELECT name FROM counterparty WHERE id = new.counterparty_id), new.counterparty), new.remark); "
+        "END;",
+
+        "CREATE TRIGGER IF NOT EXISTS bill_fts_ad AFTER DELETE ON bill_record BEGIN "
+        " INSERT INTO bill_fts(bill_fts, rowid, description, counterparty, remark) "
+        " VALUES ('delete', old.id, old.description, "
+        " COALESCE((SELECT name FROM counterparty WHERE id = old.counterparty_id), old.counterparty), old.remark); "
+        "END;",
+
+        "CREATE TRIGGER IF NOT EXISTS bill_fts_au "
+        "AFTER UPDATE OF description, counterparty, counterparty_id, remark ON bill_record BEGIN "
+        " INSERT INTO bill_fts(bill_fts, rowid, description, counterparty, remark) "
+        " VALUES ('delete', old.id, old.description, "
+        " COALESCE((SELECT name FROM counterparty WHERE id = old.counterparty_id), old.counterparty), old.remark); "
+        " INSERT INTO bill_fts(rowid, description, counterparty, remark) "
+        " VALUES (new.id, new.description, "
+        " COALESCE((SELECT name FROM counterparty WHERE id = new.counterparty_id), new.counterparty), new.remark); "
+        "END;"
+    };
+
+    for (const QString &sql : triggers) {
+        if (!query.exec(sql)) {
+            qDebug() << "创建全文索引触发器失败:" << query.lastError().text();
+            return false;
+        }
+    }
+
+    // 新建索引时把已有账单一次性灌入
+    if (!existed && !query.exec("INSERT INTO bill_fts(bill_fts) VALUES('rebuild');")) {
+        qDebug() << "重建 bill_fts 失败:" << query.lastError().text();
+        return false;
+    }
+
+    return true;
+}
+
+// 旧库迁移：补 counterparty_id 列，把文本交易对方写入字典表后清空原文本列
+bool DatabaseManager::migrateCounterparty()
+{
+    QSqlQuery query(connection());
+
+    bool hasColumn = false;
+    query.exec("PRAGMA table_info(bill_record);");
+    while (query.next()) {
+        if (query.value("name").toString() == "counterparty_id") {
+            hasColumn = true;
+            break;
+        }
+    }
+
+    if (!hasColumn &&
+        !query.exec("ALTER TABLE bill_record ADD COLUMN counterparty_id INTEGER REFERENCES counterparty(id);")) {
+        qDebug() << "添加 counterparty_id 列失败:" << query.lastError().text();
+        return false;
+    }
+
+    primary.db.transaction();
+    bool ok = query.exec(
+        "INSERT OR IGNORE INTO counterparty(name) "
+        "SELECT DISTINCT counterparty FROM bill_record "
+        "WHERE counterparty_id IS NULL AND counterparty IS NOT NULL AND counterparty <> '';")
+        && query.exec(
+        "UPDATE bill_record SET "
+        "counterparty_id = (SELECT id FROM counterparty WHERE name = bill_record.counterparty), "
+        "counterparty = NULL "
+        "WHERE counterparty_id IS NULL AND counterparty IS NOT NULL AND counterparty <> '';");
+
+    if (!ok) {
+        qDebug() << "迁移交易对方失败:" << query.lastError().text();
+        primary.db.rollback();
+        return false;
+    }
+    primary.db.commit();
     return true;
 }
 
+// 交易对方字符串驻留：先查内存缓存，未命中再查/写字典表；空字符串返回 0（表示无交易对方）
+int DatabaseManager::internCounterparty(const QString &name)
+{
+    QString key = name.trimmed();
+    if (key.isEmpty())
+        return 0;
+
+    QHash<QString, int>::const_iterator it = counterpartyCache.constFind(key);
+    if (it != counterpartyCache.constEnd())
+        return it.value();
+
+    QSqlQuery query = conn().statements.statement("internCounterparty.select",
+                                           "SELECT id FROM counterparty WHERE name = :name");
+    query.bindValue(":name", key);
+    query.exec();
+
+    int id = 0;
+    if (query.next()) {
+        id = query.value(0).toInt();
+        query.finish();
+    } else {
+        query.finish();
+        QSqlQuery insert = conn().statements.statement("internCounterparty.insert",
+                                                "INSERT INTO counterparty(name) VALUES (:name)");
+        insert.bindValue(":name", key);
+        if (!insert.exec()) {
+            qDebug() << "写入交易对方失败:" << insert.lastError();
+            return 0;
+        }
+        id = insert.lastInsertId().toInt();
+    }
+
+    counterpartyCache.insert(key, id);
+    return id;
+}
+
 // 分类表、交易方式表和评论表插入记录
 void DatabaseManager::insertDefaultTables()
 {
@@ -142,7 +911,7 @@ void DatabaseManager::insertDefaultTables()
         "好朋友一生一起走。", "必要的经济手段。", "我拒绝了你的拒绝。", "还有什么神奇的途径？"
     };
 
-    QSqlQuery q;
+    QSqlQuery q(connection());
     int id = 1;
 
     int category_ids[] = {1, 3, 5, 7, 9, 11, 13, 15, 17, 19, 21, 23, 25, 27, 29, 31, 33, 35, 37, 39, 41, 43, 45, 47, 49, 51, 51, 53, 55, 57, 59, 61};
@@ -173,24 +942,109 @@ void DatabaseManager::insertDefaultTables()
     }
 }
 
+QString DatabaseManager::databasePath() const
+{
+    return dbPath;
+}
+
 bool DatabaseManager::isReady() const
 {
     return ready;
 }
 
-// 提取支付宝表中字段值
-static QStringList parseSimpleAlipayCsvLine(const QString &line)
+// 交易对方 id 为 0 时按 NULL 写入
+static QVariant counterpartyIdValue(int counterpartyId)
 {
-    QStringList cols;
-    QString temp;
-    int commaCount = 0;
+    return counterpartyId > 0 ? QVariant(counterpartyId) : QVariant(QVariant::Int);
+}
 
-    for(int i = 0; i < line.size(); ++i)
-    {
-        QChar c = line[i];
+// 账单查询统一列顺序（与原 SELECT * 一致），交易对方名称从字典表取回
+static const char *BILL_RECORD_COLUMNS =
+    "b.id, b.transaction_date, b.year, b.month, b.week, b.amount, b.transaction_type, "
+    "b.category_id, b.transaction_method_id, COALESCE(cp.name, b.counterparty) AS counterparty, "
+    "b.description, b.remark, b.source_id, b.counterparty_id ";
 
-        // 前 11 列正常按逗号切
-        if(c == ',' && commaCount < 11)
+// 按 BILL_RECORD_COLUMNS 的列顺序执行并读出账单；检索语句在末尾多一列 score
+static QVector<BillRecord> fetchBillRecords(QSqlQuery &query, int expected)
+{
+    QVector<BillRecord> records;
+    if (!query.exec()) {
+        qDebug() << "查询账单失败:" << query.lastError().text();
+        return records;
+    }
+
+    records.reserve(expected);
+    bool hasScore = query.record().count() > 14;
+    while (query.next()) {
+        BillRecord r;
+        r.id = query.value(0).toInt();
+        r.transactionDate = query.value(1).toString();
+        r.year = query.value(2).toInt();
+        r.month = query.value(3).toInt();
+        r.week = query.value(4).toInt();
+        r.amount = query.value(5).toDouble();
+        r.transactionType = query.value(6).toString();
+        r.categoryId = query.value(7).toInt();
+        r.methodId = query.value(8).toInt();
+        r.counterparty = query.value(9).toString();
+        r.description = query.value(10).toString();
+        r.remark = query.value(11).toString();
+        r.sourceId = query.value(12).toString();
+        r.counterpartyId = query.value(13).toInt();
+        if (hasScore)
+            r.score = query.value(14).toDouble();
+        records.append(r);
+    }
+    query.finish();
+    return records;
+}
+
+// 分类统计：name, bill_count, total_amount
+static QVector<CategoryStat> fetchCategoryStats(QSqlQuery &query)
+{
+    QVector<CategoryStat> stats;
+    if (!query.exec()) {
+        qDebug() << "查询分类统计失败:" << query.lastError().text();
+        return stats;
+    }
+
+    stats.reserve(32);
+    while (query.next()) {
+        CategoryStat stat;
+        stat.name = query.value(0).toString();
+        stat.count = query.value(1).toInt();
+        stat.total = query.value(2).toDouble();
+        stats.append(stat);
+    }
+    query.finish();
+    return stats;
+}
+
+// 单值聚合，无记录时为 0
+static double fetchDouble(QSqlQuery &query)
+{
+    if (!query.exec()) {
+        qDebug() << "查询合计失败:" << query.lastError().text();
+        return 0;
+    }
+    double value = query.next() ? query.value(0).toDouble() : 0;
+    query.finish();
+    return value;
+}
+
+// 提取支付宝表中字段值
+static QStringList parseSimpleAlipayCsvLine(const QString &line)
+{
+    QStringList cols;
+    QString temp;
+    int commaCount = 0;
+
+    for(int i = 0; i < line.size(); ++i)
+    {
+        QChar c = line[i];
+
+        // 前 11 列正常按逗号切
+        if(c == ',' && commaCount < 11)
         {
             cols << temp.trimmed();
             temp.clear();
@@ -210,17 +1064,17 @@ static QStringList parseSimpleAlipayCsvLine(const QString &line)
 
 
 // 导入支付宝账单
-void DatabaseManager::importAlipayCsv(const QString &csvPath)
+bool DatabaseManager::importAlipayCsv(const QString &csvPath)
 {
     if(!ready){
         qDebug() << "数据库未初始化";
-        return;
+        return false;
     }
 
     QFile file(csvPath);
     if(!file.open(QIODevice::ReadOnly)){
         qDebug() << "无法打开文件:" << csvPath;
-        return;
+        return false;
     }
 
     QTextStream in(&file);
@@ -228,6 +1082,10 @@ void DatabaseManager::importAlipayCsv(const QString &csvPath)
 
     bool dataStart = false;
 
+    // 先把数据行全部拆成列并筛选、解析时间，交易单号查重和分区附加都要在开启事务前完成
+    QVector<QStringList> rows;
+    QStringList orderNos;
+    QList<int> years;
     while(!in.atEnd())
     {
         QString line = in.readLine();
@@ -246,23 +1104,10 @@ void DatabaseManager::importAlipayCsv(const QString &csvPath)
 
         if(cols.size() < 12) continue;
 
-        // 裁剪出导入数据库的信息列
-        QString time          = cols[0];
-        QString categoryName  = cols[1];
-        QString counterparty  = cols[2];
-        QString description   = cols[4];
+        // ---------- 筛选逻辑 ----------
         QString incomeExpense = cols[5];   // 收入 / 支出 / 不计收支
-        QString amount        = cols[6];
         QString methodName    = cols[7];   // 收/付款方式
         QString state         = cols[8];   // 交易状态
-        QString orderNo = cols[9];
-        orderNo.remove('"');
-        orderNo = orderNo.trimmed();
-        orderNo.remove(QRegularExpression("[^0-9]"));
-
-        QString remark        = cols[11];
-
-        // ---------- 筛选逻辑 ----------
         if(methodName.isEmpty()) continue;
 
         if(!(state == "支付成功" || state == "交易成功"))
@@ -272,7 +1117,7 @@ void DatabaseManager::importAlipayCsv(const QString &csvPath)
             continue;
 
         // ---------- 解析时间 ----------
-        time = time.trimmed();
+        QString time = cols[0].trimmed();
         time.replace(QRegularExpression("\\s+"), " ");
 
         // 尝试 yyyy-MM-dd HH:mm:ss
@@ -290,7 +1135,71 @@ void DatabaseManager::importAlipayCsv(const QString &csvPath)
             qDebug() << "时间解析失败:" << time;
             continue;   // 防止脏数据继续插入
         }
+        cols[0] = dt.toString("yyyy-MM-dd HH:mm:ss");
+        if (!years.contains(dt.date().year()))
+            years.append(dt.date().year());
+
+        QString orderNo = cols[9];
+        orderNo.remove('"');
+        orderNo = orderNo.trimmed();
+        orderNo.remove(QRegularExpression("[^0-9]"));
+        cols[9] = orderNo;
+        orderNos << orderNo;
+        rows.append(cols);
+    }
+
+    // 分区模式下交易单号的唯一约束只在单个年份文件内生效，需要跨分区查重；
+    // 查重要附加各年份分区，而 ATTACH 不能在事务中执行，所以放在事务开始之前
+    QSet<QString> existing;
+    if (partitioned && !findExistingSourceIds(orderNos, &existing)) {
+        qDebug() << "交易单号查重失败，导入中止";
+        return false;
+    }
+
+    // 涉及的年份分区全部附加好再开启事务，整个导入只有一次提交；
+    // 超过附加上限的文件无法放进一个事务，整体拒绝而不是部分导入
+    if (partitioned) {
+        if (years.size() > MAX_ATTACHED_PARTITIONS) {
+            qDebug() << "导入文件跨越" << years.size() << "个年份，超过分区附加上限"
+                     << MAX_ATTACHED_PARTITIONS << "，请按年份拆分后导入";
+            return false;
+        }
+        std::sort(years.begin(), years.end());
+        for (int year : years) {
+            if (!attachPartition(year, true)) {
+                qDebug() << "附加分区失败，导入中止:" << year;
+                return false;
+            }
+        }
+        for (int year : years) {
+            if (!conn().attachedPartitions.contains(year)) {
+                qDebug() << "分区在附加其它年份时被卸下，导入中止:" << year;
+                return false;
+            }
+        }
+    }
+
+    // 整个导入放在一个事务里，交易对方字典的写入不会逐行落盘
+    WriteScope write(this);
+    if (!primary.db.transaction()) {
+        qDebug() << "导入开启事务失败:" << primary.db.lastError().text();
+        return false;
+    }
+    BudgetTracker::Delta budgetDelta;
+    AnomalyDetector::Delta anomalyDelta;
+    bool failed = false;
 
+    for (const QStringList &cols : rows)
+    {
+        // 裁剪出导入数据库的信息列（第一遍已筛选，时间已规范为 yyyy-MM-dd HH:mm:ss）
+        QDateTime dt          = QDateTime::fromString(cols[0], "yyyy-MM-dd HH:mm:ss");
+        QString categoryName  = cols[1];
+        QString counterparty  = cols[2];
+        QString description   = cols[4];
+        QString incomeExpense = cols[5];   // 收入 / 支出
+        QString amount        = cols[6];
+        QString orderNo       = cols[9];   // 已去掉非数字字符
+        QString remark        = cols[11];
 
         int year  = dt.date().year();
         int month = dt.date().month();
@@ -300,664 +1209,2067 @@ void DatabaseManager::importAlipayCsv(const QString &csvPath)
         QString type = (incomeExpense == "收入") ? "income" : "expense";
 
         // ---------- 分类 id ----------
-        QSqlQuery q;
-        q.prepare("SELECT id FROM category WHERE name=? AND type=?");
-        q.addBindValue(categoryName);
-        q.addBindValue(type);
+        QSqlQuery q = conn().statements.statement("import.category", "SELECT id FROM category WHERE name=? AND type=?");
+        q.bindValue(0, categoryName);
+        q.bindValue(1, type);
         q.exec();
 
         int categoryId = -1;
         if(q.next())
             categoryId = q.value(0).toInt();
+        q.finish();
 
         // ---------- 插入 bill_record ----------
-        QSqlQuery ins;
-        ins.prepare(
-            "INSERT OR IGNORE INTO bill_record("
-            "transaction_date, year, month, week, amount, transaction_type,"
-            "category_id, transaction_method_id, counterparty, description, remark, source_id"
-            ") VALUES (?,?,?,?,?,?,?,?,?,?,?,?)"
+        if (partitioned && existing.contains(orderNo))
+            continue;
+
+        // 先算出需要其它语句的值，再取插入语句绑定
+        QVariant newId(QVariant::LongLong);
+        if (partitioned) {
+            qint64 allocated = allocateBillId();
+            if (allocated < 0) {
+                failed = true;
+                break;
+            }
+            newId = allocated;
+        }
+        QVariant counterpartyId = counterpartyIdValue(internCounterparty(counterparty));
+
+        QSqlQuery ins = conn().statements.statement("import.insert",
+            QString("INSERT OR IGNORE INTO %1("
+            "id, transaction_date, year, month, week, amount, transaction_type,"
+            "category_id, transaction_method_id, counterparty_id, description, remark, source_id"
+            ") VALUES (?,?,?,?,?,?,?,?,?,?,?,?,?)").arg(billTable(year, true))
             );
 
-        ins.addBindValue(dt.toString("yyyy-MM-dd HH:mm:ss"));
-        ins.addBindValue(year);
-        ins.addBindValue(month);
-        ins.addBindValue(week);
-        ins.addBindValue(amount.toDouble());
-        ins.addBindValue(type);
-        ins.addBindValue(categoryId);
-        ins.addBindValue(2);
-        ins.addBindValue(counterparty);
-        ins.addBindValue(description);
-        ins.addBindValue(remark);
-        ins.addBindValue(orderNo);
+        ins.bindValue(0, newId);
+        ins.bindValue(1, dt.toString("yyyy-MM-dd HH:mm:ss"));
+        ins.bindValue(2, year);
+        ins.bindValue(3, month);
+        ins.bindValue(4, week);
+        ins.bindValue(5, amount.toDouble());
+        ins.bindValue(6, type);
+        ins.bindValue(7, categoryId);
+        ins.bindValue(8, 2);
+        ins.bindValue(9, counterpartyId);
+        ins.bindValue(10, description);
+        ins.bindValue(11, remark);
+        ins.bindValue(12, orderNo);
 
         if(!ins.exec()){
             qDebug() << "插入失败:" << ins.lastError();
+        } else if (ins.numRowsAffected() > 0) {
+            qint64 cents = BillColumnStore::toCents(amount.toDouble());
+            BudgetTracker::accumulate(&budgetDelta, dt.date(), cents, type == "income", categoryId);
+            AnomalyDetector::accumulate(&anomalyDelta, dt.date(), cents, type == "income", categoryId);
         }
     }
 
+    if (failed || !primary.db.commit()) {
+        if (!failed)
+            qDebug() << "导入提交失败:" << primary.db.lastError().text();
+        primary.db.rollback();
+        counterpartyCache.clear();
+        return false;
+    }
+
+    // 批量导入后整体重建快照，比逐条插入有序数组更快
+    columns.clear();
+    sums.clear();
+    merchants.clear();
+    // 预算计数器只调整本批写入涉及的（月份, 分类），异常基线合并本批的均值 / 方差
+    budgets.apply(budgetDelta);
+    anomalies.apply(anomalyDelta);
+    results.invalidateAll();
     qDebug() << "支付宝账单导入完成!";
+    return true;
 }
 
-// 筛选某年的所有支出记录
-QSqlQuery DatabaseManager::getExpenseRecordsByYear(int year)
+const StatementCache &DatabaseManager::statementCache() const
 {
-    QSqlQuery query;
-    query.prepare(
-        "SELECT * FROM bill_record "
-        "WHERE year = :year "
-        "AND transaction_type = 'expense';"
-    );
-    query.bindValue(":year", year);
-    query.exec();
+    return primary.statements;
+}
 
-    return query;
+const QueryResultCache &DatabaseManager::resultCache() const
+{
+    return results;
 }
 
-// 筛选某年的所有收入记录
-QSqlQuery DatabaseManager::getIncomeRecordsByYear(int year)
+// 列式快照：按需从全部账单加载
+const BillColumnStore &DatabaseManager::columnStore()
 {
-    QSqlQuery query;
-    query.prepare(
-        "SELECT * FROM bill_record "
-        "WHERE year = :year "
-        "AND transaction_type = 'income';"
-    );
-    query.bindValue(":year", year);
-    query.exec();
+    BillColumnStore fresh;
+    loadIndex(&columnsLoadLock, [this] { return columns.isLoaded(); }, [this, &fresh] {
+        // 儒略日在 SQL 中算好，避免逐行解析日期字符串；julianday 以正午为界，+0.5 与 QDate 对齐
+        fresh.clear();
+        bool ok = scanHistory(
+            "SELECT id, "
+            "CAST(julianday(substr(transaction_date, 1, 10)) + 0.5 AS INTEGER), "
+            "CAST(ROUND(amount * 100) AS INTEGER), "
+            "transaction_type = 'income', "
+            "COALESCE(category_id, 0), "
+            "COALESCE(counterparty_id, 0) "
+            "FROM %1 "
+            "ORDER BY transaction_date, id;",
+            [&fresh](QSqlQuery &query) { fresh.load(query); });
+        if (!ok) {
+            qDebug() << "加载列式快照失败";
+            return false;
+        }
+        fresh.finishLoad();
+        return true;
+    }, [this, &fresh] { columns.adopt(fresh); });
+    return columns;
+}
 
-    return query;
+// 按天、类型、分类分组的逐日金额（单位：分），区间合计索引（含滚动窗口）由它加载，
+// 分组后的行数比账单条数小得多
+static const char *DAILY_GROUP_SQL =
+    "SELECT CAST(julianday(substr(transaction_date, 1, 10)) + 0.5 AS INTEGER) AS day, "
+    "transaction_type = 'income' AS income, "
+    "COALESCE(category_id, 0) AS category, "
+    "SUM(CAST(ROUND(amount * 100) AS INTEGER)) "
+    "FROM %1 "
+    "GROUP BY day, income, category "
+    "ORDER BY day;";
+
+DatabaseManager::WriteScope::WriteScope(DatabaseManager *manager)
+    : manager(manager)
+{
+    QMutexLocker locker(&manager->stateLock);
+    ++manager->writeGeneration;
 }
 
-// 筛选某月的所有支出记录
-QSqlQuery DatabaseManager::getExpenseRecordsByMonth(int year, int month)
+DatabaseManager::WriteScope::~WriteScope()
 {
-    QSqlQuery query;
-    query.prepare(
-        "SELECT * FROM bill_record "
-        "WHERE year = :year "
-        "AND month = :month "
-        "AND transaction_type = 'expense';"
-    );
-    query.bindValue(":year", year);
-    query.bindValue(":month", month);
-    query.exec();
+    QMutexLocker locker(&manager->stateLock);
+    ++manager->writeGeneration;
+}
 
-    return query;
+// 加载期间不持有 stateLock，主线程的写入不必等全量加载结束；
+// 加载开始时有写入进行中就稍后再试，加载途中发生过写入就丢弃重来
+bool DatabaseManager::loadIndex(QMutex *serial, const std::function<bool()> &isLoaded,
+                                const std::function<bool()> &load, const std::function<void()> &adopt)
+{
+    QMutexLocker serialLocker(serial);
+    for (;;) {
+        stateLock.lock();
+        bool done = !ready || isLoaded();
+        quint64 generation = writeGeneration;
+        stateLock.unlock();
+        if (done)
+            return isLoaded();
+        if (generation & 1) {
+            QThread::msleep(1);
+            continue;
+        }
+
+        if (!load())
+            return false;
+
+        QMutexLocker locker(&stateLock);
+        if (writeGeneration == generation) {
+            adopt();
+            return true;
+        }
+        qDebug() << "加载期间有账单写入，重新加载";
+    }
 }
 
-// 筛选某月的所有收入记录
-QSqlQuery DatabaseManager::getIncomeRecordsByMonth(int year, int month)
+// 启动预热在工作线程上加载，与主线程的写入并发，同样经 loadIndex 换入
+const DailySumIndex &DatabaseManager::dailySums()
 {
-    QSqlQuery query;
-    query.prepare(
-        "SELECT * FROM bill_record "
-        "WHERE year = :year "
-        "AND month = :month "
-        "AND transaction_type = 'income';"
-    );
-    query.bindValue(":year", year);
-    query.bindValue(":month", month);
-    query.exec();
+    DailySumIndex fresh;
+    loadIndex(&sumsLoadLock, [this] { return sums.isLoaded(); }, [this, &fresh] {
+        fresh.clear();
+        if (!scanHistory(DAILY_GROUP_SQL, [&fresh](QSqlQuery &query) { fresh.load(query); })) {
+            qDebug() << "加载区间合计索引失败";
+            return false;
+        }
+        fresh.finishLoad();
+        return true;
+    }, [this, &fresh] { sums.adopt(fresh); });
+    return sums;
+}
 
-    return query;
+/*
+ * 周期 × 收支类型 × 聚合方式的查询族。
+ * 每个组合对应 BillQuery<P, T, A> 的一个实例，SQL 文本只在该实例第一次使用时拼出一次并常驻；
+ * C++11 不能在编译期拼接字符串，所以用函数内静态量代替 constexpr。
+ * 表名（分区模式下随年份变化）留作 %3，周期参数一律按整数或日期字符串绑定。
+ */
+enum BillType { ExpenseBills, IncomeBills };
+enum BillAggregation { RecordsAggregation, TotalAggregation, CategoryStatsAggregation };
+
+// 周期 -> WHERE 条件
+template <int P> struct PeriodTraits;
+template <> struct PeriodTraits<PeriodKey::Year> {
+    static const char *condition() { return "b.year = :year"; }
+};
+template <> struct PeriodTraits<PeriodKey::Month> {
+    static const char *condition() { return "b.year = :year AND b.month = :value"; }
+};
+template <> struct PeriodTraits<PeriodKey::Week> {
+    static const char *condition() { return "b.year = :year AND b.week = :value"; }
+};
+template <> struct PeriodTraits<PeriodKey::Quarter> {
+    static const char *condition() { return "b.year = :year AND b.month BETWEEN :month_from AND :month_to"; }
+};
+template <> struct PeriodTraits<PeriodKey::Range> {
+    static const char *condition() { return "b.transaction_date >= :from AND b.transaction_date < :to"; }
+};
+
+// 收支类型 -> 常量条件
+template <int T> struct BillTypeTraits;
+template <> struct BillTypeTraits<ExpenseBills> {
+    static const char *condition() { return "b.transaction_type = 'expense'"; }
+};
+template <> struct BillTypeTraits<IncomeBills> {
+    static const char *condition() { return "b.transaction_type = 'income'"; }
+};
+
+// 聚合方式 -> 语句骨架：%1 周期条件，%2 类型条件，%3 表
+template <int A> struct AggregationTraits;
+template <> struct AggregationTraits<RecordsAggregation> {
+    static QString skeleton() {
+        return QString("SELECT %1"
+                       "FROM %4 b "
+                       "LEFT JOIN counterparty cp ON cp.id = b.counterparty_id "
+                       "WHERE %2 AND %3;").arg(BILL_RECORD_COLUMNS, "%1", "%2", "%3");
+    }
+};
+template <> struct AggregationTraits<TotalAggregation> {
+    static QString skeleton() {
+        return "SELECT SUM(b.amount) FROM %3 b WHERE %1 AND %2;";
+    }
+};
+template <> struct AggregationTraits<CategoryStatsAggregation> {
+    static QString skeleton() {
+        return "SELECT c.name, COUNT(b.id) AS bill_count, SUM(b.amount) AS total_amount "
+               "FROM %3 b "
+               "JOIN category c ON b.category_id = c.id "
+               "WHERE %1 AND %2 "
+               "GROUP BY c.name "
+               "ORDER BY total_amount DESC;";
+    }
+};
+
+struct QuerySpec
+{
+    QString id;    // 语句缓存的键
+    QString sql;   // 仍含表名占位符 %1
+};
+
+template <int P, int T, int A>
+struct BillQuery
+{
+    static const QuerySpec &spec()
+    {
+        static const QuerySpec s = {
+            QString("bill.%1.%2.%3").arg(P).arg(T).arg(A),
+            AggregationTraits<A>::skeleton()
+                .arg(PeriodTraits<P>::condition(), BillTypeTraits<T>::condition(), "%1")
+        };
+        return s;
+    }
+};
+
+template <int A, int T>
+static const QuerySpec &querySpec(PeriodKey::Kind kind)
+{
+    switch (kind) {
+    case PeriodKey::Month:   return BillQuery<PeriodKey::Month, T, A>::spec();
+    case PeriodKey::Week:    return BillQuery<PeriodKey::Week, T, A>::spec();
+    case PeriodKey::Quarter: return BillQuery<PeriodKey::Quarter, T, A>::spec();
+    case PeriodKey::Range:   return BillQuery<PeriodKey::Range, T, A>::spec();
+    default:                 return BillQuery<PeriodKey::Year, T, A>::spec();
+    }
 }
 
-// 筛选某周的所有支出记录
-QSqlQuery DatabaseManager::getExpenseRecordsByWeek(int year, int week)
+template <int A>
+static const QuerySpec &querySpec(PeriodKey::Kind kind, const QString &transactionType)
 {
-    QSqlQuery query;
-    query.prepare(
-        "SELECT * FROM bill_record "
-        "WHERE year = :year "
-        "AND week = :week "
-        "AND transaction_type = 'expense';"
-    );
-    query.bindValue(":year", year);
-    query.bindValue(":week", week);
-    query.exec();
+    return transactionType == "income" ? querySpec<A, IncomeBills>(kind)
+                                       : querySpec<A, ExpenseBills>(kind);
+}
+
+// 运行时周期 -> WHERE 条件（与查询族共用同一组条件文本）
+static QString periodCondition(const PeriodKey &period)
+{
+    switch (period.kind) {
+    case PeriodKey::Month:   return PeriodTraits<PeriodKey::Month>::condition();
+    case PeriodKey::Week:    return PeriodTraits<PeriodKey::Week>::condition();
+    case PeriodKey::Quarter: return PeriodTraits<PeriodKey::Quarter>::condition();
+    case PeriodKey::Range:   return PeriodTraits<PeriodKey::Range>::condition();
+    default:                 return PeriodTraits<PeriodKey::Year>::condition();
+    }
+}
+
+// 按周期绑定参数，全部为整数（区间为日期字符串）
+static void bindPeriod(QSqlQuery &query, const PeriodKey &period)
+{
+    switch (period.kind) {
+    case PeriodKey::Range:
+        query.bindValue(":from", period.from.toString("yyyy-MM-dd"));
+        query.bindValue(":to", period.to.addDays(1).toString("yyyy-MM-dd"));
+        break;
+    case PeriodKey::Quarter:
+        query.bindValue(":year", period.year);
+        query.bindValue(":month_from", period.value * 3 - 2);
+        query.bindValue(":month_to", period.value * 3);
+        break;
+    case PeriodKey::Month:
+    case PeriodKey::Week:
+        query.bindValue(":year", period.year);
+        query.bindValue(":value", period.value);
+        break;
+    default:
+        query.bindValue(":year", period.year);
+        break;
+    }
+}
+
+// 周期覆盖的账单数据源：单个年份用该年的表，自定义区间可能跨年；
+// 跨年区间超出一批可附加的分区时返回空串，调用方不出结果而不是只算其中几年
+QString DatabaseManager::periodSource(const PeriodKey &period)
+{
+    if (period.kind == PeriodKey::Range)
+        return billSource(period.from.year(), period.to.year());
+    return billTable(period.year);
+}
+
+// 结果缓存的键：查询类型 + 周期 + 收支类型
+static QString resultKey(const char *kind, const PeriodKey &period, const QString &transactionType = QString())
+{
+    return QString("%1|%2|%3|%4|%5|%6|%7").arg(kind).arg(period.kind).arg(period.year).arg(period.value)
+        .arg(period.from.toString(Qt::ISODate), period.to.toString(Qt::ISODate), transactionType);
+}
+
+// 周期所涉年份的写入版本
+static quint64 periodVersion(const QueryResultCache &cache, const PeriodKey &period)
+{
+    if (period.kind == PeriodKey::Range)
+        return cache.version(period.from.year(), period.to.year());
+    return cache.version(period.year, period.year);
+}
 
+// 结果在缓存中的估算字节数，用于 LRU 预算
+static int resultBytes(const QVector<BillRecord> &records)
+{
+    int bytes = 64;
+    for (const BillRecord &r : records) {
+        bytes += sizeof(BillRecord) + 2 * (r.transactionDate.size() + r.transactionType.size() +
+                 r.counterparty.size() + r.description.size() + r.remark.size() + r.sourceId.size());
+    }
+    return bytes;
+}
+
+static int resultBytes(const QVector<CategoryStat> &stats)
+{
+    int bytes = 64;
+    for (const CategoryStat &stat : stats) {
+        bytes += sizeof(CategoryStat) + 2 * stat.name.size();
+    }
+    return bytes;
+}
+
+// 取出已缓存的预编译语句并绑定周期参数
+QSqlQuery DatabaseManager::periodStatement(const QString &id, const QString &sql, const QString &source, const PeriodKey &period)
+{
+    QSqlQuery query = conn().statements.statement(id, sql.arg(source));
+    bindPeriod(query, period);
     return query;
 }
 
+// 周期内某类收支的全部记录
+QVector<BillRecord> DatabaseManager::getRecords(const PeriodKey &period, const QString &transactionType)
+{
+    QString key = resultKey("records", period, transactionType);
+    quint64 version = periodVersion(results, period);
+    QVector<BillRecord> records;
+    if (results.lookup(key, version, &records))
+        return records;
+
+    QString source = periodSource(period);
+    if (source.isEmpty())
+        return records;
+
+    const QuerySpec &spec = querySpec<RecordsAggregation>(period.kind, transactionType);
+    QSqlQuery query = periodStatement(spec.id, spec.sql, source, period);
+    records = fetchBillRecords(query, 256);
+    if (!query.lastError().isValid())
+        results.store(key, version, records, resultBytes(records));
+    return records;
+}
+
+// 周期内某类收支的合计
+double DatabaseManager::getTotal(const PeriodKey &period, const QString &transactionType)
+{
+    QString key = resultKey("total", period, transactionType);
+    quint64 version = periodVersion(results, period);
+    double total = 0;
+    if (results.lookup(key, version, &total))
+        return total;
+
+    QString source = periodSource(period);
+    if (source.isEmpty())
+        return total;
+
+    const QuerySpec &spec = querySpec<TotalAggregation>(period.kind, transactionType);
+    QSqlQuery query = periodStatement(spec.id, spec.sql, source, period);
+    total = fetchDouble(query);
+    if (!query.lastError().isValid())
+        results.store(key, version, total, 64);
+    return total;
+}
+
+// 周期内某类收支的分类排行
+QVector<CategoryStat> DatabaseManager::getCategoryStats(const PeriodKey &period, const QString &transactionType)
+{
+    QString key = resultKey("categoryStats", period, transactionType);
+    quint64 version = periodVersion(results, period);
+    QVector<CategoryStat> stats;
+    if (results.lookup(key, version, &stats))
+        return stats;
+
+    QString source = periodSource(period);
+    if (source.isEmpty())
+        return stats;
+
+    const QuerySpec &spec = querySpec<CategoryStatsAggregation>(period.kind, transactionType);
+    QSqlQuery query = periodStatement(spec.id, spec.sql, source, period);
+    stats = fetchCategoryStats(query);
+    if (!query.lastError().isValid())
+        results.store(key, version, stats, resultBytes(stats));
+    return stats;
+}
+
+// 筛选某年的所有支出记录
+QVector<BillRecord> DatabaseManager::getExpenseRecordsByYear(int year)
+{
+    return getRecords(PeriodKey::ofYear(year), "expense");
+}
+
+// 筛选某年的所有收入记录
+QVector<BillRecord> DatabaseManager::getIncomeRecordsByYear(int year)
+{
+    return getRecords(PeriodKey::ofYear(year), "income");
+}
+
+// 筛选某月的所有支出记录
+QVector<BillRecord> DatabaseManager::getExpenseRecordsByMonth(int year, int month)
+{
+    return getRecords(PeriodKey::ofMonth(year, month), "expense");
+}
+
+// 筛选某月的所有收入记录
+QVector<BillRecord> DatabaseManager::getIncomeRecordsByMonth(int year, int month)
+{
+    return getRecords(PeriodKey::ofMonth(year, month), "income");
+}
+
+// 筛选某周的所有支出记录
+QVector<BillRecord> DatabaseManager::getExpenseRecordsByWeek(int year, int week)
+{
+    return getRecords(PeriodKey::ofWeek(year, week), "expense");
+}
+
 // 筛选某周的所有收入记录
-QSqlQuery DatabaseManager::getIncomeRecordsByWeek(int year, int week)
+QVector<BillRecord> DatabaseManager::getIncomeRecordsByWeek(int year, int week)
 {
-    QSqlQuery query;
-    query.prepare(
-        "SELECT * FROM bill_record "
-        "WHERE year = :year "
-        "AND week = :week "
-        "AND transaction_type = 'income';"
-    );
-    query.bindValue(":year", year);
-    query.bindValue(":week", week);
-    query.exec();
+    return getRecords(PeriodKey::ofWeek(year, week), "income");
+}
 
-    return query;
+// transaction_date 是 "yyyy-MM-dd HH:mm:ss" 字符串，某一天即 [当天, 次日) 的字符串区间，可以走日期索引
+static QString nextDay(const QString &date)
+{
+    return QDate::fromString(date.left(10), "yyyy-MM-dd").addDays(1).toString("yyyy-MM-dd");
 }
 
 // 筛选某天的所有支出和收入记录
-QSqlQuery DatabaseManager::getRecordsByDay(QString date)
+QVector<BillRecord> DatabaseManager::getRecordsByDay(QString date)
 {
-    //注意：因日期无法调用记录修改
-    //原：WHERE transaction_date = :date;
-    //字符串加%
-    QSqlQuery query;
+    QSqlQuery query(connection());
+    query.setForwardOnly(true);
     query.prepare(
-        "SELECT * FROM bill_record "
-        "WHERE transaction_date LIKE :date;"
+        QString("SELECT %1"
+        "FROM %2 b "
+        "LEFT JOIN counterparty cp ON cp.id = b.counterparty_id "
+        "WHERE b.transaction_date >= :from "
+        "AND b.transaction_date < :to;"
+        ).arg(BILL_RECORD_COLUMNS, billTable(date.left(4).toInt()))
     );
-    query.bindValue(":date", date+"%");
-    query.exec();
+    query.bindValue(":from", date.left(10));
+    query.bindValue(":to", nextDay(date));
+    return fetchBillRecords(query, 16);
+}
 
-    return query;
+// 全文检索账单
+QVector<BillRecord> DatabaseManager::searchRecords(const QString &text, const DateRange &range, int limit)
+{
+    // 空格分隔的多个词按 AND 组合，每个词作为短语查询，避免用户输入被当成 FTS5 语法
+    QStringList terms = text.simplified().split(' ');
+    terms.removeAll(QString());
+
+    // 日期区间按 transaction_date 的字符串序比较，右端取次日零点
+    QString from = range.from.isValid() ? range.from.toString("yyyy-MM-dd") : QString("0000");
+    QString to = range.to.isValid() ? range.to.addDays(1).toString("yyyy-MM-dd") : QString("9999");
+
+    // trigram 分词下少于 3 个字的词无法走索引；全文索引只覆盖单库布局
+    bool useIndex = searchIndexReady && !partitioned && !terms.isEmpty();
+    for (const QString &term : terms) {
+        if (term.size() < 3) {
+            useIndex = false;
+            break;
+        }
+    }
+
+    if (useIndex) {
+        QSqlQuery query(connection());
+        query.setForwardOnly(true);
+        QStringList phrases;
+        for (QString term : terms) {
+            phrases << "\"" + term.replace("\"", "\"\"") + "\"";
+        }
+
+        // 交易对方命中权重更高
+        query.prepare(
+            QString("SELECT %1, bm25(bill_fts, 1.0, 2.0, 1.0) AS score "
+            "FROM bill_fts "
+            "JOIN bill_record b ON b.id = bill_fts.rowid "
+            "LEFT JOIN counterparty cp ON cp.id = b.counterparty_id "
+            "WHERE bill_fts MATCH :match "
+            "AND b.transaction_date >= :from "
+            "AND b.transaction_date < :to "
+            "ORDER BY score "
+            "LIMIT :limit;"
+            ).arg(BILL_RECORD_COLUMNS)
+        );
+        query.bindValue(":match", phrases.join(" "));
+        query.bindValue(":from", from);
+        query.bindValue(":to", to);
+        query.bindValue(":limit", limit);
+        return fetchBillRecords(query, limit);
+    }
+
+    // 短词退回 LIKE 扫描，按时间倒序；score 固定为 0。
+    // 搜索词中的 \、% 和 _ 按字面匹配，统一以 \ 转义
+    QStringList conditions;
+    for (int i = 0; i < terms.size(); ++i) {
+        conditions << QString("(b.description LIKE :d%1 ESCAPE '\\' OR cp.name LIKE :c%1 ESCAPE '\\' "
+                              "OR b.counterparty LIKE :p%1 ESCAPE '\\' OR b.remark LIKE :r%1 ESCAPE '\\')").arg(i);
+    }
+    if (conditions.isEmpty())
+        conditions << "1";
+
+    int fromYear = range.from.isValid() ? range.from.year() : 0;
+    int toYear = range.to.isValid() ? range.to.year() : 9999;
+
+    // 分区按年份从新到旧分批扫描，每批结果都比下一批新，凑满 limit 条即停
+    QVector<BillRecord> records;
+    forEachBillSource(fromYear, toYear, [&](const QString &source) {
+        QSqlQuery query(connection());
+        query.setForwardOnly(true);
+        query.prepare(
+            QString("SELECT %1, 0 AS score "
+            "FROM %3 b "
+            "LEFT JOIN counterparty cp ON cp.id = b.counterparty_id "
+            "WHERE %2 "
+            "AND b.transaction_date >= :from "
+            "AND b.transaction_date < :to "
+            "ORDER BY b.transaction_date DESC "
+            "LIMIT :limit;"
+            ).arg(BILL_RECORD_COLUMNS, conditions.join(" AND "), source)
+        );
+        for (int i = 0; i < terms.size(); ++i) {
+            QString escaped = terms[i];
+            escaped.replace("\\", "\\\\").replace("%", "\\%").replace("_", "\\_");
+            QString pattern = "%" + escaped + "%";
+            query.bindValue(QString(":d%1").arg(i), pattern);
+            query.bindValue(QString(":c%1").arg(i), pattern);
+            query.bindValue(QString(":p%1").arg(i), pattern);
+            query.bindValue(QString(":r%1").arg(i), pattern);
+        }
+        query.bindValue(":from", from);
+        query.bindValue(":to", to);
+        query.bindValue(":limit", limit - records.size());
+
+        records += fetchBillRecords(query, limit);
+        return !query.lastError().isValid() && records.size() < limit;
+    }, true);
+
+    return records;
 }
 
-// 筛选某年的总支出
-QSqlQuery DatabaseManager::getTotalExpenseByYear(int year)
+// 收支概况：单次扫描，按 transaction_type 条件聚合。%1 数据源，%2 条件
+static const char *SUMMARY_SQL =
+    "SELECT "
+    "SUM(CASE WHEN b.transaction_type = 'income' THEN b.amount ELSE 0 END), "
+    "SUM(CASE WHEN b.transaction_type = 'expense' THEN b.amount ELSE 0 END), "
+    "SUM(b.transaction_type = 'income'), "
+    "SUM(b.transaction_type = 'expense'), "
+    "MAX(CASE WHEN b.transaction_type = 'expense' THEN b.amount ELSE 0 END), "
+    "MAX(CASE WHEN b.transaction_type = 'income' THEN b.amount ELSE 0 END), "
+    "MIN(b.transaction_date), MAX(b.transaction_date), "
+    "MIN(CASE WHEN b.transaction_type = 'expense' THEN b.amount END), "
+    "MIN(CASE WHEN b.transaction_type = 'income' THEN b.amount END) "
+    "FROM %1 b "
+    "WHERE %2;";
+
+static bool fetchSummary(QSqlQuery &query, PeriodSummary *summary)
 {
-    QSqlQuery query;
-    query.prepare(
-        "SELECT SUM(amount) AS total_expense FROM bill_record "
-        "WHERE year = :year "
-        "AND transaction_type = 'expense';"
-    );
-    query.bindValue(":year", year);
-    query.exec();
+    if (!query.exec()) {
+        qDebug() << "周期统计失败:" << query.lastError().text();
+        return false;
+    }
 
-    return query;
+    if (query.next()) {
+        summary->income = query.value(0).toDouble();
+        summary->expense = query.value(1).toDouble();
+        summary->incomeCount = query.value(2).toInt();
+        summary->expenseCount = query.value(3).toInt();
+        summary->maxExpense = query.value(4).toDouble();
+        summary->maxIncome = query.value(5).toDouble();
+        summary->firstRecord = QDateTime::fromString(query.value(6).toString(), "yyyy-MM-dd HH:mm:ss");
+        summary->lastRecord = QDateTime::fromString(query.value(7).toString(), "yyyy-MM-dd HH:mm:ss");
+        // 没有该类型的记录时 MIN 为 NULL，toDouble() 得 0
+        summary->minExpense = query.value(8).toDouble();
+        summary->minIncome = query.value(9).toDouble();
+    }
+    query.finish();
+    return true;
 }
 
-// 筛选某年的总收入
-QSqlQuery DatabaseManager::getTotalIncomeByYear(int year)
+// 合并另一批分区的概况；没有记录的批次不参与最值和首末时间，最小值只在两边都有该类型记录时比较
+static void mergeSummary(PeriodSummary *summary, const PeriodSummary &part)
 {
-    QSqlQuery query;
-    query.prepare(
-        "SELECT SUM(amount) AS total_income FROM bill_record "
-        "WHERE year = :year "
-        "AND transaction_type = 'income';"
-    );
-    query.bindValue(":year", year);
-    query.exec();
+    if (part.incomeCount + part.expenseCount == 0)
+        return;
+    bool first = summary->incomeCount + summary->expenseCount == 0;
+    if (part.expenseCount > 0)
+        summary->minExpense = summary->expenseCount == 0 ? part.minExpense : qMin(summary->minExpense, part.minExpense);
+    if (part.incomeCount > 0)
+        summary->minIncome = summary->incomeCount == 0 ? part.minIncome : qMin(summary->minIncome, part.minIncome);
+    summary->income += part.income;
+    summary->expense += part.expense;
+    summary->incomeCount += part.incomeCount;
+    summary->expenseCount += part.expenseCount;
+    summary->maxExpense = qMax(summary->maxExpense, part.maxExpense);
+    summary->maxIncome = qMax(summary->maxIncome, part.maxIncome);
+    if (first || part.firstRecord < summary->firstRecord)
+        summary->firstRecord = part.firstRecord;
+    if (first || part.lastRecord > summary->lastRecord)
+        summary->lastRecord = part.lastRecord;
+}
 
-    return query;
+// 一个周期的收支概况
+PeriodSummary DatabaseManager::summarize(const PeriodKey &period)
+{
+    QString key = resultKey("summarize", period);
+    quint64 version = periodVersion(results, period);
+    PeriodSummary summary;
+    if (results.lookup(key, version, &summary))
+        return summary;
+
+    QString source = periodSource(period);
+    if (source.isEmpty())
+        return summary;
+
+    QSqlQuery query = conn().statements.statement(QString("summarize.%1").arg(period.kind),
+        QString(SUMMARY_SQL).arg(source, periodCondition(period)));
+    bindPeriod(query, period);
+
+    if (!fetchSummary(query, &summary))
+        return summary;
+
+    results.store(key, version, summary, sizeof(PeriodSummary));
+    return summary;
 }
 
-// 筛选某月的总支出
-QSqlQuery DatabaseManager::getTotalExpenseByMonth(int year, int month)
+// 对比周期的三段区间（闭区间）
+static DateRange comparisonRange(const QDate &start, ComparisonPeriod period, int bucket)
 {
-    QSqlQuery query;
-    query.prepare(
-        "SELECT SUM(amount) AS total_expense FROM bill_record "
-        "WHERE year = :year "
-        "AND month = :month "
-        "AND transaction_type = 'expense';"
-    );
-    query.bindValue(":year", year);
-    query.bindValue(":month", month);
-    query.exec();
+    DateRange range;
+    switch (period) {
+    case CompareWeek:
+        range.from = start.addDays(bucket == PeriodComparison::Current ? 0
+                                   : (bucket == PeriodComparison::Previous ? -7 : -364));
+        range.to = range.from.addDays(6);
+        break;
+    case CompareMonth: {
+        QDate first(start.year(), start.month(), 1);
+        range.from = bucket == PeriodComparison::Current ? first
+                   : (bucket == PeriodComparison::Previous ? first.addMonths(-1) : first.addYears(-1));
+        range.to = range.from.addDays(range.from.daysInMonth() - 1);
+        break;
+    }
+    case CompareYear:
+        range.from = QDate(bucket == PeriodComparison::Current ? start.year() : start.year() - 1, 1, 1);
+        range.to = QDate(range.from.year(), 12, 31);
+        break;
+    }
+    return range;
+}
 
-    return query;
+QString PeriodComparison::changeText(double current, double base)
+{
+    double ratio = 0;
+    if (!change(current, base, &ratio))
+        return "—";
+    return QString("%1%2%").arg(ratio >= 0 ? "↑" : "↓").arg(qAbs(ratio) * 100, 0, 'f', 1);
 }
 
-// 筛选某月的总收入
-QSqlQuery DatabaseManager::getTotalIncomeByMonth(int year, int month)
+static int resultBytes(const PeriodComparison &comparison)
 {
-    QSqlQuery query;
-    query.prepare(
-        "SELECT SUM(amount) AS total_income FROM bill_record "
-        "WHERE year = :year "
-        "AND month = :month "
-        "AND transaction_type = 'income';"
-    );
-    query.bindValue(":year", year);
-    query.bindValue(":month", month);
-    query.exec();
+    int bytes = sizeof(PeriodComparison);
+    for (const QVector<DayTotal> &days : comparison.daily)
+        bytes += days.size() * sizeof(DayTotal);
+    for (const PeriodComparison::Category &category : comparison.categories)
+        bytes += sizeof(PeriodComparison::Category) + 2 * category.name.size();
+    return bytes;
+}
 
-    return query;
+static bool largerCurrent(const PeriodComparison::Category &a, const PeriodComparison::Category &b)
+{
+    double x = a.amount[PeriodComparison::Current];
+    double y = b.amount[PeriodComparison::Current];
+    return x > y || (x == y && a.categoryId < b.categoryId);
 }
 
-// 筛选某周的总支出
-QSqlQuery DatabaseManager::getTotalExpenseByWeek(int year, int week)
+// 三段区间用 OR 连接，SQLite 对每段分别走交易时间覆盖索引；按 天 × 收支 × 分类 分组后在内存中归到各段。
+// 年对比时上一周期与去年同期是同一段，一行会同时计入两段
+PeriodComparison DatabaseManager::comparePeriods(const QDate &start, ComparisonPeriod period)
 {
-    QSqlQuery query;
-    query.prepare(
-        "SELECT SUM(amount) AS total_expense FROM bill_record "
-        "WHERE year = :year "
-        "AND week = :week "
-        "AND transaction_type = 'expense';"
+    PeriodComparison comparison;
+    if (!start.isValid())
+        return comparison;
+
+    int fromYear = start.year();
+    for (int b = 0; b < PeriodComparison::BucketCount; ++b) {
+        comparison.ranges[b] = comparisonRange(start, period, b);
+        fromYear = qMin(fromYear, comparison.ranges[b].from.year());
+    }
+    const DateRange &current = comparison.ranges[PeriodComparison::Current];
+    int toYear = current.to.year();
+
+    QString key = QString("compare|%1|%2").arg(current.from.toString(Qt::ISODate)).arg(period);
+    quint64 version = results.version(fromYear, toYear);
+    if (results.lookup(key, version, &comparison))
+        return comparison;
+
+    for (int b = 0; b < PeriodComparison::BucketCount; ++b) {
+        const DateRange &range = comparison.ranges[b];
+        comparison.daily[b].resize(static_cast<int>(range.from.daysTo(range.to)) + 1);
+        for (int i = 0; i < comparison.daily[b].size(); ++i)
+            comparison.daily[b][i].date = range.from.addDays(i);
+    }
+
+    // 三段区间最多跨两个年份，总在一批附加范围内
+    QString source = billSource(fromYear, toYear);
+    if (source.isEmpty())
+        return comparison;
+
+    QSqlQuery query = conn().statements.statement("compare",
+        QString("SELECT substr(b.transaction_date, 1, 10) AS day, "
+        "b.transaction_type = 'income' AS income, "
+        "COALESCE(b.category_id, 0) AS category, "
+        "SUM(b.amount) "
+        "FROM %1 b "
+        "WHERE (b.transaction_date >= :from0 AND b.transaction_date < :to0) "
+        "OR (b.transaction_date >= :from1 AND b.transaction_date < :to1) "
+        "OR (b.transaction_date >= :from2 AND b.transaction_date < :to2) "
+        "GROUP BY day, income, category;").arg(source)
     );
-    query.bindValue(":year", year);
-    query.bindValue(":week", week);
-    query.exec();
+    for (int b = 0; b < PeriodComparison::BucketCount; ++b) {
+        query.bindValue(QString(":from%1").arg(b), comparison.ranges[b].from.toString("yyyy-MM-dd"));
+        query.bindValue(QString(":to%1").arg(b), comparison.ranges[b].to.addDays(1).toString("yyyy-MM-dd"));
+    }
 
-    return query;
+    if (!query.exec()) {
+        qDebug() << "周期对比查询失败:" << query.lastError().text();
+        return comparison;
+    }
+
+    QHash<qint64, int> categoryIndex;   // (是否收入, 分类) -> categories 下标
+    while (query.next()) {
+        QDate day = QDate::fromString(query.value(0).toString(), "yyyy-MM-dd");
+        bool income = query.value(1).toInt() != 0;
+        int categoryId = query.value(2).toInt();
+        double amount = query.value(3).toDouble();
+
+        qint64 categoryKey = (static_cast<qint64>(income) << 32) | static_cast<quint32>(categoryId);
+        auto found = categoryIndex.constFind(categoryKey);
+        if (found == categoryIndex.constEnd()) {
+            PeriodComparison::Category category;
+            category.categoryId = categoryId;
+            category.income = income;
+            found = categoryIndex.insert(categoryKey, comparison.categories.size());
+            comparison.categories.append(category);
+        }
+        PeriodComparison::Category &category = comparison.categories[found.value()];
+
+        for (int b = 0; b < PeriodComparison::BucketCount; ++b) {
+            const DateRange &range = comparison.ranges[b];
+            if (day < range.from || day > range.to)
+                continue;
+            DayTotal &total = comparison.daily[b][static_cast<int>(range.from.daysTo(day))];
+            if (income) {
+                total.income += amount;
+                comparison.income[b] += amount;
+            } else {
+                total.expense += amount;
+                comparison.expense[b] += amount;
+            }
+            category.amount[b] += amount;
+        }
+    }
+    query.finish();
+
+    QVector<int> categoryIds;
+    for (const PeriodComparison::Category &category : comparison.categories)
+        categoryIds.append(category.categoryId);
+    QStringList names = pivotLabels(PivotCategory, categoryIds);
+    for (int i = 0; i < comparison.categories.size(); ++i)
+        comparison.categories[i].name = names.value(i);
+    std::sort(comparison.categories.begin(), comparison.categories.end(), largerCurrent);
+
+    results.store(key, version, comparison, resultBytes(comparison));
+    return comparison;
+}
+
+// 某年的月度序列
+QVector<double> DatabaseManager::getMonthlySeries(int year, const QString &transactionType)
+{
+    return getMonthlySeries(year, year, transactionType).value(year, QVector<double>(12, 0.0));
+}
+
+// 多年的月度序列，没有记录的年份和月份补 0
+QMap<int, QVector<double> > DatabaseManager::getMonthlySeries(int fromYear, int toYear, const QString &transactionType)
+{
+    QMap<int, QVector<double> > series;
+    for (int year = fromYear; year <= toYear; ++year) {
+        series.insert(year, QVector<double>(12, 0.0));
+    }
+    if (series.isEmpty())
+        return series;
+
+    QString key = QString("monthlySeries|%1|%2|%3").arg(fromYear).arg(toYear).arg(transactionType);
+    quint64 version = results.version(fromYear, toYear);
+    if (results.lookup(key, version, &series))
+        return series;
+
+    // 每批分区各查一次，年份互不重叠，直接填入序列
+    bool ok = true;
+    bool attached = forEachBillSource(fromYear, toYear, [&](const QString &source) {
+        QSqlQuery query = conn().statements.statement("getMonthlySeries",
+            QString("SELECT year, month, SUM(amount) "
+            "FROM %1 "
+            "WHERE year BETWEEN :from_year AND :to_year "
+            "AND transaction_type = :transaction_type "
+            "GROUP BY year, month;").arg(source)
+        );
+        query.bindValue(":from_year", fromYear);
+        query.bindValue(":to_year", toYear);
+        query.bindValue(":transaction_type", transactionType);
+
+        if (!query.exec()) {
+            qDebug() << "月度序列查询失败:" << query.lastError().text();
+            ok = false;
+            return false;
+        }
+
+        while (query.next()) {
+            int year = query.value(0).toInt();
+            int month = query.value(1).toInt();
+            if (!series.contains(year) || month < 1 || month > 12)
+                continue;
+            series[year][month - 1] = query.value(2).toDouble();
+        }
+        query.finish();
+        return true;
+    });
+    if (!ok || !attached)
+        return series;
+
+    results.store(key, version, series, 64 + series.size() * (64 + 12 * sizeof(double)));
+    return series;
+}
+
+// 筛选某年的总支出
+double DatabaseManager::getTotalExpenseByYear(int year)
+{
+    return getTotal(PeriodKey::ofYear(year), "expense");
+}
+
+// 筛选某年的总收入
+double DatabaseManager::getTotalIncomeByYear(int year)
+{
+    return getTotal(PeriodKey::ofYear(year), "income");
+}
+
+// 筛选某月的总支出
+double DatabaseManager::getTotalExpenseByMonth(int year, int month)
+{
+    return getTotal(PeriodKey::ofMonth(year, month), "expense");
+}
+
+// 筛选某月的总收入
+double DatabaseManager::getTotalIncomeByMonth(int year, int month)
+{
+    return getTotal(PeriodKey::ofMonth(year, month), "income");
+}
+
+// 筛选某周的总支出
+double DatabaseManager::getTotalExpenseByWeek(int year, int week)
+{
+    return getTotal(PeriodKey::ofWeek(year, week), "expense");
 }
 
 // 筛选某周的总收入
-QSqlQuery DatabaseManager::getTotalIncomeByWeek(int year, int week)
+double DatabaseManager::getTotalIncomeByWeek(int year, int week)
+{
+    return getTotal(PeriodKey::ofWeek(year, week), "income");
+}
+
+// 筛选某天的总支出和总收入
+DayTotal DatabaseManager::getTotalRecordsByDay(QString date)
 {
-    QSqlQuery query;
+    DayTotal total;
+    total.date = QDate::fromString(date.left(10), "yyyy-MM-dd");
+
+    QSqlQuery query(connection());
+    query.setForwardOnly(true);
     query.prepare(
-        "SELECT SUM(amount) AS total_income FROM bill_record "
-        "WHERE year = :year "
-        "AND week = :week "
-        "AND transaction_type = 'income';"
+        QString("SELECT "
+        "SUM(CASE WHEN transaction_type = 'expense' THEN amount ELSE 0 END) AS total_expense, "
+        "SUM(CASE WHEN transaction_type = 'income' THEN amount ELSE 0 END) AS total_income "
+        "FROM %1 "
+        "WHERE transaction_date >= :from "
+        "AND transaction_date < :to;").arg(billTable(date.left(4).toInt()))
     );
-    query.bindValue(":year", year);
-    query.bindValue(":week", week);
-    query.exec();
+    query.bindValue(":from", date.left(10));
+    query.bindValue(":to", nextDay(date));
+    if (!query.exec()) {
+        qDebug() << "单日统计失败:" << query.lastError().text();
+    } else if (query.next()) {
+        total.expense = query.value(0).toDouble();
+        total.income = query.value(1).toDouble();
+    }
 
-    return query;
+    return total;
+}
+
+// 区间逐日收支
+QVector<DayTotal> DatabaseManager::getDailyTotals(const QDate &fromDay, const QDate &toDay)
+{
+    if (!fromDay.isValid() || !toDay.isValid() || toDay < fromDay)
+        return QVector<DayTotal>();
+
+    RangeFilter filter;
+    filter.from = fromDay;
+    filter.to = toDay;
+    return getRangeDailyTotals(filter);
+}
+
+// 区间条件：交易时间走覆盖索引的范围扫描，上界取次日零点（开区间）；分类和交易方式在索引内过滤
+static QString rangeCondition(const RangeFilter &filter)
+{
+    QString condition = PeriodTraits<PeriodKey::Range>::condition();
+    if (filter.categoryId > 0)
+        condition += " AND b.category_id = :category_id";
+    if (filter.methodId > 0)
+        condition += " AND b.transaction_method_id = :method_id";
+    return condition;
+}
+
+// 语句缓存的键：同一种统计按筛选条件的组合各缓存一条
+static QString rangeStatementId(const char *kind, const RangeFilter &filter)
+{
+    return QString("range.%1.%2%3").arg(kind).arg(filter.categoryId > 0).arg(filter.methodId > 0);
+}
+
+static QString rangeResultKey(const char *kind, const RangeFilter &filter, const QString &transactionType = QString())
+{
+    return QString("range|%1|%2|%3|%4|%5|%6").arg(kind, filter.from.toString(Qt::ISODate), filter.to.toString(Qt::ISODate))
+        .arg(filter.categoryId).arg(filter.methodId).arg(transactionType);
+}
+
+static void bindRange(QSqlQuery &query, const RangeFilter &filter)
+{
+    query.bindValue(":from", filter.from.toString("yyyy-MM-dd"));
+    query.bindValue(":to", filter.to.addDays(1).toString("yyyy-MM-dd"));
+    if (filter.categoryId > 0)
+        query.bindValue(":category_id", filter.categoryId);
+    if (filter.methodId > 0)
+        query.bindValue(":method_id", filter.methodId);
+}
+
+// 未设置的端点取数据的首末日期；没有数据时返回 false
+bool DatabaseManager::resolveRange(RangeFilter *filter)
+{
+    if (!filter->from.isValid() || !filter->to.isValid()) {
+        DateRange span = getDataDateRange();
+        if (!filter->from.isValid())
+            filter->from = span.from;
+        if (!filter->to.isValid())
+            filter->to = span.to;
+    }
+    return filter->from.isValid() && filter->to.isValid() && filter->from <= filter->to;
+}
+
+// 账单的首末交易日期，按交易时间索引各取一端
+DateRange DatabaseManager::getDataDateRange()
+{
+    DateRange range;
+
+    QList<int> years;
+    if (partitioned) {
+        stateLock.lock();
+        years = partitionYears;
+        stateLock.unlock();
+    }
+
+    // 分区模式下最早/最晚的记录在首/末个非空分区中，逐个分区查询仍然只走索引的一端
+    QStringList sources;
+    if (partitioned) {
+        for (int year : years)
+            sources << billTable(year);
+    } else {
+        sources << "bill_record";
+    }
+
+    for (int i = 0; i < sources.size() && !range.from.isValid(); ++i) {
+        QSqlQuery query(connection());
+        query.exec(QString("SELECT MIN(transaction_date) FROM %1;").arg(sources[i]));
+        if (query.next())
+            range.from = QDate::fromString(query.value(0).toString().left(10), "yyyy-MM-dd");
+    }
+    for (int i = sources.size() - 1; i >= 0 && !range.to.isValid(); --i) {
+        QSqlQuery query(connection());
+        query.exec(QString("SELECT MAX(transaction_date) FROM %1;").arg(sources[i]));
+        if (query.next())
+            range.to = QDate::fromString(query.value(0).toString().left(10), "yyyy-MM-dd");
+    }
+    return range;
+}
+
+// 自定义区间的收支概况
+PeriodSummary DatabaseManager::summarizeRange(const RangeFilter &filter)
+{
+    PeriodSummary summary;
+    RangeFilter range = filter;
+    if (!resolveRange(&range))
+        return summary;
+
+    QString key = rangeResultKey("summary", range);
+    quint64 version = results.version(range.from.year(), range.to.year());
+    if (results.lookup(key, version, &summary))
+        return summary;
+
+    // 不按交易方式筛选时走内存索引：合计是树状数组的两次前缀和，笔数和最值扫一遍列式快照，
+    // 多年区间也不再逐个分区扫描账单；索引加载失败时退回下面的 SQL
+    if (range.methodId == 0) {
+        const DailySumIndex &index = dailySums();
+        const BillColumnStore &store = columnStore();
+        if (index.isLoaded() && store.isLoaded()) {
+            BillColumnStore::Extent income = store.extent(range.from, range.to, true, range.categoryId);
+            BillColumnStore::Extent expense = store.extent(range.from, range.to, false, range.categoryId);
+            summary.income = index.rangeSum(range.from, range.to, true, range.categoryId) / 100.0;
+            summary.expense = index.rangeSum(range.from, range.to, false, range.categoryId) / 100.0;
+            summary.incomeCount = income.count;
+            summary.expenseCount = expense.count;
+            summary.maxIncome = income.maxCents / 100.0;
+            summary.maxExpense = expense.maxCents / 100.0;
+            summary.minIncome = income.minCents / 100.0;
+            summary.minExpense = expense.minCents / 100.0;
+            // 快照只记到日，具体时间到首末两天的账单里取，与 SQL 路径的结果一致
+            bool ok = true;
+            if (income.count + expense.count > 0) {
+                qint32 firstDay = income.count == 0 ? expense.firstDay
+                                : expense.count == 0 ? income.firstDay : qMin(income.firstDay, expense.firstDay);
+                qint32 lastDay = qMax(income.lastDay, expense.lastDay);
+                ok = recordTimes(range, QDate::fromJulianDay(firstDay), QDate::fromJulianDay(lastDay), &summary);
+            }
+            if (ok) {
+                results.store(key, version, summary, sizeof(PeriodSummary));
+                return summary;
+            }
+            summary = PeriodSummary();
+        }
+    }
+
+    bool ok = true;
+    bool attached = forEachBillSource(range.from.year(), range.to.year(), [&](const QString &source) {
+        QSqlQuery query = conn().statements.statement(rangeStatementId("summary", range),
+            QString(SUMMARY_SQL).arg(source, rangeCondition(range)));
+        bindRange(query, range);
+
+        PeriodSummary part;
+        ok = fetchSummary(query, &part);
+        mergeSummary(&summary, part);
+        return ok;
+    });
+    if (!ok || !attached)
+        return PeriodSummary();
+
+    results.store(key, version, summary, sizeof(PeriodSummary));
+    return summary;
+}
+
+// 单日查询：最早一笔取首日的 MIN，最晚一笔取末日的 MAX，各自只附加那一年的分区
+bool DatabaseManager::recordTimes(const RangeFilter &range, const QDate &firstDay, const QDate &lastDay, PeriodSummary *summary)
+{
+    const char *kinds[] = { "firstRecord", "lastRecord" };
+    const char *functions[] = { "MIN", "MAX" };
+    QDate days[] = { firstDay, lastDay };
+    QDateTime *targets[] = { &summary->firstRecord, &summary->lastRecord };
+
+    for (int i = 0; i < 2; ++i) {
+        RangeFilter day = range;
+        day.from = day.to = days[i];
+        bool ok = true;
+        bool attached = forEachBillSource(days[i].year(), days[i].year(), [&](const QString &source) {
+            QSqlQuery query = conn().statements.statement(rangeStatementId(kinds[i], day),
+                QString("SELECT %1(b.transaction_date) FROM %2 b WHERE %3;")
+                    .arg(functions[i], source, rangeCondition(day)));
+            bindRange(query, day);
+            if (!query.exec()) {
+                qDebug() << "查询首末交易时间失败:" << query.lastError().text();
+                ok = false;
+                return false;
+            }
+            if (query.next())
+                *targets[i] = QDateTime::fromString(query.value(0).toString(), "yyyy-MM-dd HH:mm:ss");
+            query.finish();
+            return true;
+        });
+        if (!ok || !attached)
+            return false;
+    }
+    return true;
+}
+
+// 自定义区间的逐日收支：一次 GROUP BY，没有记录的日期补 0，结果按日期连续排列；
+// 不按交易方式筛选时直接读区间合计索引的逐日金额
+QVector<DayTotal> DatabaseManager::getRangeDailyTotals(const RangeFilter &filter)
+{
+    QVector<DayTotal> days;
+    RangeFilter range = filter;
+    if (!resolveRange(&range))
+        return days;
+
+    QString key = rangeResultKey("daily", range);
+    quint64 version = results.version(range.from.year(), range.to.year());
+    if (results.lookup(key, version, &days))
+        return days;
+
+    days.resize(static_cast<int>(range.from.daysTo(range.to)) + 1);
+    for (int i = 0; i < days.size(); ++i) {
+        days[i].date = range.from.addDays(i);
+    }
+
+    if (range.methodId == 0) {
+        const DailySumIndex &index = dailySums();
+        if (index.isLoaded()) {
+            QVector<qint64> expense = index.dailyAmounts(range.from, range.to, false, range.categoryId);
+            QVector<qint64> income = index.dailyAmounts(range.from, range.to, true, range.categoryId);
+            for (int i = 0; i < days.size(); ++i) {
+                days[i].expense = expense[i] / 100.0;
+                days[i].income = income[i] / 100.0;
+            }
+            results.store(key, version, days, 64 + days.size() * sizeof(DayTotal));
+            return days;
+        }
+    }
+
+    bool ok = true;
+    bool attached = forEachBillSource(range.from.year(), range.to.year(), [&](const QString &source) {
+        QSqlQuery query = conn().statements.statement(rangeStatementId("daily", range),
+            QString("SELECT substr(b.transaction_date, 1, 10) AS day, "
+            "SUM(CASE WHEN b.transaction_type = 'expense' THEN b.amount ELSE 0 END), "
+            "SUM(CASE WHEN b.transaction_type = 'income' THEN b.amount ELSE 0 END) "
+            "FROM %1 b "
+            "WHERE %2 "
+            "GROUP BY day;").arg(source, rangeCondition(range))
+        );
+        bindRange(query, range);
+
+        if (!query.exec()) {
+            qDebug() << "逐日统计失败:" << query.lastError().text();
+            ok = false;
+            return false;
+        }
+
+        while (query.next()) {
+            QDate day = QDate::fromString(query.value(0).toString(), "yyyy-MM-dd");
+            qint64 index = range.from.daysTo(day);
+            if (index < 0 || index >= days.size())
+                continue;
+            days[index].expense = query.value(1).toDouble();
+            days[index].income = query.value(2).toDouble();
+        }
+        query.finish();
+        return true;
+    });
+    if (!ok || !attached)
+        return days;
+
+    results.store(key, version, days, 64 + days.size() * sizeof(DayTotal));
+    return days;
+}
+
+// 自定义区间的分类排行，与按周期的分类统计共用语句骨架；
+// 不按交易方式筛选时，合计取各分类的区间合计索引，笔数扫一遍列式快照
+QVector<CategoryStat> DatabaseManager::getRangeCategoryStats(const RangeFilter &filter, const QString &transactionType)
+{
+    QVector<CategoryStat> stats;
+    RangeFilter range = filter;
+    if (!resolveRange(&range))
+        return stats;
+
+    QString key = rangeResultKey("categoryStats", range, transactionType);
+    quint64 version = results.version(range.from.year(), range.to.year());
+    if (results.lookup(key, version, &stats))
+        return stats;
+
+    // 同名分类可能出现在多批分区中，按名称合并后重新排序
+    QHash<QString, int> byName;
+    auto merge = [&](const CategoryStat &stat) {
+        auto found = byName.constFind(stat.name);
+        if (found == byName.constEnd()) {
+            byName.insert(stat.name, stats.size());
+            stats.append(stat);
+        } else {
+            stats[found.value()].count += stat.count;
+            stats[found.value()].total += stat.total;
+        }
+    };
+    auto byTotal = [](const CategoryStat &a, const CategoryStat &b) {
+        return a.total > b.total;
+    };
+
+    if (range.methodId == 0) {
+        const DailySumIndex &index = dailySums();
+        const BillColumnStore &store = columnStore();
+        if (index.isLoaded() && store.isLoaded()) {
+            bool income = transactionType == "income";
+            QVector<int> counts;
+            store.categoryTotals(range.from, range.to, income, &counts);
+
+            // 与 SQL 的 JOIN 一致：分类表里没有的 id（含未知分类 0）不参与排行
+            QSqlQuery query(connection());
+            query.setForwardOnly(true);
+            if (query.exec("SELECT id, name FROM category;")) {
+                while (query.next()) {
+                    int id = query.value(0).toInt();
+                    if (id <= 0 || id >= counts.size() || counts[id] == 0)
+                        continue;
+                    if (range.categoryId > 0 && id != range.categoryId)
+                        continue;
+                    CategoryStat stat;
+                    stat.name = query.value(1).toString();
+                    stat.count = counts[id];
+                    stat.total = index.rangeSum(range.from, range.to, income, id) / 100.0;
+                    merge(stat);
+                }
+                std::sort(stats.begin(), stats.end(), byTotal);
+                results.store(key, version, stats, resultBytes(stats));
+                return stats;
+            }
+            qDebug() << "查询分类失败:" << query.lastError().text();
+            stats.clear();
+            byName.clear();
+        }
+    }
+
+    QString typeCondition = transactionType == "income" ? BillTypeTraits<IncomeBills>::condition()
+                                                        : BillTypeTraits<ExpenseBills>::condition();
+    bool ok = true;
+    bool attached = forEachBillSource(range.from.year(), range.to.year(), [&](const QString &source) {
+        QSqlQuery query = conn().statements.statement(
+            rangeStatementId("categoryStats", range) + "." + transactionType,
+            AggregationTraits<CategoryStatsAggregation>::skeleton()
+                .arg(rangeCondition(range), typeCondition, source));
+        bindRange(query, range);
+
+        QVector<CategoryStat> part = fetchCategoryStats(query);
+        if (query.lastError().isValid()) {
+            ok = false;
+            return false;
+        }
+        for (const CategoryStat &stat : part)
+            merge(stat);
+        return true;
+    });
+    if (!ok || !attached)
+        return QVector<CategoryStat>();
+
+    std::sort(stats.begin(), stats.end(), byTotal);
+    results.store(key, version, stats, resultBytes(stats));
+    return stats;
+}
+
+// 透视维度 -> 分组表达式，取值一律是整数
+static QString pivotExpression(PivotDimension dimension)
+{
+    switch (dimension) {
+    case PivotCategory:     return "COALESCE(b.category_id, 0)";
+    case PivotMonth:        return "b.month";
+    case PivotWeek:         return "b.week";
+    // strftime('%w') 周日为 0，换成周一 = 1 ... 周日 = 7
+    case PivotWeekday:      return "(CAST(strftime('%w', substr(b.transaction_date, 1, 10)) AS INTEGER) + 6) % 7 + 1";
+    case PivotMethod:       return "COALESCE(b.transaction_method_id, 0)";
+    case PivotCounterparty: return "COALESCE(b.counterparty_id, 0)";
+    case PivotYear:         return "b.year";
+    case PivotHour:         return "CAST(substr(b.transaction_date, 12, 2) AS INTEGER)";
+    default:                return "0";
+    }
+}
+
+// 透视查询的一行分组结果
+struct PivotGroup {
+    int row;
+    int column;
+    double amount;
+};
+
+static int resultBytes(const PivotTable &table)
+{
+    int bytes = 64 + (table.cells.size() + table.rowTotals.size() + table.columnTotals.size()) * sizeof(double)
+              + (table.rowKeys.size() + table.columnKeys.size()) * sizeof(int);
+    for (const QString &label : table.rowLabels + table.columnLabels)
+        bytes += 16 + 2 * label.size();
+    return bytes;
+}
+
+// 某个维度取值的显示名称；字典类维度一次查出整张字典
+QStringList DatabaseManager::pivotLabels(PivotDimension dimension, const QVector<int> &keys)
+{
+    static const char *weekdayNames[] = { "周一", "周二", "周三", "周四", "周五", "周六", "周日" };
+
+    QHash<int, QString> names;
+    const char *table = nullptr;
+    if (dimension == PivotCategory)
+        table = "category";
+    else if (dimension == PivotMethod)
+        table = "transaction_method";
+    else if (dimension == PivotCounterparty)
+        table = "counterparty";
+    if (table) {
+        QSqlQuery query(connection());
+        query.setForwardOnly(true);
+        if (query.exec(QString("SELECT id, name FROM %1;").arg(table))) {
+            while (query.next())
+                names.insert(query.value(0).toInt(), query.value(1).toString());
+        } else {
+            qDebug() << "查询透视维度名称失败:" << query.lastError().text();
+        }
+    }
+
+    QStringList labels;
+    for (int key : keys) {
+        switch (dimension) {
+        case PivotMonth:    labels << QString("%1月").arg(key); break;
+        case PivotWeek:     labels << QString("第%1周").arg(key); break;
+        case PivotWeekday:  labels << ((key >= 1 && key <= 7) ? QString(weekdayNames[key - 1]) : QString::number(key)); break;
+        case PivotYear:     labels << QString::number(key); break;
+        case PivotHour:     labels << QString("%1时").arg(key); break;
+        default:            labels << names.value(key, key == 0 ? QString("未分类") : QString::number(key)); break;
+        }
+    }
+    return labels;
+}
+
+// 任意两个维度的透视：一次 GROUP BY 行, 列 查询，结果铺进稠密矩阵
+PivotTable DatabaseManager::pivot(const RangeFilter &filter, PivotDimension rows, PivotDimension columns,
+                                  const QString &transactionType)
+{
+    PivotTable table;
+    table.rowDimension = rows;
+    table.columnDimension = columns;
+    RangeFilter range = filter;
+    if (!resolveRange(&range))
+        return table;
+
+    QString key = rangeResultKey("pivot", range, transactionType) + QString("|%1|%2").arg(rows).arg(columns);
+    quint64 version = results.version(range.from.year(), range.to.year());
+    if (results.lookup(key, version, &table))
+        return table;
+
+    QString typeCondition = transactionType == "income" ? BillTypeTraits<IncomeBills>::condition()
+                                                        : BillTypeTraits<ExpenseBills>::condition();
+    // 先收集分组结果，确定行列取值后再一次性铺进矩阵；
+    // 分批查询时同一 (行, 列) 可能出现多次，铺矩阵时累加
+    QVector<PivotGroup> groups;
+    QMap<int, int> rowIndex;
+    QMap<int, int> columnIndex;
+    // 月份、星期几和小时的取值固定，没有记录的行列也保留，矩阵形状不随数据变化；
+    // 行列可以是同一维度，两边各自铺一遍
+    auto prefill = [](PivotDimension dimension, QMap<int, int> *index) {
+        int first = dimension == PivotHour ? 0 : 1;
+        int last = dimension == PivotMonth ? 12 : (dimension == PivotWeekday ? 7 : (dimension == PivotHour ? 23 : 0));
+        for (int k = first; k <= last; ++k)
+            index->insert(k, 0);
+    };
+    prefill(rows, &rowIndex);
+    prefill(columns, &columnIndex);
+    bool ok = true;
+    bool attached = forEachBillSource(range.from.year(), range.to.year(), [&](const QString &source) {
+        QSqlQuery query = conn().statements.statement(
+            rangeStatementId("pivot", range) + QString(".%1.%2.%3").arg(rows).arg(columns).arg(transactionType),
+            QString("SELECT %1 AS r, %2 AS c, SUM(b.amount) "
+            "FROM %3 b "
+            "WHERE %4 AND %5 "
+            "GROUP BY r, c;").arg(pivotExpression(rows), pivotExpression(columns),
+                                 source, rangeCondition(range), typeCondition)
+        );
+        bindRange(query, range);
+
+        if (!query.exec()) {
+            qDebug() << "透视查询失败:" << query.lastError().text();
+            ok = false;
+            return false;
+        }
+        while (query.next()) {
+            PivotGroup cell = { query.value(0).toInt(), query.value(1).toInt(), query.value(2).toDouble() };
+            groups.append(cell);
+            rowIndex.insert(cell.row, 0);
+            columnIndex.insert(cell.column, 0);
+        }
+        query.finish();
+        return true;
+    });
+    if (!ok || !attached)
+        return table;
+
+    for (auto it = rowIndex.begin(); it != rowIndex.end(); ++it) {
+        it.value() = table.rowKeys.size();
+        table.rowKeys.append(it.key());
+    }
+    for (auto it = columnIndex.begin(); it != columnIndex.end(); ++it) {
+        it.value() = table.columnKeys.size();
+        table.columnKeys.append(it.key());
+    }
+
+    const int columnCount = table.columnKeys.size();
+    table.cells.fill(0, table.rowKeys.size() * columnCount);
+    table.rowTotals.fill(0, table.rowKeys.size());
+    table.columnTotals.fill(0, columnCount);
+    for (const PivotGroup &cell : groups) {
+        int r = rowIndex.value(cell.row);
+        int c = columnIndex.value(cell.column);
+        table.cells[r * columnCount + c] += cell.amount;
+        table.rowTotals[r] += cell.amount;
+        table.columnTotals[c] += cell.amount;
+        table.grandTotal += cell.amount;
+    }
+
+    table.rowLabels = pivotLabels(rows, table.rowKeys);
+    table.columnLabels = pivotLabels(columns, table.columnKeys);
+
+    results.store(key, version, table, resultBytes(table));
+    return table;
+}
+
+// 分类字典（id -> 名称），供筛选下拉框使用
+QMap<int, QString> DatabaseManager::getCategories(const QString &transactionType)
+{
+    QMap<int, QString> categories;
+    QSqlQuery query(connection());
+    query.prepare("SELECT id, name FROM category WHERE type = :type;");
+    query.bindValue(":type", transactionType);
+    if (!query.exec()) {
+        qDebug() << "查询分类失败:" << query.lastError().text();
+        return categories;
+    }
+    while (query.next()) {
+        categories.insert(query.value(0).toInt(), query.value(1).toString());
+    }
+    return categories;
 }
 
-// 筛选某天的总支出和总收入
-QSqlQuery DatabaseManager::getTotalRecordsByDay(QString date)
+// 一组交易对方的名称，一次 IN 查询
+QHash<int, QString> DatabaseManager::counterpartyNames(const QVector<int> &ids)
 {
-    QSqlQuery query;
-    // 此处更改
-    // 原：WHERE transaction_date = :date;
-    //字符串加%
-    query.prepare(
-        "SELECT "
-        "SUM(CASE WHEN transaction_type = 'expense' THEN amount ELSE 0 END) AS total_expense, "
-        "SUM(CASE WHEN transaction_type = 'income' THEN amount ELSE 0 END) AS total_income "
-        "FROM bill_record "
-        "WHERE transaction_date LIKE :date;"
-    );
-    query.bindValue(":date", date+"%");
-    query.exec();
+    QHash<int, QString> names;
+    if (ids.isEmpty())
+        return names;
+
+    QStringList placeholders;
+    for (int id : ids)
+        placeholders << QString::number(id);
+    QSqlQuery query(connection());
+    query.setForwardOnly(true);
+    if (!query.exec(QString("SELECT id, name FROM counterparty WHERE id IN (%1);").arg(placeholders.join(",")))) {
+        qDebug() << "查询交易对方名称失败:" << query.lastError().text();
+        return names;
+    }
+    while (query.next())
+        names.insert(query.value(0).toInt(), query.value(1).toString());
+    return names;
+}
 
-    return query;
+// 交易对方排行：账单不多时在列式快照上精确分组，区间很大时合并按月维护的有界摘要
+QVector<MerchantStat> DatabaseManager::getTopMerchants(const QDate &from, const QDate &to, const QString &transactionType, int limit)
+{
+    QVector<MerchantStat> stats;
+    RangeFilter range;
+    range.from = from;
+    range.to = to;
+    if (!resolveRange(&range))
+        return stats;
+
+    bool exact = true;
+    QHash<int, int> counts;
+    QVector<HeavyHitters::Entry> entries = merchants.top(columnStore(), range.from, range.to,
+                                                         transactionType == "income", limit, &exact, &counts);
+
+    QVector<int> ids;
+    for (const HeavyHitters::Entry &entry : entries)
+        ids.append(entry.key);
+    QHash<int, QString> names = counterpartyNames(ids);
+
+    for (const HeavyHitters::Entry &entry : entries) {
+        MerchantStat stat;
+        stat.counterpartyId = entry.key;
+        stat.name = names.value(entry.key);
+        stat.total = entry.weight / 100.0;
+        stat.upperBound = (entry.weight + entry.error) / 100.0;
+        stat.count = counts.value(entry.key);
+        stat.exact = exact;
+        stats.append(stat);
+    }
+    return stats;
 }
 
-// 查询某年的支出分类统计
-QSqlQuery DatabaseManager::getExpenseCategoryStatsByYear(int year)
+// 某个交易对方的逐月走势，走 counterparty_id 索引
+QVector<MerchantMonth> DatabaseManager::getMerchantTrend(int counterpartyId, const QDate &from, const QDate &to, const QString &transactionType)
 {
-    QSqlQuery query;
-    query.prepare(
-        "SELECT c.name, COUNT(b.id) AS bill_count, SUM(b.amount) AS total_amount "
-        "FROM bill_record b "
-        "JOIN category c ON b.category_id = c.id "
-        "WHERE year = :year "
-        "AND b.transaction_type = 'expense' "
-        "GROUP BY c.name "
-        "ORDER BY total_amount DESC;"
-    );
-    query.bindValue(":year", year);
-    query.exec();
+    QVector<MerchantMonth> months;
+    RangeFilter range;
+    range.from = from;
+    range.to = to;
+    if (counterpartyId <= 0 || !resolveRange(&range))
+        return months;
+
+    QString key = rangeResultKey("merchantTrend", range, transactionType) + QString("|%1").arg(counterpartyId);
+    quint64 version = results.version(range.from.year(), range.to.year());
+    if (results.lookup(key, version, &months))
+        return months;
+
+    QString typeCondition = transactionType == "income" ? BillTypeTraits<IncomeBills>::condition()
+                                                        : BillTypeTraits<ExpenseBills>::condition();
+    // 分批按年份从旧到新，各批结果直接拼接仍按年月有序
+    bool ok = true;
+    bool attached = forEachBillSource(range.from.year(), range.to.year(), [&](const QString &source) {
+        QSqlQuery query = conn().statements.statement("merchantTrend." + transactionType,
+            QString("SELECT b.year, b.month, SUM(b.amount), COUNT(*) "
+            "FROM %1 b "
+            "WHERE b.counterparty_id = :counterparty_id AND %2 AND %3 "
+            "GROUP BY b.year, b.month "
+            "ORDER BY b.year, b.month;").arg(source, PeriodTraits<PeriodKey::Range>::condition(), typeCondition)
+        );
+        bindRange(query, range);
+        query.bindValue(":counterparty_id", counterpartyId);
 
-    return query;
+        if (!query.exec()) {
+            qDebug() << "查询交易对方走势失败:" << query.lastError().text();
+            ok = false;
+            return false;
+        }
+        while (query.next()) {
+            MerchantMonth month;
+            month.year = query.value(0).toInt();
+            month.month = query.value(1).toInt();
+            month.total = query.value(2).toDouble();
+            month.count = query.value(3).toInt();
+            months.append(month);
+        }
+        query.finish();
+        return true;
+    });
+    if (!ok || !attached)
+        return QVector<MerchantMonth>();
+
+    results.store(key, version, months, 64 + months.size() * sizeof(MerchantMonth));
+    return months;
 }
 
-// 查询某年的收入分类统计
-QSqlQuery DatabaseManager::getIncomeCategoryStatsByYear(int year)
+// 在列式快照上做一次排序扫描；交易对方字典整体读出用于名称规范化
+bool DatabaseManager::detectRecurringCharges()
 {
-    QSqlQuery query;
-    query.prepare(
-        "SELECT c.name, COUNT(b.id) AS bill_count, SUM(b.amount) AS total_amount "
-        "FROM bill_record b "
-        "JOIN category c ON b.category_id = c.id "
-        "WHERE year = :year "
-        "AND b.transaction_type = 'income' "
-        "GROUP BY c.name "
-        "ORDER BY total_amount DESC;"
-    );
-    query.bindValue(":year", year);
-    query.exec();
+    if (!ready)
+        return false;
 
-    return query;
+    QHash<int, QString> names;
+    QSqlQuery query(connection());
+    query.setForwardOnly(true);
+    if (!query.exec("SELECT id, name FROM counterparty;")) {
+        qDebug() << "读取交易对方字典失败:" << query.lastError().text();
+        return false;
+    }
+    while (query.next())
+        names.insert(query.value(0).toInt(), query.value(1).toString());
+    query.finish();
+
+    return recurring.store(RecurringDetector::detect(columnStore(), names, QDate::currentDate()));
 }
 
-// 查询某月的支出分类统计
-QSqlQuery DatabaseManager::getExpenseCategoryStatsByMonth(int year, int month)
+QVector<RecurringCharge> DatabaseManager::getRecurringCharges()
 {
-    QSqlQuery query;
-    query.prepare(
-        "SELECT c.name, COUNT(b.id) AS bill_count, SUM(b.amount) AS total_amount "
-        "FROM bill_record b "
-        "JOIN category c ON b.category_id = c.id "
-        "WHERE year = :year "
-        "AND month = :month "
-        "AND b.transaction_type = 'expense' "
-        "GROUP BY c.name "
-        "ORDER BY total_amount DESC;"
-    );
-    query.bindValue(":year", year);
-    query.bindValue(":month", month);
-    query.exec();
-
-    return query;
+    return recurringCharges(recurring.series());
 }
 
-// 查询某月的收入分类统计
-QSqlQuery DatabaseManager::getIncomeCategoryStatsByMonth(int year, int month)
+// 检测结果补上交易对方名称，一次 IN 查询
+QVector<RecurringCharge> DatabaseManager::recurringCharges(const QVector<RecurringDetector::Series> &series)
 {
-    QSqlQuery query;
-    query.prepare(
-        "SELECT c.name, COUNT(b.id) AS bill_count, SUM(b.amount) AS total_amount "
-        "FROM bill_record b "
-        "JOIN category c ON b.category_id = c.id "
-        "WHERE year = :year "
-        "AND month = :month "
-        "AND b.transaction_type = 'income' "
-        "GROUP BY c.name "
-        "ORDER BY total_amount DESC;"
-    );
-    query.bindValue(":year", year);
-    query.bindValue(":month", month);
-    query.exec();
+    QVector<RecurringCharge> charges;
+    if (series.isEmpty())
+        return charges;
+
+    QVector<int> ids;
+    for (const RecurringDetector::Series &item : series)
+        ids.append(item.counterpartyId);
+    QHash<int, QString> names = counterpartyNames(ids);
+
+    charges.reserve(series.size());
+    for (const RecurringDetector::Series &item : series) {
+        RecurringCharge charge;
+        charge.counterpartyId = item.counterpartyId;
+        charge.name = names.value(item.counterpartyId);
+        charge.cadence = RecurringDetector::cadenceName(item.cadence);
+        charge.amount = item.cents / 100.0;
+        charge.occurrences = item.occurrences;
+        charge.lastDate = item.lastDate;
+        charge.nextDate = item.nextDate;
+        charges.append(charge);
+    }
+    return charges;
+}
 
-    return query;
+static bool earlierCharge(const RecurringCharge &a, const RecurringCharge &b)
+{
+    return a.nextDate < b.nextDate || (a.nextDate == b.nextDate && a.amount > b.amount);
 }
 
-// 查询某周的支出分类统计
-QSqlQuery DatabaseManager::getExpenseCategoryStatsByWeek(int year, int week)
+// 从最近一次扣费起按周期向后推，落在区间内的每一次都列出
+QVector<RecurringCharge> DatabaseManager::getUpcomingCharges(const QDate &from, const QDate &to)
 {
-    QSqlQuery query;
-    query.prepare(
-        "SELECT c.name, COUNT(b.id) AS bill_count, SUM(b.amount) AS total_amount "
-        "FROM bill_record b "
-        "JOIN category c ON b.category_id = c.id "
-        "WHERE year = :year "
-        "AND week = :week "
-        "AND b.transaction_type = 'expense' "
-        "GROUP BY c.name "
-        "ORDER BY total_amount DESC;"
-    );
-    query.bindValue(":year", QString::number(year));
-    query.bindValue(":week", QString::number(week).rightJustified(2, '0'));
-    query.exec();
+    QVector<RecurringCharge> upcoming;
+    if (!from.isValid() || !to.isValid() || to < from)
+        return upcoming;
+
+    QVector<RecurringDetector::Series> series = recurring.series();
+    QVector<RecurringCharge> charges = recurringCharges(series);
+    for (int i = 0; i < charges.size(); ++i) {
+        for (int k = 1; ; ++k) {
+            QDate day = RecurringDetector::advance(series[i].lastDate, series[i].cadence, k);
+            if (day > to)
+                break;
+            if (day < from)
+                continue;
+            RecurringCharge charge = charges[i];
+            charge.nextDate = day;
+            upcoming.append(charge);
+        }
+    }
+    std::sort(upcoming.begin(), upcoming.end(), earlierCharge);
+    return upcoming;
+}
 
-    return query;
+QMap<int, double> DatabaseManager::getBudgets()
+{
+    QMap<int, double> result;
+    QHash<int, qint64> limits = budgetTracker().limits();
+    for (auto it = limits.constBegin(); it != limits.constEnd(); ++it)
+        result.insert(it.key(), it.value() / 100.0);
+    return result;
 }
 
-// 查询某周的收入分类统计
-QSqlQuery DatabaseManager::getIncomeCategoryStatsByWeek(int year, int week)
+bool DatabaseManager::setBudget(int categoryId, double amount)
 {
-    QSqlQuery query;
-    query.prepare(
-        "SELECT c.name, COUNT(b.id) AS bill_count, SUM(b.amount) AS total_amount "
-        "FROM bill_record b "
-        "JOIN category c ON b.category_id = c.id "
-        "WHERE year = :year "
-        "AND week = :week "
-        "AND b.transaction_type = 'income' "
-        "GROUP BY c.name "
-        "ORDER BY total_amount DESC;"
-    );
-    query.bindValue(":year", year);
-    query.bindValue(":week", week);
-    query.exec();
+    if (!ready)
+        return false;
 
-    return query;
+    WriteScope write(this);
+    QSqlQuery query(connection());
+    if (amount > 0) {
+        query.prepare("INSERT OR REPLACE INTO budget(category_id, amount) VALUES (:category_id, :amount);");
+        query.bindValue(":amount", amount);
+    } else {
+        query.prepare("DELETE FROM budget WHERE category_id = :category_id;");
+    }
+    query.bindValue(":category_id", categoryId);
+
+    if (!query.exec()) {
+        qDebug() << "保存预算失败:" << query.lastError().text();
+        return false;
+    }
+    // 额度变化不影响支出计数器，只改这一项；尚未加载时下次使用会读到新值
+    if (budgets.isLoaded())
+        budgets.setLimit(categoryId, amount > 0 ? BillColumnStore::toCents(amount) : 0);
+    return true;
 }
 
-// 查询某年的总支出金额评价
-QString DatabaseManager::getTopCategoryByYearWithComment(int year, const QString &transactionType)
+// 预算额度首次使用时加载；某月的支出计数器在第一次评估该月时由一次分组查询装入
+// 额度和计数器都在锁外读出，经 loadIndex 确认期间没有写入后再装入：
+// 装入前落在未装入月份的写入会被 apply 忽略，快照又不含它，直接装入会让计数器永久偏低
+const BudgetTracker &DatabaseManager::budgetTracker(const QDate &month)
 {
-    // 查询总金额（支出或收入）
-        QSqlQuery totalQuery;
-        totalQuery.prepare(
-            "SELECT SUM(amount) AS total_amount FROM bill_record "
-            "WHERE year = :year "
-            "AND transaction_type = :transaction_type;"
-        );
-        totalQuery.bindValue(":year", QString::number(year));
-        totalQuery.bindValue(":transaction_type", transactionType);
-        totalQuery.exec();
-
-        double totalAmount = 0;
-        if (totalQuery.next()) {
-            totalAmount = totalQuery.value("total_amount").toDouble();
+    QHash<int, qint64> limits;
+    loadIndex(&budgetsLoadLock, [this] { return budgets.isLoaded(); }, [this, &limits] {
+        QSqlQuery query(connection());
+        query.setForwardOnly(true);
+        if (!query.exec("SELECT category_id, CAST(ROUND(amount * 100) AS INTEGER) FROM budget;")) {
+            qDebug() << "加载预算失败:" << query.lastError().text();
+            return false;
         }
-
-        // 查询每个分类的统计（支出或收入）
-        QSqlQuery query;
+        limits = BudgetTracker::readLimits(query);
+        return true;
+    }, [this, &limits] { budgets.loadLimits(limits); });
+
+    if (!month.isValid())
+        return budgets;
+
+    QHash<int, qint64> totals;
+    loadIndex(&budgetsLoadLock, [this, month] { return budgets.hasMonth(month); }, [this, month, &totals] {
+        PeriodKey period = PeriodKey::ofMonth(month.year(), month.month());
+        QSqlQuery query(connection());
+        query.setForwardOnly(true);
         query.prepare(
-            "SELECT c.name, COUNT(b.id) AS bill_count, SUM(b.amount) AS total_amount "
-            "FROM bill_record b "
-            "JOIN category c ON b.category_id = c.id "
-            "WHERE year = :year "
-            "AND b.transaction_type = :transaction_type "
-            "GROUP BY c.name;"
+            QString("SELECT COALESCE(category_id, 0), SUM(CAST(ROUND(amount * 100) AS INTEGER)) "
+            "FROM %1 "
+            "WHERE year = :year AND month = :month AND transaction_type = 'expense' "
+            "GROUP BY category_id;").arg(periodSource(period))
         );
-        query.bindValue(":year", QString::number(year));
-        query.bindValue(":transaction_type", transactionType);
-        query.exec();
-
-        // 查找占比最大的分类
-        double maxPercentage = 0;
-        QString topCategoryName;
-        double topCategoryTotal = 0;
-        while (query.next()) {
-            QString categoryName = query.value("name").toString();
-            double categoryTotal = query.value("total_amount").toDouble();
-
-            // 计算占比
-            double percentage = (totalAmount > 0) ? (categoryTotal / totalAmount) * 100 : 0;
-
-            // 更新占比最大的分类
-            if (percentage > maxPercentage) {
-                maxPercentage = percentage;
-                topCategoryName = categoryName;
-                topCategoryTotal = categoryTotal;
-            }
+        query.bindValue(":year", month.year());
+        query.bindValue(":month", month.month());
+        if (!query.exec()) {
+            qDebug() << "加载预算计数器失败:" << query.lastError().text();
+            return false;
         }
+        totals = BudgetTracker::readMonth(query);
+        return true;
+    }, [this, month, &totals] { budgets.loadMonth(month, totals); });
+    return budgets;
+}
 
-        // 获取对应的评论
-        QString comment;
-        if (!topCategoryName.isEmpty()) {
-            QSqlQuery commentQuery;
-
-            commentQuery.prepare(
-                "SELECT comment FROM comment "
-                "WHERE category_id = (SELECT id FROM category WHERE name = :category_name "
-                "AND type = :transaction_type);"
-            );
-            commentQuery.bindValue(":category_name", topCategoryName);
-            //commentQuery.bindValue(":transaction_type", transactionType);
-            //暂且这样获得评论
-            commentQuery.bindValue(":transaction_type", "expense");
-            if(!commentQuery.exec()){
-
-                qDebug()<< "获取年评论错误：" << commentQuery.lastError();
-            }
+static bool moreOverBudget(const BudgetStatus &a, const BudgetStatus &b)
+{
+    return a.spent * b.limit > b.spent * a.limit;
+}
 
-            if (commentQuery.next()) {
-                comment = commentQuery.value("comment").toString();
+// 评估只读计数器，与账单条数无关；超支分类再从树状数组找出越线的那一天
+QVector<BudgetStatus> DatabaseManager::evaluateBudgets(int year, int month)
+{
+    QVector<BudgetStatus> result;
+    QDate first(year, month, 1);
+    QVector<BudgetTracker::Status> entries = budgetTracker(first).evaluate(first);
+    if (entries.isEmpty())
+        return result;
+
+    QMap<int, QString> names = getCategories("expense");
+    QDate last = first.addDays(first.daysInMonth() - 1);
+    result.reserve(entries.size());
+    for (const BudgetTracker::Status &entry : entries) {
+        BudgetStatus status;
+        status.categoryId = entry.categoryId;
+        status.name = names.value(entry.categoryId);
+        status.limit = entry.limitCents / 100.0;
+        status.spent = entry.spentCents / 100.0;
+
+        if (entry.spentCents > entry.limitCents) {
+            const DailySumIndex &index = dailySums();
+            qint64 before = index.rangeSum(QDate(), first.addDays(-1), false, entry.categoryId);
+            QVector<qint64> running = index.cumulative(first, last, false, entry.categoryId);
+            for (int i = 0; i < running.size(); ++i) {
+                if (running[i] - before > entry.limitCents) {
+                    status.exceededOn = first.addDays(i);
+                    break;
+                }
             }
         }
+        result.append(status);
+    }
+    std::sort(result.begin(), result.end(), moreOverBudget);
+    return result;
+}
 
-
-    qDebug() << "top分类: " << topCategoryName;
-    qDebug() << "总成交量: " << topCategoryTotal;
-    qDebug() << "金额占比: " << maxPercentage << "%";
-    qDebug() << "评论: " << comment;
-
-    return comment;
+// 异常基线：逐条支出只在首次使用时读一遍，之后由写入路径增量维护
+const AnomalyDetector &DatabaseManager::anomalyDetector()
+{
+    AnomalyDetector fresh;
+    loadIndex(&anomaliesLoadLock, [this] { return anomalies.isLoaded(); }, [this, &fresh] {
+        fresh.clear();
+        bool ok = scanHistory(
+            "SELECT CAST(julianday(substr(transaction_date, 1, 10)) + 0.5 AS INTEGER), "
+            "COALESCE(category_id, 0), "
+            "CAST(ROUND(amount * 100) AS INTEGER) "
+            "FROM %1 "
+            "WHERE transaction_type = 'expense';",
+            [&fresh](QSqlQuery &query) { fresh.load(query); });
+        if (!ok) {
+            qDebug() << "加载异常检测基线失败";
+            return false;
+        }
+        fresh.finishLoad();
+        return true;
+    }, [this, &fresh] { anomalies.adopt(fresh); });
+    return anomalies;
 }
 
+// 当天支出达到近 30 天日均的这个倍数也算异常，弥补星期几基线样本不足的情况
+static const double ROLLING_MULTIPLE = 4.0;
+static const qint64 ROLLING_MIN_CENTS = 10000;
 
-// 按月筛选总金额占比最大的分类的评论
-QString DatabaseManager::getTopCategoryByMonthWithComment(int year, int month, const QString &transactionType)
+static bool earlierAnomaly(const SpendAnomaly &a, const SpendAnomaly &b)
 {
-    // 查询某月的总金额
-    QSqlQuery totalQuery;
-    totalQuery.prepare(
-        "SELECT SUM(amount) AS total_amount FROM bill_record "
-        "WHERE year = :year "
-        "AND month = :month "
-        "AND transaction_type = :transaction_type;"
-    );
-    totalQuery.bindValue(":year", QString::number(year));
-    totalQuery.bindValue(":month", QString::number(month).rightJustified(2, '0'));  // 保证月份是两位数
-    totalQuery.bindValue(":transaction_type", transactionType);
-    totalQuery.exec();
+    if (a.date != b.date)
+        return a.date < b.date;
+    return a.recordId < b.recordId;
+}
 
-    double totalAmount = 0;
-    if (totalQuery.next()) {
-        totalAmount = totalQuery.value("total_amount").toDouble();
-    }
+// 每笔支出和每一天都只是一次哈希查找加常数次运算；滚动日均取前一天结尾的 30 天窗口
+QVector<SpendAnomaly> DatabaseManager::getAnomalies(const QDate &from, const QDate &to)
+{
+    QVector<SpendAnomaly> result;
+    if (!from.isValid() || !to.isValid() || from > to)
+        return result;
 
-    // 查询每个分类的金额总和
-    QSqlQuery query;
-    query.prepare(
-        "SELECT c.name, COUNT(b.id) AS bill_count, SUM(b.amount) AS total_amount "
-        "FROM bill_record b "
-        "JOIN category c ON b.category_id = c.id "
-        "WHERE year = :year "
-        "AND month = :month "
-        "AND b.transaction_type = :transaction_type "
-        "GROUP BY c.name;"
-    );
-    query.bindValue(":year", QString::number(year));
-    query.bindValue(":month", QString::number(month).rightJustified(2, '0'));
-    query.bindValue(":transaction_type", transactionType);
-    query.exec();
+    const AnomalyDetector &detector = anomalyDetector();
+    QMap<int, QString> names = getCategories("expense");
+    static const char *WEEKDAYS[] = { "周一", "周二", "周三", "周四", "周五", "周六", "周日" };
 
-    // 查找占比最大的分类
-    double maxPercentage = 0;
-    QString topCategoryName;
-    double topCategoryTotal = 0;
-    while (query.next()) {
-        QString categoryName = query.value("name").toString();
-        double categoryTotal = query.value("total_amount").toDouble();
+    for (const BillColumnStore::Row &row : columnStore().rows(from, to, false)) {
+        AnomalyDetector::Score score;
+        if (!detector.scoreRecord(row.cents, row.categoryId, &score))
+            continue;
+        SpendAnomaly anomaly;
+        anomaly.date = QDate::fromJulianDay(row.day);
+        anomaly.recordId = row.id;
+        anomaly.category = names.value(row.categoryId, "其他");
+        anomaly.amount = row.cents / 100.0;
+        anomaly.baseline = score.mean / 100.0;
+        anomaly.zScore = score.zScore;
+        anomaly.reason = QString("%1单笔平均 ￥%2，这笔高出 %3 个标准差")
+                             .arg(anomaly.category)
+                             .arg(anomaly.baseline, 0, 'f', 2)
+                             .arg(score.zScore, 0, 'f', 1);
+        result.append(anomaly);
+    }
 
-        // 计算占比
-        double percentage = (totalAmount > 0) ? (categoryTotal / totalAmount) * 100 : 0;
+    QVector<DailySumIndex::WindowPoint> window = dailySums().rolling(from.addDays(-1), to.addDays(-1), false);
+    for (QDate day = from; day <= to; day = day.addDays(1)) {
+        AnomalyDetector::Score score;
+        bool weekdayHigh = detector.scoreDay(day, &score);
+        qint64 cents = detector.dayCents(day);
+        int index = from.daysTo(day);
+        double average30 = index < window.size()
+            ? window[index].totalCents[DailySumIndex::Days30] / double(DailySumIndex::windowDays(DailySumIndex::Days30))
+            : 0;
+        bool rollingHigh = average30 > 0 && cents >= ROLLING_MIN_CENTS && cents >= average30 * ROLLING_MULTIPLE;
+        if (!weekdayHigh && !rollingHigh)
+            continue;
 
-        // 更新占比最大的分类
-        if (percentage > maxPercentage) {
-            maxPercentage = percentage;
-            topCategoryName = categoryName;
-            topCategoryTotal = categoryTotal;
+        SpendAnomaly anomaly;
+        anomaly.date = day;
+        anomaly.amount = cents / 100.0;
+        QStringList reasons;
+        if (weekdayHigh) {
+            anomaly.baseline = score.mean / 100.0;
+            anomaly.zScore = score.zScore;
+            reasons << QString("%1平均支出 ￥%2，当天高出 %3 个标准差")
+                           .arg(WEEKDAYS[day.dayOfWeek() - 1])
+                           .arg(anomaly.baseline, 0, 'f', 2)
+                           .arg(score.zScore, 0, 'f', 1);
         }
+        if (rollingHigh) {
+            if (!weekdayHigh)
+                anomaly.baseline = average30 / 100.0;
+            reasons << QString("约为近 30 天日均 ￥%1 的 %2 倍")
+                           .arg(average30 / 100.0, 0, 'f', 2)
+                           .arg(cents / average30, 0, 'f', 1);
+        }
+        anomaly.reason = QString("当天支出 ￥%1：%2").arg(anomaly.amount, 0, 'f', 2).arg(reasons.join("，"));
+        result.append(anomaly);
     }
 
-    // 获取对应的评论
-    QString comment;
-    if (!topCategoryName.isEmpty()) {
-        QSqlQuery commentQuery;
-        commentQuery.prepare(
-            "SELECT comment FROM comment "
-            "WHERE category_id = (SELECT id FROM category WHERE name = :category_name "
-            "AND type = :transaction_type);"
-        );
-        commentQuery.bindValue(":category_name", topCategoryName);
-        //commentQuery.bindValue(":transaction_type", transactionType);
-        //暂且这样获得评论
-        commentQuery.bindValue(":transaction_type", "expense");
-        if(!commentQuery.exec()){
+    std::sort(result.begin(), result.end(), earlierAnomaly);
+    return result;
+}
 
-            qDebug()<< "获取月评论错误：" << commentQuery.lastError();
-        }
+// 区间合计走内存中的树状数组，不再扫描账单
+double DatabaseManager::getRangeTotal(const QDate &from, const QDate &to, const QString &transactionType, int categoryId)
+{
+    return dailySums().rangeSum(from, to, transactionType == "income", categoryId) / 100.0;
+}
 
-        if (commentQuery.next()) {
-            comment = commentQuery.value("comment").toString();
-        }
+// 累计结余：从最早的账单起收入减支出，逐日累加
+QVector<double> DatabaseManager::getRunningBalance(const QDate &from, const QDate &to)
+{
+    const DailySumIndex &index = dailySums();
+    QVector<qint64> income = index.cumulative(from, to, true);
+    QVector<qint64> expense = index.cumulative(from, to, false);
+
+    QVector<double> balance(income.size());
+    for (int i = 0; i < income.size(); ++i)
+        balance[i] = (income[i] - expense[i]) / 100.0;
+    return balance;
+}
+
+// 滚动窗口由区间合计索引的前缀和相减得到，不再按窗口逐个查询
+QVector<RollingPoint> DatabaseManager::getRollingMetrics(const QDate &from, const QDate &to, const QString &transactionType, int categoryId)
+{
+    QVector<RollingPoint> result;
+    QVector<DailySumIndex::WindowPoint> points = dailySums().rolling(from, to, transactionType == "income", categoryId);
+    result.reserve(points.size());
+    for (const DailySumIndex::WindowPoint &point : points) {
+        RollingPoint item;
+        item.date = point.date;
+        item.total7 = point.totalCents[DailySumIndex::Days7] / 100.0;
+        item.total30 = point.totalCents[DailySumIndex::Days30] / 100.0;
+        item.total90 = point.totalCents[DailySumIndex::Days90] / 100.0;
+        item.average7 = item.total7 / DailySumIndex::windowDays(DailySumIndex::Days7);
+        item.average30 = item.total30 / DailySumIndex::windowDays(DailySumIndex::Days30);
+        item.average90 = item.total90 / DailySumIndex::windowDays(DailySumIndex::Days90);
+        result.append(item);
     }
+    return result;
+}
 
-    qDebug() << "top分类: " << topCategoryName;
-    qDebug() << "总成交量: " << topCategoryTotal;
-    qDebug() << "金额占比: " << maxPercentage << "%";
-    qDebug() << "评论: " << comment;
+// 查询某年的支出分类统计
+QVector<CategoryStat> DatabaseManager::getExpenseCategoryStatsByYear(int year)
+{
+    return getCategoryStats(PeriodKey::ofYear(year), "expense");
+}
 
-    return comment;
+// 查询某年的收入分类统计
+QVector<CategoryStat> DatabaseManager::getIncomeCategoryStatsByYear(int year)
+{
+    return getCategoryStats(PeriodKey::ofYear(year), "income");
 }
 
-// 按周筛选总金额占比最大的分类的评论
-QString DatabaseManager::getTopCategoryByWeekWithComment(int year, int week, const QString &transactionType)
+// 查询某月的支出分类统计
+QVector<CategoryStat> DatabaseManager::getExpenseCategoryStatsByMonth(int year, int month)
 {
-    // 查询某周的总金额
-    QSqlQuery totalQuery;
-    totalQuery.prepare(
-        "SELECT SUM(amount) AS total_amount FROM bill_record "
-        "WHERE year = :year "
-        "AND week = :week "
-        "AND transaction_type = :transaction_type;"
-    );
-    totalQuery.bindValue(":year", QString::number(year));
-    totalQuery.bindValue(":week", QString::number(week).rightJustified(2, '0'));  // 保证周数是两位数
-    totalQuery.bindValue(":transaction_type", transactionType);
-    totalQuery.exec();
+    return getCategoryStats(PeriodKey::ofMonth(year, month), "expense");
+}
+
+// 查询某月的收入分类统计
+QVector<CategoryStat> DatabaseManager::getIncomeCategoryStatsByMonth(int year, int month)
+{
+    return getCategoryStats(PeriodKey::ofMonth(year, month), "income");
+}
+
+// 查询某周的支出分类统计
+QVector<CategoryStat> DatabaseManager::getExpenseCategoryStatsByWeek(int year, int week)
+{
+    return getCategoryStats(PeriodKey::ofWeek(year, week), "expense");
+}
+
+// 查询某周的收入分类统计
+QVector<CategoryStat> DatabaseManager::getIncomeCategoryStatsByWeek(int year, int week)
+{
+    return getCategoryStats(PeriodKey::ofWeek(year, week), "income");
+}
 
-    double totalAmount = 0;
-    if (totalQuery.next()) {
-        totalAmount = totalQuery.value("total_amount").toDouble();
+// 分类评价来自静态种子数据，首次使用时整表读入；同名的收入/支出分类共用评价，先插入的优先
+QString DatabaseManager::categoryComment(const QString &categoryName)
+{
+    QMutexLocker locker(&stateLock);
+    if (!commentCacheLoaded) {
+        QSqlQuery query(connection());
+        query.setForwardOnly(true);
+        query.exec(
+            "SELECT c.name, cm.comment FROM comment cm "
+            "JOIN category c ON c.id = cm.category_id "
+            "ORDER BY cm.id;"
+        );
+        while (query.next()) {
+            QString name = query.value(0).toString();
+            if (!commentCache.contains(name))
+                commentCache.insert(name, query.value(1).toString());
+        }
+        commentCacheLoaded = true;
     }
+    return commentCache.value(categoryName);
+}
 
-    // 查询每个分类的金额总和
-    QSqlQuery query;
-    query.prepare(
-        "SELECT c.name, COUNT(b.id) AS bill_count, SUM(b.amount) AS total_amount "
-        "FROM bill_record b "
-        "JOIN category c ON b.category_id = c.id "
-        "WHERE year = :year "
-        "AND week = :week "
+// 周期内金额占比最大的分类及其评价：一条语句分组、排序取第一，占比由窗口函数在同一次扫描中算出
+QString DatabaseManager::topCategoryComment(const PeriodKey &period, const QString &transactionType)
+{
+    QString key = resultKey("topCategory", period, transactionType);
+    quint64 version = periodVersion(results, period);
+    QString cached;
+    if (results.lookup(key, version, &cached))
+        return cached;
+
+    QString source = periodSource(period);
+    if (source.isEmpty())
+        return QString();
+
+    // 未匹配到分类的账单计入总额但不参与排名
+    QSqlQuery query = conn().statements.statement(QString("topCategory.%1").arg(period.kind),
+        QString("SELECT c.name, SUM(b.amount) AS total_amount, "
+        "SUM(b.amount) / SUM(SUM(b.amount)) OVER () AS share "
+        "FROM %1 b "
+        "LEFT JOIN category c ON b.category_id = c.id "
+        "WHERE %2 "
         "AND b.transaction_type = :transaction_type "
-        "GROUP BY c.name;"
+        "GROUP BY c.name "
+        "ORDER BY c.name IS NULL, total_amount DESC "
+        "LIMIT 1;").arg(source, periodCondition(period))
     );
-    query.bindValue(":year", QString::number(year));
-    query.bindValue(":week", QString::number(week).rightJustified(2, '0'));
+    bindPeriod(query, period);
     query.bindValue(":transaction_type", transactionType);
-    query.exec();
 
-    // 查找占比最大的分类
-    double maxPercentage = 0;
+    if (!query.exec()) {
+        qDebug() << "获取分类评价错误：" << query.lastError();
+        return QString();
+    }
+
     QString topCategoryName;
     double topCategoryTotal = 0;
-    while (query.next()) {
-        QString categoryName = query.value("name").toString();
-        double categoryTotal = query.value("total_amount").toDouble();
-
-        // 计算占比
-        double percentage = (totalAmount > 0) ? (categoryTotal / totalAmount) * 100 : 0;
-
-        // 更新占比最大的分类
-        if (percentage > maxPercentage) {
-            maxPercentage = percentage;
-            topCategoryName = categoryName;
-            topCategoryTotal = categoryTotal;
-        }
+    double percentage = 0;
+    if (query.next()) {
+        topCategoryName = query.value(0).toString();
+        topCategoryTotal = query.value(1).toDouble();
+        percentage = query.value(2).toDouble() * 100;
     }
+    query.finish();
 
-    // 获取对应的评论
-    QString comment;
-    if (!topCategoryName.isEmpty()) {
-        QSqlQuery commentQuery;
-
-        commentQuery.prepare(
-            "SELECT comment FROM comment "
-            "WHERE category_id = (SELECT id FROM category WHERE name = :category_name "
-            "AND type = :transaction_type);"
-            );
-        commentQuery.bindValue(":category_name", topCategoryName);
-        //commentQuery.bindValue(":transaction_type", transactionType);
-        //暂且这样获得评论
-        commentQuery.bindValue(":transaction_type", "expense");
-        if(!commentQuery.exec()){
-
-            qDebug()<< "获取周评论错误：" << commentQuery.lastError();
-        }
-
-        if (commentQuery.next()) {
-            comment = commentQuery.value("comment").toString();
-        }
-    }
+    QString comment = topCategoryName.isEmpty() ? QString() : categoryComment(topCategoryName);
 
     qDebug() << "top分类: " << topCategoryName;
     qDebug() << "总成交量: " << topCategoryTotal;
-    qDebug() << "金额占比: " << maxPercentage << "%";
+    qDebug() << "金额占比: " << percentage << "%";
     qDebug() << "评论: " << comment;
 
+    results.store(key, version, comment, 64 + 2 * comment.size());
     return comment;
 }
 
+// 查询某年的总支出金额评价
+QString DatabaseManager::getTopCategoryByYearWithComment(int year, const QString &transactionType)
+{
+    return topCategoryComment(PeriodKey::ofYear(year), transactionType);
+}
+
+// 按月筛选总金额占比最大的分类的评论
+QString DatabaseManager::getTopCategoryByMonthWithComment(int year, int month, const QString &transactionType)
+{
+    return topCategoryComment(PeriodKey::ofMonth(year, month), transactionType);
+}
+
+// 按周筛选总金额占比最大的分类的评论
+QString DatabaseManager::getTopCategoryByWeekWithComment(int year, int week, const QString &transactionType)
+{
+    return topCategoryComment(PeriodKey::ofWeek(year, week), transactionType);
+}
+
 // 修改某条消费记录
 void DatabaseManager::updateRecord(int id, double amount, QString transaction_type, QString transactionDate, int categoryId, int methodId, QString counterparty, QString description, QString source_id, QString remark) {
+    WriteScope write(this);
     // 处理年/月/周
     QDateTime dt = QDateTime::fromString(transactionDate, "yyyy-MM-dd HH:mm:ss");
     int year = dt.date().year();
@@ -971,23 +3283,69 @@ void DatabaseManager::updateRecord(int id, double amount, QString transaction_ty
         source_id = "";
     }
 
-    QSqlQuery query;
-    query.prepare(
-        "UPDATE bill_record SET "
-        "transaction_date = :transaction_date, "
-        "year = :year, "
-        "month = :month, "
-        "week = :week, "
-        "amount = :amount, "
-        "transaction_type = :transaction_type, "
-        "category_id = :category_id, "
-        "transaction_method_id = :method_id, "
-        "counterparty = :counterparty, "
-        "description = :description, "
-        "source_id = :source_id, "
-        "remark = :remark "
-        "WHERE id = :id"
-    );
+    QString table = "bill_record";
+    int oldYear = recordYear(id);
+    if (partitioned && oldYear == 0) {
+        qDebug() << "修改记录失败: 找不到记录" << id;
+        return;
+    }
+
+    // 内存索引已加载时先记下旧值，更新成功后从旧日期减去、在新日期加上
+    QDate oldDay;
+    qint64 oldCents = 0;
+    bool oldIncome = false;
+    int oldCategoryId = 0;
+    bool patchDaily = (sums.isLoaded() || columns.isLoaded() || budgets.isLoaded()
+                       || anomalies.isLoaded())
+        && recordFacts(partitioned ? billTable(oldYear) : table, id, &oldDay, &oldCents, &oldIncome, &oldCategoryId);
+
+    // ATTACH 不能在事务中执行：新旧两个年份的分区都在事务开始前附加好
+    QString oldTable = table;
+    if (partitioned) {
+        oldTable = billTable(oldYear);
+        table = billTable(year, true);
+        if (oldTable == EMPTY_BILL_SOURCE || table == EMPTY_BILL_SOURCE) {
+            qDebug() << "修改记录失败: 无法附加分区" << oldYear << year;
+            return;
+        }
+    }
+    int counterpartyId = internCounterparty(counterparty);
+
+    // 日期跨年时在新年份的分区按新值插入、从旧分区删除，两步在同一事务中，失败时整体回滚
+    bool moving = partitioned && oldYear != year;
+    QSqlQuery query(connection());
+    if (moving) {
+        query.prepare(
+            QString("INSERT INTO %1("
+            "id, transaction_date, year, month, week, "
+            "amount, transaction_type, "
+            "category_id, transaction_method_id, "
+            "counterparty, counterparty_id, description, source_id, remark"
+            ") VALUES ("
+            ":id, :transaction_date, :year, :month, :week, "
+            ":amount, :transaction_type, "
+            ":category_id, :method_id, "
+            "NULL, :counterparty_id, :description, :source_id, :remark)").arg(table)
+        );
+    } else {
+        query.prepare(
+            QString("UPDATE %1 SET "
+            "transaction_date = :transaction_date, "
+            "year = :year, "
+            "month = :month, "
+            "week = :week, "
+            "amount = :amount, "
+            "transaction_type = :transaction_type, "
+            "category_id = :category_id, "
+            "transaction_method_id = :method_id, "
+            "counterparty = NULL, "
+            "counterparty_id = :counterparty_id, "
+            "description = :description, "
+            "source_id = :source_id, "
+            "remark = :remark "
+            "WHERE id = :id").arg(table)
+        );
+    }
 
     query.bindValue(":transaction_date", transactionDate);
     query.bindValue(":year", year);
@@ -997,22 +3355,59 @@ void DatabaseManager::updateRecord(int id, double amount, QString transaction_ty
     query.bindValue(":transaction_type", transaction_type);
     query.bindValue(":category_id", categoryId);
     query.bindValue(":method_id", methodId);
-    query.bindValue(":counterparty", counterparty);
+    query.bindValue(":counterparty_id", counterpartyIdValue(counterpartyId));
     query.bindValue(":description", description);
     query.bindValue(":source_id", source_id);
     query.bindValue(":remark", remark);
     query.bindValue(":id", id);
 
-    if (!query.exec()) {
+    bool ok;
+    if (moving) {
+        ok = primary.db.transaction();
+        if (ok)
+            ok = query.exec();
+        if (ok) {
+            QSqlQuery remove(connection());
+            remove.prepare(QString("DELETE FROM %1 WHERE id = :id;").arg(oldTable));
+            remove.bindValue(":id", id);
+            ok = remove.exec() && remove.numRowsAffected() == 1;
+            if (!ok)
+                qDebug() << "跨分区移动记录失败: " << remove.lastError();
+        }
+        if (ok)
+            ok = primary.db.commit();
+        if (!ok)
+            primary.db.rollback();
+    } else {
+        ok = query.exec();
+    }
+    if (!ok) {
         qDebug() << "修改记录失败: " << query.lastError();
     }
     else {
+        results.invalidateYear(oldYear);
+        results.invalidateYear(year);
+        columns.remove(id);
+        columns.insert(id, dt.date(), BillColumnStore::toCents(amount), transaction_type == "income",
+                       categoryId, counterpartyId);
+        if (patchDaily) {
+            qint64 cents = BillColumnStore::toCents(amount);
+            sums.apply(oldDay, -oldCents, oldIncome, oldCategoryId);
+            sums.apply(dt.date(), cents, transaction_type == "income", categoryId);
+            budgets.apply(oldDay, -oldCents, oldIncome, oldCategoryId);
+            budgets.apply(dt.date(), cents, transaction_type == "income", categoryId);
+            anomalies.apply(oldDay, -oldCents, oldIncome, oldCategoryId);
+            anomalies.apply(dt.date(), cents, transaction_type == "income", categoryId);
+            merchants.invalidate(oldDay);
+        }
+        merchants.invalidate(dt.date());
         qDebug() << "修改记录成功: ";
     }
 }
 
 // 新增一条消费记录
 void DatabaseManager::addRecord(double amount, QString transaction_type, QString transactionDate, int categoryId, int methodId, QString counterparty, QString description, QString source_id, QString remark) {
+    WriteScope write(this);
     // 处理年/月/周
     QDateTime dt = QDateTime::fromString(transactionDate, "yyyy-MM-dd HH:mm:ss");
     int year = dt.date().year();
@@ -1022,23 +3417,30 @@ void DatabaseManager::addRecord(double amount, QString transaction_type, QString
     int weekYear;
     week = dt.date().weekNumber(&weekYear);
 
-    QSqlQuery query;
+    QSqlQuery query(connection());
     query.prepare(
-            "INSERT INTO bill_record("
-            "transaction_date, year, month, week, "
+            QString("INSERT INTO %1("
+            "id, transaction_date, year, month, week, "
             "amount, transaction_type, "
             "category_id, transaction_method_id, "
-            "counterparty, description, source_id, remark"
+            "counterparty_id, description, source_id, remark"
             ") VALUES ("
-            ":transaction_date, :year, :month, :week, "
+            ":id, :transaction_date, :year, :month, :week, "
             ":amount, :transaction_type, "
             ":category_id, :method_id, "
-            ":counterparty, :description, :source_id, :remark)"
+            ":counterparty_id, :description, :source_id, :remark)").arg(billTable(year, true))
         );
 
     if (methodId == 1) {
         source_id = "";
     }
+    // 单库布局下 id 为 NULL，由 AUTOINCREMENT 分配
+    qint64 newId = partitioned ? allocateBillId() : 0;
+    if (newId < 0) {
+        qDebug() << "添加记录失败: 无法分配账单 id";
+        return;
+    }
+    query.bindValue(":id", partitioned ? QVariant(newId) : QVariant(QVariant::LongLong));
     query.bindValue(":transaction_date", transactionDate);
     query.bindValue(":year", year);
     query.bindValue(":month", month);
@@ -1047,7 +3449,8 @@ void DatabaseManager::addRecord(double amount, QString transaction_type, QString
     query.bindValue(":transaction_type", transaction_type);
     query.bindValue(":category_id", categoryId);
     query.bindValue(":method_id", methodId);
-    query.bindValue(":counterparty", counterparty);
+    int counterpartyId = internCounterparty(counterparty);
+    query.bindValue(":counterparty_id", counterpartyIdValue(counterpartyId));
     query.bindValue(":description", description);
     query.bindValue(":source_id", source_id);
     query.bindValue(":remark", remark);
@@ -1056,14 +3459,42 @@ void DatabaseManager::addRecord(double amount, QString transaction_type, QString
         qDebug() << "添加记录失败: " << query.lastError();
     }
     else {
+        if (!partitioned)
+            newId = query.lastInsertId().toLongLong();
+        columns.insert(static_cast<int>(newId), dt.date(), BillColumnStore::toCents(amount),
+                       transaction_type == "income", categoryId, counterpartyId);
+        sums.apply(dt.date(), BillColumnStore::toCents(amount), transaction_type == "income", categoryId);
+        budgets.apply(dt.date(), BillColumnStore::toCents(amount), transaction_type == "income", categoryId);
+        anomalies.apply(dt.date(), BillColumnStore::toCents(amount), transaction_type == "income", categoryId);
+        merchants.invalidate(dt.date());
+        results.invalidateYear(year);
         qDebug() << "添加记录成功: ";
     }
 }
 
 // 删除某条记录
 void DatabaseManager::deleteRecord(int id) {
-    QSqlQuery query;
-    query.prepare("DELETE FROM bill_record WHERE id = :id");
+    WriteScope write(this);
+    QString table = "bill_record";
+    int year = recordYear(id);
+    if (partitioned) {
+        if (year == 0) {
+            qDebug() << "删除记录失败: 找不到记录" << id;
+            return;
+        }
+        table = billTable(year);
+    }
+
+    QDate oldDay;
+    qint64 oldCents = 0;
+    bool oldIncome = false;
+    int oldCategoryId = 0;
+    bool patchDaily = (sums.isLoaded() || columns.isLoaded() || budgets.isLoaded()
+                       || anomalies.isLoaded())
+        && recordFacts(table, id, &oldDay, &oldCents, &oldIncome, &oldCategoryId);
+
+    QSqlQuery query(connection());
+    query.prepare(QString("DELETE FROM %1 WHERE id = :id").arg(table));
 
     query.bindValue(":id", id);
 
@@ -1071,34 +3502,80 @@ void DatabaseManager::deleteRecord(int id) {
         qDebug() << "删除记录失败: " << query.lastError();
     }
     else {
+        columns.remove(id);
+        if (patchDaily) {
+            sums.apply(oldDay, -oldCents, oldIncome, oldCategoryId);
+            budgets.apply(oldDay, -oldCents, oldIncome, oldCategoryId);
+            anomalies.apply(oldDay, -oldCents, oldIncome, oldCategoryId);
+            merchants.invalidate(oldDay);
+        }
+        results.invalidateYear(year);
         qDebug() << "删除记录成功: ";
     }
 }
 
+// 在全部分区中查找已存在的交易单号；ATTACH 不能在事务中执行，须在事务外调用
+bool DatabaseManager::findExistingSourceIds(const QStringList &sourceIds, QSet<QString> *found)
+{
+    // 每条语句的绑定参数个数受 SQLITE_MAX_VARIABLE_NUMBER 限制，分段查询
+    static const int CHUNK = 500;
+    bool ok = true;
+    bool attached = forEachBillSource(0, 9999, [&](const QString &source) {
+        for (int i = 0; i < sourceIds.size(); i += CHUNK) {
+            QStringList chunk = sourceIds.mid(i, CHUNK);
+            QStringList placeholders;
+            for (int k = 0; k < chunk.size(); ++k)
+                placeholders << "?";
+
+            QSqlQuery query(connection());
+            query.setForwardOnly(true);
+            query.prepare(QString("SELECT source_id FROM %1 WHERE source_id IN (%2);")
+                          .arg(source, placeholders.join(",")));
+            for (int k = 0; k < chunk.size(); ++k)
+                query.bindValue(k, chunk[k]);
+            if (!query.exec()) {
+                qDebug() << "交易单号查重失败:" << query.lastError().text();
+                ok = false;
+                return false;
+            }
+            while (query.next())
+                found->insert(query.value(0).toString());
+        }
+        return true;
+    });
+    return ok && attached;
+}
+
 // 根据交易单号查询账单 ID
 int DatabaseManager::getBillIdByTransactionNumber(QString sourceId) {
-    QSqlQuery query;
-    query.prepare("SELECT id FROM bill_record WHERE source_id = :source_id");
+    int id = -1;
+    // 分区模式下从最近的年份查起，找到即停
+    forEachBillSource(0, 9999, [&](const QString &source) {
+        QSqlQuery query = conn().statements.statement("getBillIdByTransactionNumber",
+            QString("SELECT id FROM %1 WHERE source_id = :source_id").arg(source));
 
-    query.bindValue(":source_id", sourceId);
+        query.bindValue(":source_id", sourceId);
 
-    if (!query.exec()) {
-        qDebug() << "Error fetching bill ID by transaction number: " << query.lastError();
-        return -1; // 返回-1表示查询失败
-    }
+        if (!query.exec()) {
+            qDebug() << "Error fetching bill ID by transaction number: " << query.lastError();
+            return false; // 返回-1表示查询失败
+        }
 
-    if (query.next()) {
-        return query.value(0).toInt(); // 返回账单 ID
-    }
+        if (query.next())
+            id = query.value(0).toInt(); // 返回账单 ID
+        query.finish();
+        return id == -1;
+    }, true);
 
-    return -1; // 如果没有找到结果，返回-1
+    return id; // 如果没有找到结果，返回-1
 }
 
 // 根据交易时间查询消费订单ID
 int DatabaseManager::getExpenseBillIdByDate(QString transactionDate) {
     int billId = -1;
-    QSqlQuery query;
-    query.prepare("SELECT id FROM bill_record WHERE transaction_date = :transaction_date AND transaction_type = 'expense'");
+    QSqlQuery query = conn().statements.statement("getExpenseBillIdByDate",
+        QString("SELECT id FROM %1 WHERE transaction_date = :transaction_date AND transaction_type = 'expense'")
+        .arg(billTable(transactionDate.left(4).toInt())));
 
     query.bindValue(":transaction_date", transactionDate);
 
@@ -1109,14 +3586,16 @@ int DatabaseManager::getExpenseBillIdByDate(QString transactionDate) {
 
     query.next();
     billId = query.value(0).toInt();
+    query.finish();
     return billId;
 }
 
 // 根据交易时间查询收入订单ID
 int DatabaseManager::getIncomeBillIdByDate(QString transactionDate) {
     int billId = -1;
-    QSqlQuery query;
-    query.prepare("SELECT id FROM bill_record WHERE transaction_date = :transaction_date AND transaction_type = 'income'");
+    QSqlQuery query = conn().statements.statement("getIncomeBillIdByDate",
+        QString("SELECT id FROM %1 WHERE transaction_date = :transaction_date AND transaction_type = 'income'")
+        .arg(billTable(transactionDate.left(4).toInt())));
 
     query.bindValue(":transaction_date", transactionDate);
 
@@ -1127,5 +3606,6 @@ int DatabaseManager::getIncomeBillIdByDate(QString transactionDate) {
 
     query.next();
     billId = query.value(0).toInt();
+    query.finish();
     return billId;
 }
@@ -4,10 +4,228 @@
 #include <QSqlDatabase>
 #include <QDateTime>
 #include <QVariantList>
+#include <QHash>
+#include <QVector>
+#include <QMap>
+#include <QSet>
+#include <QDate>
+#include <QSqlQuery>
+#include <QThreadStorage>
+#include <QMutex>
+#include <functional>
+#include <atomic>
+
+#include "bill_column_store.h"
+#include "daily_sum_index.h"
+#include "pivot_table.h"
+#include "merchant_ranking.h"
+#include "budget_tracker.h"
+#include "recurring_detector.h"
+#include "anomaly_detector.h"
+#include "statement_cache.h"
+#include "query_result_cache.h"
+
+// 闭区间日期范围，无效日期表示该端不设限
+struct DateRange
+{
+    QDate from;
+    QDate to;
+};
+
+// 自定义区间统计的筛选条件：闭区间日期（无效日期表示取数据的首/末日期），分类和交易方式为 0 表示不限
+struct RangeFilter
+{
+    QDate from;
+    QDate to;
+    int categoryId = 0;
+    int methodId = 0;
+};
+
+// 统计周期：年 / 月 / 周 / 季度对应 bill_record 的 year、month、week 列，自定义区间按交易时间
+struct PeriodKey
+{
+    enum Kind { Year, Month, Week, Quarter, Range };
+
+    Kind kind;
+    int year;
+    int value;   // 月份、周数或季度（1-4），按年和区间统计时为 0
+    QDate from;  // 仅 Range 使用，闭区间
+    QDate to;
+
+    static PeriodKey ofYear(int year) { PeriodKey k = { Year, year, 0 }; return k; }
+    static PeriodKey ofMonth(int year, int month) { PeriodKey k = { Month, year, month }; return k; }
+    static PeriodKey ofWeek(int year, int week) { PeriodKey k = { Week, year, week }; return k; }
+    static PeriodKey ofQuarter(int year, int quarter) { PeriodKey k = { Quarter, year, quarter }; return k; }
+    static PeriodKey ofRange(const QDate &from, const QDate &to) { PeriodKey k = { Range, from.year(), 0, from, to }; return k; }
+};
+
+// 一条账单记录
+struct BillRecord
+{
+    int id = 0;
+    QString transactionDate;    // yyyy-MM-dd HH:mm:ss
+    int year = 0;
+    int month = 0;
+    int week = 0;
+    double amount = 0;
+    QString transactionType;    // income / expense
+    int categoryId = 0;
+    int methodId = 0;
+    QString counterparty;
+    QString description;
+    QString remark;
+    QString sourceId;
+    int counterpartyId = 0;
+    double score = 0;           // 仅全文检索结果有效，越小越相关
+};
+
+// 分类排行中的一项
+struct CategoryStat
+{
+    QString name;
+    int count = 0;
+    double total = 0;
+};
+
+// 某一天的收支合计
+struct DayTotal
+{
+    QDate date;
+    double expense = 0;
+    double income = 0;
+};
+
+// 一个周期的收支概况，由一次条件聚合扫描得到
+struct PeriodSummary
+{
+    double income = 0;
+    double expense = 0;
+    int incomeCount = 0;
+    int expenseCount = 0;
+    double maxExpense = 0;      // 单笔最大支出/收入，无记录时为 0
+    double maxIncome = 0;
+    double minExpense = 0;      // 单笔最小支出/收入，无记录时为 0
+    double minIncome = 0;
+    QDateTime firstRecord;      // 最早/最晚一笔的交易时间，无记录时无效
+    QDateTime lastRecord;
+};
+
+// 周期对比的粒度：决定上一周期和去年同期怎么推算
+enum ComparisonPeriod {
+    CompareWeek = 0,    // 上周；去年同期取 52 周前的那一周，星期几对齐
+    CompareMonth,       // 上个月；去年同月
+    CompareYear         // 去年；去年同期与上一周期相同
+};
+
+// 一个周期与上一周期、去年同期的收支对比，三段区间由一次查询得到
+struct PeriodComparison
+{
+    enum Bucket { Current = 0, Previous = 1, LastYear = 2, BucketCount = 3 };
+
+    // 一个分类在三段周期的金额
+    struct Category {
+        int categoryId = 0;
+        QString name;
+        bool income = false;
+        double amount[BucketCount] = { 0, 0, 0 };
+    };
+
+    DateRange ranges[BucketCount];
+    double expense[BucketCount] = { 0, 0, 0 };
+    double income[BucketCount] = { 0, 0, 0 };
+    QVector<DayTotal> daily[BucketCount];   // 每段从首日起逐日，没有记录的日期补 0
+    QVector<Category> categories;           // 按本期金额降序
+
+    // 本期相对对比值的变化比例（0.12 表示多 12%）；对比值为 0 时没有意义，返回 false
+    static bool change(double current, double base, double *ratio)
+    {
+        if (base <= 0)
+            return false;
+        *ratio = (current - base) / base;
+        return true;
+    }
+    // 变化的显示文字，如 "↑12.3%"、"↓3.1%"，对比值为 0 时为 "—"
+    static QString changeText(double current, double base);
+};
+
+// 以某天结尾的 7/30/90 天滚动合计与日均
+struct RollingPoint
+{
+    QDate date;
+    double total7 = 0;
+    double total30 = 0;
+    double total90 = 0;
+    double average7 = 0;
+    double average30 = 0;
+    double average90 = 0;
+};
+
+// 交易对方排行中的一项；区间很大时为近似值，真实金额在 [total, upperBound] 内
+struct MerchantStat
+{
+    int counterpartyId = 0;
+    QString name;
+    double total = 0;
+    double upperBound = 0;
+    int count = 0;              // 仅精确结果有效
+    bool exact = true;
+};
+
+// 某个交易对方一个月的合计
+struct MerchantMonth
+{
+    int year = 0;
+    int month = 0;
+    double total = 0;
+    int count = 0;
+};
+
+// 周期性扣费（订阅、房租等）：一个检测出的序列，或它在某段日期内推算出的一次扣费
+struct RecurringCharge
+{
+    int counterpartyId = 0;
+    QString name;
+    QString cadence;            // 每周 / 每月 / 每年
+    double amount = 0;          // 最近一次扣费金额
+    int occurrences = 0;
+    QDate lastDate;
+    QDate nextDate;             // 下一次扣费日期；推算结果中为区间内的那一次
+};
+
+// 一个分类某月的预算执行情况
+struct BudgetStatus
+{
+    int categoryId = 0;
+    QString name;
+    double limit = 0;
+    double spent = 0;
+    QDate exceededOn;           // 当月累计支出第一次超过额度的日期，未超支时无效
+
+    bool isOver() const { return spent > limit; }
+};
+
+// 一条支出异常：单笔账单（recordId > 0）或一整天（recordId 为 0）
+struct SpendAnomaly
+{
+    QDate date;
+    int recordId = 0;
+    QString category;           // 单笔异常的分类
+    double amount = 0;          // 单笔金额或当天支出合计
+    double baseline = 0;        // 对比的基线：同分类单笔均值、同星期几日均或近 30 天日均
+    double zScore = 0;          // 偏离基线的标准差倍数；只因高于近 30 天日均而标记时为 0
+    QString reason;
+};
 
 class DatabaseManager
 {
 public:
+    // 按年分区时单个年份文件的打开方式
+    enum PartitionMode {
+        PartitionReadWrite = 0,
+        PartitionReadOnly = 1,   // 只读附加，写入会失败
+        PartitionImmutable = 2   // 只读且声明文件不会再变，SQLite 跳过加锁与变更检测
+    };
+
     static DatabaseManager& instance();
 
     // 创建表
@@ -15,35 +233,133 @@ public:
     bool createTables();
     void insertDefaultTables();
     bool isReady() const;
+    QString databasePath() const;
+
+    // 导入支付宝账单：整个文件在一个事务中写入，失败时全部回滚并返回 false
+    bool importAlipayCsv(const QString &csvPath);
+
+    /*按年分区存储（可选）：app.db 只保留字典表，账单按年份写入 app_<year>.db，按需 ATTACH*/
+    bool isPartitioned() const;
+    // 把单库中的账单迁移到各年份分区文件，迁移后永久使用分区布局
+    bool convertToPartitionedLayout();
+    // 设置某年分区的打开方式（已结账的年份可设为只读或不可变）
+    bool setPartitionMode(int year, PartitionMode mode);
+    // 磁盘上已有的分区年份（升序）与各年份当前的打开方式
+    QList<int> partitionYearList();
+    PartitionMode partitionMode(int year);
+    // 整理数据库：对主库和可写分区执行完整 VACUUM，同时开启增量回收；耗时较长，由用户手动触发
+    bool compactDatabase();
+
+    // 交易对方字典：返回商户名对应的整数 id（空名称返回 0）
+    int internCounterparty(const QString &name);
+
+    // 账单的内存列式快照，首次使用时加载，之后随增删改同步修补
+    const BillColumnStore &columnStore();
+
+    // 主连接上的预编译语句缓存（命中/未命中计数）
+    const StatementCache &statementCache() const;
+
+    // 逐日金额的树状数组，任意区间合计和 7/30/90 天滚动窗口都是 O(log n)，写入时同步更新
+    const DailySumIndex &dailySums();
+
+    // 分类预算额度与（月份, 分类）支出计数器；传入某月的日期时确保该月计数器已装入
+    const BudgetTracker &budgetTracker(const QDate &month = QDate());
+
+    // 分类单笔金额与星期几日合计的流式均值 / 方差，首次使用时加载，之后随增删改和导入增量更新
+    const AnomalyDetector &anomalyDetector();
+
+    // 周期查询结果缓存（命中率、占用字节数），增删改和导入后按年份或整体失效
+    const QueryResultCache &resultCache() const;
+
+    /*按周期查询：任意周期 × 收支类型（"income" / "expense"），下面的按年/月/周函数都由此实现*/
+    QVector<BillRecord> getRecords(const PeriodKey &period, const QString &transactionType);
+    double getTotal(const PeriodKey &period, const QString &transactionType);
+    QVector<CategoryStat> getCategoryStats(const PeriodKey &period, const QString &transactionType);
 
-    // 导入支付宝账单
-    void importAlipayCsv(const QString &csvPath);
+    /*数据库查询收支账单：结果以只进游标一次读入结构体数组*/
+    QVector<BillRecord> getExpenseRecordsByYear(int year);  // 某年支出
+    QVector<BillRecord> getIncomeRecordsByYear(int year);  // 某年收入
+    QVector<BillRecord> getExpenseRecordsByMonth(int year, int month);  // 某月支出
+    QVector<BillRecord> getIncomeRecordsByMonth(int year, int month);  // 某月收入
+    QVector<BillRecord> getExpenseRecordsByWeek(int year, int week);  // 某周支出
+    QVector<BillRecord> getIncomeRecordsByWeek(int year, int week);  // 某周收入
+    QVector<BillRecord> getRecordsByDay(QString date);  // 某天收支
 
-    /*数据库查询收支账单*/
-    QSqlQuery getExpenseRecordsByYear(int year);  // 某年支出
-    QSqlQuery getIncomeRecordsByYear(int year);  // 某年收入
-    QSqlQuery getExpenseRecordsByMonth(int year, int month);  // 某月支出
-    QSqlQuery getIncomeRecordsByMonth(int year, int month);  // 某月收入
-    QSqlQuery getExpenseRecordsByWeek(int year, int week);  // 某周支出
-    QSqlQuery getIncomeRecordsByWeek(int year, int week);  // 某周收入
-    QSqlQuery getRecordsByDay(QString date);  // 某天收支
+    /*全文检索：在商品说明、交易对方、备注中搜索，按 BM25 相关度排序（BillRecord::score 越小越相关）*/
+    QVector<BillRecord> searchRecords(const QString &text, const DateRange &range = DateRange(), int limit = 50);
+
+    /*周期概况：收入、支出、笔数、金额极值与记录时间跨度一次查出*/
+    PeriodSummary summarize(const PeriodKey &period);
+
+    /*周期对比：本期、上一周期、去年同期的收支合计、逐日序列和分类金额，一次查询三段区间*/
+    // start 为本期中的任意一天（周视图传周一）；结果按三段区间涉及的年份缓存
+    PeriodComparison comparePeriods(const QDate &start, ComparisonPeriod period);
 
     /*计算总收入或总支出*/
-    QSqlQuery getTotalExpenseByYear(int year);  // 某年总支出
-    QSqlQuery getTotalIncomeByYear(int year);  // 某年总收入
-    QSqlQuery getTotalExpenseByMonth(int year, int month);  // 某月总支出
-    QSqlQuery getTotalIncomeByMonth(int year, int month);  // 某月总收入
-    QSqlQuery getTotalExpenseByWeek(int year, int week);  // 某周总支出
-    QSqlQuery getTotalIncomeByWeek(int year, int week);  // 某周总收入
-    QSqlQuery getTotalRecordsByDay(QString date); // 某天总支出和总收入
-
-    /*计算分类排行和占比 -> 返回有哪些类别及其对应的数量、总金额、总金额占比*/
-    QSqlQuery getExpenseCategoryStatsByYear(int year);
-    QSqlQuery getIncomeCategoryStatsByYear(int year);
-    QSqlQuery getExpenseCategoryStatsByMonth(int year, int month);
-    QSqlQuery getIncomeCategoryStatsByMonth(int year, int month);
-    QSqlQuery getExpenseCategoryStatsByWeek(int year, int week);
-    QSqlQuery getIncomeCategoryStatsByWeek(int year, int week);
+    double getTotalExpenseByYear(int year);  // 某年总支出
+    double getTotalIncomeByYear(int year);  // 某年总收入
+    double getTotalExpenseByMonth(int year, int month);  // 某月总支出
+    double getTotalIncomeByMonth(int year, int month);  // 某月总收入
+    double getTotalExpenseByWeek(int year, int week);  // 某周总支出
+    double getTotalIncomeByWeek(int year, int week);  // 某周总收入
+    DayTotal getTotalRecordsByDay(QString date); // 某天总支出和总收入
+    // 闭区间内逐日收支，一次 GROUP BY 查询，没有记录的日期补 0，结果按日期连续排列
+    QVector<DayTotal> getDailyTotals(const QDate &fromDay, const QDate &toDay);
+    // 某年 12 个月的收入或支出合计（下标 0 为一月），一次 GROUP BY month 查询
+    QVector<double> getMonthlySeries(int year, const QString &transactionType);
+    // 多年的月度序列：年份 -> 12 个月合计，一次 GROUP BY year, month 查询
+    QMap<int, QVector<double> > getMonthlySeries(int fromYear, int toYear, const QString &transactionType);
+
+    /*自定义区间统计：交易时间覆盖索引上的范围扫描，可按分类 / 交易方式筛选*/
+    PeriodSummary summarizeRange(const RangeFilter &filter);
+    QVector<DayTotal> getRangeDailyTotals(const RangeFilter &filter);
+    QVector<CategoryStat> getRangeCategoryStats(const RangeFilter &filter, const QString &transactionType);
+    // 账单的首末交易日期，没有账单时两端均无效
+    DateRange getDataDateRange();
+    // 某类收支的分类字典：id -> 名称
+    QMap<int, QString> getCategories(const QString &transactionType);
+
+    /*透视：区间内某类收支按任意两个维度汇总成稠密矩阵，一次分组查询*/
+    PivotTable pivot(const RangeFilter &filter, PivotDimension rows, PivotDimension columns, const QString &transactionType);
+
+    /*交易对方排行：有界内存，区间内账单不多时精确，否则为带误差上界的近似排行*/
+    QVector<MerchantStat> getTopMerchants(const QDate &from, const QDate &to, const QString &transactionType, int limit = 10);
+    // 下钻：某个交易对方在区间内的逐月合计
+    QVector<MerchantMonth> getMerchantTrend(int counterpartyId, const QDate &from, const QDate &to, const QString &transactionType);
+
+    /*周期性扣费：后台任务在列式快照上排序扫描检测，视图只读取最近一次的检测结果*/
+    // 执行一次检测，耗时随账单数增长，应在数据库线程上调用；返回结果是否与上一次不同
+    bool detectRecurringCharges();
+    QVector<RecurringCharge> getRecurringCharges();
+    // 按最近一次的检测结果推算 [from, to] 内预计的扣费，按日期升序；尚未检测时为空
+    QVector<RecurringCharge> getUpcomingCharges(const QDate &from, const QDate &to);
+
+    /*分类月度预算：额度存 budget 表，执行情况由内存计数器维护，写入时只调整受影响的（月份, 分类）*/
+    QMap<int, double> getBudgets();   // 支出分类 id -> 月度额度
+    // 设置某个支出分类的月度额度，额度 <= 0 表示取消预算
+    bool setBudget(int categoryId, double amount);
+    // 某月设了预算的分类的执行情况，按超支比例降序；代价与分类数成正比
+    QVector<BudgetStatus> evaluateBudgets(int year, int month);
+
+    /*支出异常：单笔远高于同分类平常水平，或当天合计远高于同星期几的日均 / 近 30 天日均*/
+    // [from, to] 内的异常，按日期升序，同一天整天的异常排在单笔之前；代价与区间内的账单数成正比
+    QVector<SpendAnomaly> getAnomalies(const QDate &from, const QDate &to);
+
+    /*区间合计与累计结余：内存中的树状数组，耗时与历史长度无关*/
+    double getRangeTotal(const QDate &from, const QDate &to, const QString &transactionType, int categoryId = 0);
+    // [from, to] 每天一个元素：截至当天的累计收入减累计支出
+    QVector<double> getRunningBalance(const QDate &from, const QDate &to);
+
+    /*滚动窗口：[from, to] 每天一个点，分类为 0 表示全部分类*/
+    QVector<RollingPoint> getRollingMetrics(const QDate &from, const QDate &to, const QString &transactionType, int categoryId = 0);
+
+    /*计算分类排行 -> 返回有哪些类别及其对应的数量、总金额（按总金额降序）*/
+    QVector<CategoryStat> getExpenseCategoryStatsByYear(int year);
+    QVector<CategoryStat> getIncomeCategoryStatsByYear(int year);
+    QVector<CategoryStat> getExpenseCategoryStatsByMonth(int year, int month);
+    QVector<CategoryStat> getIncomeCategoryStatsByMonth(int year, int month);
+    QVector<CategoryStat> getExpenseCategoryStatsByWeek(int year, int week);
+    QVector<CategoryStat> getIncomeCategoryStatsByWeek(int year, int week);
 
     /*查询总金额占比最大的分类对应的评价*/
     QString getTopCategoryByYearWithComment(int year, const QString &transactionType);
@@ -71,8 +387,98 @@ private:
     DatabaseManager();
     ~DatabaseManager();
 
-    QSqlDatabase db;
-    bool ready = false;
+    bool migrateCounterparty();
+    bool createSearchIndex();
+
+    // 分区：year/month/week/day 查询只附加所需年份
+    void loadStorageLayout();
+    QString partitionPath(int year) const;
+    bool attachPartition(int year, bool create);
+    bool detachPartition(int year);
+    QString billTable(int year, bool create = false);   // 单个年份的账单表名
+    // 范围内已有的分区按附加上限分批，每批内年份升序；newestFirst 时从最近的一批开始
+    QList<QList<int> > partitionBatches(int fromYear, int toYear, bool newestFirst = false);
+    // 跨年份账单数据源（UNION ALL），只用于一批放得下的范围；超出附加上限时返回空字符串
+    QString billSource(int fromYear, int toYear);
+    // 跨年份账单逐批执行：每批附加不超过上限的分区，拼成数据源交给 visit，由调用方合并各批结果；
+    // visit 返回 false 时提前结束。有分区附加失败时返回 false，调用方按查询失败处理
+    bool forEachBillSource(int fromYear, int toYear, const std::function<bool(const QString &)> &visit,
+                           bool newestFirst = false);
+    // 在全部账单上逐批执行加载查询（%1 为数据源），每批结果交给 consume；任一批失败返回 false
+    bool scanHistory(const QString &sql, const std::function<void(QSqlQuery &)> &consume);
+    // 全部分区中已存在的交易单号，写入 found；须在事务外调用
+    bool findExistingSourceIds(const QStringList &sourceIds, QSet<QString> *found);
+    qint64 allocateBillId();   // 失败返回 -1
+    int findRecordYear(int id);
+    int recordYear(int id);
+    // 读出某条记录的日期、金额（分）、类型和分类，用于修补区间合计索引、交易对方摘要、预算计数器和异常基线
+    bool recordFacts(const QString &table, int id, QDate *day, qint64 *cents, bool *income, int *categoryId);
+
+    QString periodSource(const PeriodKey &period);
+    bool resolveRange(RangeFilter *filter);
+    // 区间首末交易日上的最早/最晚交易时间，只查这两天，写入 summary 的 firstRecord/lastRecord
+    bool recordTimes(const RangeFilter &range, const QDate &firstDay, const QDate &lastDay, PeriodSummary *summary);
+    QSqlQuery periodStatement(const QString &id, const QString &sql, const QString &source, const PeriodKey &period);
+
+    QHash<int, QString> counterpartyNames(const QVector<int> &ids);
+    QVector<RecurringCharge> recurringCharges(const QVector<RecurringDetector::Series> &series);
+    QStringList pivotLabels(PivotDimension dimension, const QVector<int> &keys);
+
+    QString categoryComment(const QString &categoryName);
+    QString topCategoryComment(const PeriodKey &period, const QString &transactionType);
+
+    // 每个线程一条连接：打开数据库的线程使用主连接（读写），其他线程按需打开只读连接。
+    // ATTACH 和预编译语句都属于连接，随连接各自维护
+    struct Connection {
+        QSqlDatabase db;
+        QString name;                   // 主连接为空（默认连接）
+        StatementCache statements;
+        QList<int> attachedPartitions;  // 已附加的分区，按最近使用排序（末尾最新）
+        ~Connection();
+    };
+    Connection &conn();                 // 当前线程的连接
+    QSqlDatabase connection();
+
+    Connection primary;
+    QThread *primaryThread = nullptr;
+    QThreadStorage<Connection *> readers;
+    QString dbPath;
+    // 以下三个标志在主线程写入、工作线程上的查询读取，用原子量避免数据竞争
+    std::atomic<bool> ready { false };
+    QHash<QString, int> counterpartyCache;  // 商户名 -> counterparty.id
+    std::atomic<bool> searchIndexReady { false };   // FTS5 索引是否可用，不可用时退回 LIKE 扫描
+
+    std::atomic<bool> partitioned { false };
+    QList<int> partitionYears;              // 磁盘上已有的分区年份（升序）
+    QHash<int, int> partitionModes;         // 年份 -> PartitionMode
+
+    BillColumnStore columns;
+    DailySumIndex sums;
+    MerchantRanking merchants;
+    BudgetTracker budgets;
+    RecurringDetector recurring;
+    AnomalyDetector anomalies;
+    QueryResultCache results;
+    QHash<QString, QString> commentCache;    // 分类名 -> 评价
+    bool commentCacheLoaded = false;
+    // 保护 partitionYears / partitionModes / commentCache、writeGeneration 以及内存索引加载结果的换入，
+    // 工作线程上的查询也会读写它们
+    QMutex stateLock { QMutex::Recursive };
+
+    // 账单写入期间 writeGeneration 为奇数，写入开始、结束各加一（受 stateLock 保护）。
+    // 内存索引在锁外加载一份新实例，加载前后代数相同才换入，否则快照可能漏掉或重复计入并发的写入
+    struct WriteScope {
+        explicit WriteScope(DatabaseManager *manager);
+        ~WriteScope();
+        DatabaseManager *manager;
+    };
+    bool loadIndex(QMutex *serial, const std::function<bool()> &isLoaded,
+                   const std::function<bool()> &load, const std::function<void()> &adopt);
+    quint64 writeGeneration = 0;
+    QMutex columnsLoadLock;     // 同一索引同时只有一个线程在加载
+    QMutex sumsLoadLock;
+    QMutex budgetsLoadLock;
+    QMutex anomaliesLoadLock;
 };
 
 #endif // DATABASE_MANAGER_H
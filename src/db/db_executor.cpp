@@ -0,0 +1,100 @@
+#include "db_executor.h"
+
+#include <QDebug>
+#include <QStringList>
+#include <algorithm>
+
+// 读连接池的默认线程数上限，一次视图加载中超出的查询在池中排队
+static const int MAX_READ_THREADS = 4;
+// 每个视图、每个并行度保留的加载耗时样本数
+static const int LOAD_SAMPLES = 50;
+
+DbExecutor::DbExecutor()
+    : worker(new QObject)
+{
+    worker->moveToThread(&workerThread);
+    connect(&workerThread, &QThread::finished, worker, &QObject::deleteLater);
+    workerThread.setObjectName("db_executor");
+    workerThread.start();
+
+    // 线程退出时会关闭它的只读连接，常驻以免反复打开
+    readPool.setExpiryTimeout(-1);
+    readPool.setMaxThreadCount(qBound(1, QThread::idealThreadCount(), MAX_READ_THREADS));
+
+    // 对比加载耗时用：EXPENSE_READ_THREADS=1 时退回顺序执行
+    bool ok = false;
+    int threads = qEnvironmentVariableIntValue("EXPENSE_READ_THREADS", &ok);
+    if (ok)
+        setReadParallelism(threads);
+}
+
+DbExecutor::~DbExecutor()
+{
+    shutdown();
+}
+
+DbExecutor &DbExecutor::instance()
+{
+    static DbExecutor instance;
+    return instance;
+}
+
+void DbExecutor::shutdown()
+{
+    if (!workerThread.isRunning())
+        return;
+    // 队列中尚未执行的查询直接丢弃，正在执行的一条会等它结束
+    workerThread.quit();
+    workerThread.wait();
+    // 等待池中的查询结束并回收线程，各线程的只读连接随之关闭
+    readPool.clear();
+    readPool.waitForDone();
+    if (!loadSamples.isEmpty())
+        qDebug().noquote() << "视图加载耗时中位数:\n" + loadTimeSummary();
+    qDebug() << "数据库查询线程已退出";
+}
+
+void DbExecutor::setReadParallelism(int threads)
+{
+    readPool.setMaxThreadCount(qMax(1, threads));
+}
+
+int DbExecutor::readParallelism() const
+{
+    return readPool.maxThreadCount();
+}
+
+// 样本按（视图, 读并行度）分开保存，同一次运行中切换并行度也能对比前后的中位数
+void DbExecutor::recordLoadTime(const QString &view, qint64 ms)
+{
+    QVector<qint64> &samples = loadSamples[QString("%1|%2").arg(view).arg(readParallelism())];
+    samples.append(ms);
+    if (samples.size() > LOAD_SAMPLES)
+        samples.remove(0);
+}
+
+QString DbExecutor::loadTimeSummary() const
+{
+    QStringList keys = loadSamples.keys();
+    std::sort(keys.begin(), keys.end());
+
+    QStringList lines;
+    for (const QString &key : keys) {
+        QVector<qint64> sorted = loadSamples.value(key);
+        std::nth_element(sorted.begin(), sorted.begin() + sorted.size() / 2, sorted.end());
+        QStringList parts = key.split('|');
+        lines << QString("%1 并行度 %2：%3 次，中位数 %4 ms")
+                     .arg(parts.value(0), parts.value(1)).arg(sorted.size()).arg(sorted[sorted.size() / 2]);
+    }
+    return lines.join('\n');
+}
+
+void DbExecutor::post(const std::function<void()> &job)
+{
+    if (!workerThread.isRunning()) {
+        qDebug() << "数据库查询线程未运行，查询被忽略";
+        return;
+    }
+    // 投递到 worker 所在线程的事件队列，按提交顺序执行
+    QMetaObject::invokeMethod(worker, job, Qt::QueuedConnection);
+}
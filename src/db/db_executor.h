@@ -0,0 +1,146 @@
+#ifndef DB_EXECUTOR_H
+#define DB_EXECUTOR_H
+
+#include <QObject>
+#include <QThread>
+#include <QFuture>
+#include <QFutureInterface>
+#include <QFutureWatcher>
+#include <QThreadPool>
+#include <QRunnable>
+#include <QHash>
+#include <QVector>
+#include <functional>
+
+// 读连接池中的一项查询
+class DbReadTask : public QRunnable
+{
+public:
+    explicit DbReadTask(const std::function<void()> &job) : job(job) {}
+    void run() override { job(); }
+
+private:
+    std::function<void()> job;
+};
+
+/**
+ * @brief 数据库查询线程
+ *
+ * - 只读查询投递到专用的工作线程按顺序执行，DatabaseManager 在该线程上使用自己的只读连接
+ * - run() 返回 QFuture<T>；带 context 的重载在界面线程回调，context 销毁后不再回调
+ * - fork() 把一次视图加载中互不依赖的查询分发到读连接池并行执行，调用方用 result() 汇总；
+ *   池中每个线程各有一条只读连接（WAL 下读之间互不阻塞），线程常驻以复用连接
+ * - background() 把耗时的后台统计以低优先级投进读连接池，不占用工作线程，排队时让视图查询先行
+ * - 写入（导入、增删改）仍在界面线程的主连接上同步执行
+ */
+class DbExecutor : public QObject
+{
+    Q_OBJECT
+
+public:
+    static DbExecutor &instance();
+
+    template <typename T>
+    QFuture<T> run(std::function<T()> task);
+
+    template <typename T>
+    void run(std::function<T()> task, QObject *context, std::function<void(const T &)> done);
+
+    template <typename T>
+    QFuture<T> fork(std::function<T()> task);
+
+    template <typename T>
+    void background(std::function<T()> task, QObject *context, std::function<void(const T &)> done);
+
+    // 并行度为 1 时 fork() 直接在调用线程上顺序执行，便于对比加载耗时
+    void setReadParallelism(int threads);
+    int readParallelism() const;
+
+    // 记录一次视图加载耗时（界面线程调用），不逐次输出
+    void recordLoadTime(const QString &view, qint64 ms);
+    // 各视图在各读并行度下最近若干次加载的中位数，每行一项；shutdown() 时输出一次
+    QString loadTimeSummary() const;
+
+    // 结束工作线程，必须在 DatabaseManager 析构前调用，让线程上的连接先关闭
+    void shutdown();
+
+private:
+    DbExecutor();
+    ~DbExecutor();
+
+    void post(const std::function<void()> &job);
+
+    template <typename T>
+    static std::function<void()> fulfil(QFutureInterface<T> promise, std::function<T()> task);
+    template <typename T>
+    static void watch(const QFuture<T> &future, QObject *context, std::function<void(const T &)> done);
+
+    QThread workerThread;
+    QObject *worker;
+    QThreadPool readPool;
+    QHash<QString, QVector<qint64> > loadSamples;
+};
+
+template <typename T>
+std::function<void()> DbExecutor::fulfil(QFutureInterface<T> promise, std::function<T()> task)
+{
+    return [promise, task]() mutable {
+        T result = task();
+        promise.reportResult(result);
+        promise.reportFinished();
+    };
+}
+
+// watcher 挂在 context 上，context 先销毁时一并删除，回调不会再触发
+template <typename T>
+void DbExecutor::watch(const QFuture<T> &future, QObject *context, std::function<void(const T &)> done)
+{
+    QFutureWatcher<T> *watcher = new QFutureWatcher<T>(context);
+    QObject::connect(watcher, &QFutureWatcherBase::finished, context, [watcher, done]() {
+        done(watcher->result());
+        watcher->deleteLater();
+    });
+    watcher->setFuture(future);
+}
+
+template <typename T>
+QFuture<T> DbExecutor::run(std::function<T()> task)
+{
+    QFutureInterface<T> promise;
+    promise.reportStarted();
+    post(fulfil(promise, task));
+    return promise.future();
+}
+
+template <typename T>
+void DbExecutor::run(std::function<T()> task, QObject *context, std::function<void(const T &)> done)
+{
+    watch(run(task), context, done);
+}
+
+template <typename T>
+QFuture<T> DbExecutor::fork(std::function<T()> task)
+{
+    QFutureInterface<T> promise;
+    promise.reportStarted();
+    QFuture<T> future = promise.future();
+
+    std::function<void()> job = fulfil(promise, task);
+    if (readPool.maxThreadCount() <= 1)
+        job();
+    else
+        readPool.start(new DbReadTask(job));
+    return future;
+}
+
+// 由界面线程调用，即使并行度为 1 也不在调用线程上执行；优先级低于 fork() 投递的视图查询
+template <typename T>
+void DbExecutor::background(std::function<T()> task, QObject *context, std::function<void(const T &)> done)
+{
+    QFutureInterface<T> promise;
+    promise.reportStarted();
+    readPool.start(new DbReadTask(fulfil(promise, task)), -1);
+    watch(promise.future(), context, done);
+}
+
+#endif // DB_EXECUTOR_H
@@ -0,0 +1,250 @@
+#include "maintenance_scheduler.h"
+
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QElapsedTimer>
+#include <QDateTime>
+#include <QDebug>
+
+// 最后一次写入后空闲多久开始维护
+static const int IDLE_DELAY_MS = 30 * 1000;
+// 没有写入时的维护间隔
+static const int PERIODIC_INTERVAL_MS = 30 * 60 * 1000;
+// 一轮维护的总时长上限；optimize 之后各步只用剩余的预算，用完就留到下一轮
+static const int PASS_BUDGET_MS = 500;
+// incremental_vacuum 每片回收的页数，片与片之间让出写锁
+static const int VACUUM_PAGES_PER_SLICE = 128;
+// ANALYZE 每个索引最多采样的行数，让 optimize 在大库上也能很快结束
+static const int ANALYSIS_LIMIT = 400;
+
+MaintenanceWorker::MaintenanceWorker(const QString &databasePath)
+    : path(databasePath)
+{
+}
+
+MaintenanceWorker::~MaintenanceWorker()
+{
+    if (db.isValid()) {
+        db.close();
+        db = QSqlDatabase();
+        QSqlDatabase::removeDatabase(connectionName);
+    }
+}
+
+// 连接必须在使用它的线程中创建，所以第一次执行维护时才打开
+bool MaintenanceWorker::openConnection()
+{
+    if (db.isOpen())
+        return true;
+
+    connectionName = QString("maintenance_%1").arg(reinterpret_cast<quintptr>(this));
+    db = QSqlDatabase::addDatabase("QSQLITE", connectionName);
+    db.setDatabaseName(path);
+    // 界面线程写入时不长时间等待，拿不到锁就留到下一轮
+    db.setConnectOptions("QSQLITE_BUSY_TIMEOUT=200");
+    if (!db.open()) {
+        qDebug() << "维护连接打开失败:" << db.lastError().text();
+        return false;
+    }
+
+    QSqlQuery query(db);
+    query.exec(QString("PRAGMA analysis_limit = %1;").arg(ANALYSIS_LIMIT));
+
+    // 3.33 之前 quick_check 的参数只能是错误条数，传表名会退化成整库检查
+    if (query.exec("SELECT sqlite_version();") && query.next()) {
+        QStringList parts = query.value(0).toString().split('.');
+        int major = parts.value(0).toInt();
+        int minor = parts.value(1).toInt();
+        tableChecks = major > 3 || (major == 3 && minor >= 33);
+    }
+    query.finish();
+    if (!tableChecks)
+        qDebug() << "SQLite 版本低于 3.33，不支持按表 quick_check，后台不做完整性检查";
+    return true;
+}
+
+void MaintenanceWorker::runPass()
+{
+    if (openConnection()) {
+        QElapsedTimer timer;
+        timer.start();
+
+        optimize();
+        incrementalVacuum(PASS_BUDGET_MS - timer.elapsed());
+        quickCheck(PASS_BUDGET_MS - timer.elapsed());
+
+        qDebug() << "数据库维护完成，总耗时" << timer.elapsed() << "ms";
+    }
+    emit passFinished();
+}
+
+void MaintenanceWorker::optimize()
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    QSqlQuery query(db);
+    if (!query.exec("PRAGMA optimize;")) {
+        qDebug() << "PRAGMA optimize 失败:" << query.lastError().text();
+        return;
+    }
+    qDebug() << "PRAGMA optimize 完成，耗时" << timer.elapsed() << "ms";
+}
+
+void MaintenanceWorker::incrementalVacuum(qint64 budgetMs)
+{
+    if (budgetMs <= 0)
+        return;
+
+    QElapsedTimer timer;
+    timer.start();
+
+    QSqlQuery query(db);
+    query.exec("PRAGMA auto_vacuum;");
+    int mode = query.next() ? query.value(0).toInt() : 0;
+
+    // 旧数据库文件创建时未开启 auto_vacuum，切换需要一次完整 VACUUM，大库上会长时间占住写锁、
+    // 无法限时，所以不在后台做，由用户在“整理数据库”中手动执行（DatabaseManager::compactDatabase）
+    if (mode != 2) {
+        if (!legacyVacuumLogged) {
+            qDebug() << "数据库未开启 auto_vacuum=INCREMENTAL，执行一次“整理数据库”后才会回收空闲页";
+            legacyVacuumLogged = true;
+        }
+        return;
+    }
+
+    query.exec("PRAGMA freelist_count;");
+    int freePages = query.next() ? query.value(0).toInt() : 0;
+    int reclaimed = 0;
+    int slices = 0;
+
+    // 分片回收，片与片之间让出写锁；incremental_vacuum 每 step 释放一页，需要把结果读完
+    while (freePages > 0 && timer.elapsed() < budgetMs) {
+        int pages = qMin(freePages, VACUUM_PAGES_PER_SLICE);
+        if (!query.exec(QString("PRAGMA incremental_vacuum(%1);").arg(pages))) {
+            qDebug() << "incremental_vacuum 失败:" << query.lastError().text();
+            break;
+        }
+        while (query.next()) {
+        }
+        query.finish();
+
+        reclaimed += pages;
+        freePages -= pages;
+        ++slices;
+        QThread::msleep(10);
+    }
+
+    qDebug() << "incremental_vacuum 回收" << reclaimed << "页，分" << slices << "片，剩余"
+             << freePages << "页，耗时" << timer.elapsed() << "ms";
+}
+
+// 整库 quick_check 无法中途停下，改为按表检查（SQLite 3.33 起支持），每轮在预算内检查几张表，
+// 当天所有表都检查过后才算完成一次；检查只读，WAL 模式下不阻塞界面线程的写入
+void MaintenanceWorker::quickCheck(qint64 budgetMs)
+{
+    if (!tableChecks || budgetMs <= 0 || lastQuickCheck == QDate::currentDate())
+        return;
+
+    QElapsedTimer timer;
+    timer.start();
+
+    QSqlQuery query(db);
+    if (pendingChecks.isEmpty()) {
+        if (!query.exec("SELECT name FROM sqlite_master WHERE type = 'table' AND name NOT LIKE 'sqlite_%';")) {
+            qDebug() << "quick_check 读取表清单失败:" << query.lastError().text();
+            return;
+        }
+        while (query.next())
+            pendingChecks << query.value(0).toString();
+        query.finish();
+    }
+
+    QStringList problems;
+    int checked = 0;
+    while (!pendingChecks.isEmpty() && timer.elapsed() < budgetMs) {
+        QString table = pendingChecks.first();
+        if (!query.exec(QString("PRAGMA quick_check(\"%1\");").arg(table))) {
+            qDebug() << "quick_check 失败:" << table << query.lastError().text();
+            pendingChecks.clear();
+            lastQuickCheck = QDate::currentDate();
+            return;
+        }
+        while (query.next()) {
+            QString line = query.value(0).toString();
+            if (line != "ok")
+                problems << line;
+        }
+        query.finish();
+        pendingChecks.removeFirst();
+        ++checked;
+    }
+    if (pendingChecks.isEmpty())
+        lastQuickCheck = QDate::currentDate();
+
+    if (problems.isEmpty()) {
+        qDebug() << "quick_check 检查" << checked << "张表通过，剩余" << pendingChecks.size()
+                 << "张，耗时" << timer.elapsed() << "ms";
+    } else {
+        qDebug() << "quick_check 发现问题:" << problems << "耗时" << timer.elapsed() << "ms";
+    }
+}
+
+MaintenanceScheduler::MaintenanceScheduler(const QString &databasePath, QObject *parent)
+    : QObject(parent)
+    , worker(new MaintenanceWorker(databasePath))
+{
+    worker->moveToThread(&workerThread);
+    connect(&workerThread, &QThread::finished, worker, &QObject::deleteLater);
+    connect(worker, &MaintenanceWorker::passFinished, this, &MaintenanceScheduler::onPassFinished);
+
+    idleTimer.setSingleShot(true);
+    idleTimer.setInterval(IDLE_DELAY_MS);
+    connect(&idleTimer, &QTimer::timeout, this, &MaintenanceScheduler::onIdle);
+
+    periodicTimer.setInterval(PERIODIC_INTERVAL_MS);
+    connect(&periodicTimer, &QTimer::timeout, this, &MaintenanceScheduler::onIdle);
+}
+
+MaintenanceScheduler::~MaintenanceScheduler()
+{
+    // 正在执行的一轮最多持续几百毫秒
+    workerThread.quit();
+    workerThread.wait();
+}
+
+void MaintenanceScheduler::start()
+{
+    workerThread.start(QThread::LowPriority);
+    periodicTimer.start();
+    // 启动后空闲时先维护一次
+    idleTimer.start();
+}
+
+void MaintenanceScheduler::notifyWrite()
+{
+    if (running) {
+        pending = true;
+        return;
+    }
+    // 连续写入时不断推迟，直到空闲
+    idleTimer.start();
+}
+
+void MaintenanceScheduler::onIdle()
+{
+    if (running)
+        return;
+
+    running = true;
+    QMetaObject::invokeMethod(worker, "runPass", Qt::QueuedConnection);
+}
+
+void MaintenanceScheduler::onPassFinished()
+{
+    running = false;
+    if (pending) {
+        pending = false;
+        idleTimer.start();
+    }
+}
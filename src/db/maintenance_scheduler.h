@@ -0,0 +1,75 @@
+#ifndef MAINTENANCE_SCHEDULER_H
+#define MAINTENANCE_SCHEDULER_H
+
+#include <QObject>
+#include <QThread>
+#include <QTimer>
+#include <QSqlDatabase>
+#include <QDate>
+#include <QStringList>
+
+// 在后台线程上执行一轮维护，使用独立的数据库连接，不占用界面线程
+class MaintenanceWorker : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit MaintenanceWorker(const QString &databasePath);
+    ~MaintenanceWorker();
+
+public slots:
+    // 依次执行 PRAGMA optimize、分片的 incremental_vacuum 和分表的 quick_check，整轮共用一个时间预算
+    void runPass();
+
+signals:
+    void passFinished();
+
+private:
+    bool openConnection();
+    void optimize();
+    void incrementalVacuum(qint64 budgetMs);
+    void quickCheck(qint64 budgetMs);
+
+    QString path;
+    QString connectionName;
+    QSqlDatabase db;
+    QDate lastQuickCheck;           // 最近一次检查完所有表的日期
+    QStringList pendingChecks;      // 当天还没检查的表，跨轮次逐个检查
+    bool legacyVacuumLogged = false;
+    bool tableChecks = false;       // SQLite 是否支持按表 quick_check
+};
+
+/**
+ * @brief 空闲时数据库维护调度
+ *
+ * - 写入（导入、增删改）后调用 notifyWrite()，空闲一段时间后触发一轮维护
+ * - 没有写入时也按较长间隔定期维护一次
+ * - 维护在后台线程执行，每一步都限时并输出耗时日志
+ */
+class MaintenanceScheduler : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit MaintenanceScheduler(const QString &databasePath, QObject *parent = nullptr);
+    ~MaintenanceScheduler();
+
+    void start();
+
+public slots:
+    void notifyWrite();
+
+private slots:
+    void onIdle();
+    void onPassFinished();
+
+private:
+    QThread workerThread;
+    MaintenanceWorker *worker;
+    QTimer idleTimer;       // 最后一次写入后的空闲等待
+    QTimer periodicTimer;   // 无写入时的定期维护
+    bool running = false;
+    bool pending = false;   // 维护进行中又有新写入
+};
+
+#endif // MAINTENANCE_SCHEDULER_H
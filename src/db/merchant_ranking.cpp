@@ -0,0 +1,189 @@
+#include "merchant_ranking.h"
+#include "bill_column_store.h"
+
+#include <QMutexLocker>
+#include <QElapsedTimer>
+#include <QDebug>
+#include <algorithm>
+
+static bool heavierThan(const HeavyHitters::Entry &a, const HeavyHitters::Entry &b)
+{
+    return a.weight > b.weight;
+}
+
+HeavyHitters::HeavyHitters(int capacity)
+    : capacity(capacity)
+{
+}
+
+HeavyHitters HeavyHitters::fromTotals(const QHash<int, qint64> &totals, int capacity)
+{
+    HeavyHitters summary(capacity);
+    QVector<Entry> entries;
+    entries.reserve(totals.size());
+    for (auto it = totals.constBegin(); it != totals.constEnd(); ++it) {
+        Entry entry;
+        entry.key = it.key();
+        entry.weight = it.value();
+        entries.append(entry);
+    }
+
+    int kept = qMin(capacity, entries.size());
+    std::partial_sort(entries.begin(), entries.begin() + kept, entries.end(), heavierThan);
+    for (int i = 0; i < kept; ++i)
+        summary.counters.insert(entries[i].key, entries[i]);
+
+    // 没保留的键都不超过被丢弃部分的最大值
+    for (int i = kept; i < entries.size(); ++i)
+        summary.floorWeight = qMax(summary.floorWeight, entries[i].weight);
+    return summary;
+}
+
+// 一方没有记录的键，在那一方的真实值不超过它的 floor，计入误差
+void HeavyHitters::merge(const HeavyHitters &other)
+{
+    const qint64 ownFloor = floorWeight;
+    for (auto it = counters.begin(); it != counters.end(); ++it) {
+        auto found = other.counters.constFind(it.key());
+        if (found != other.counters.constEnd()) {
+            it.value().weight += found.value().weight;
+            it.value().error += found.value().error;
+        } else {
+            it.value().error += other.floorWeight;
+        }
+    }
+    for (auto it = other.counters.constBegin(); it != other.counters.constEnd(); ++it) {
+        if (counters.contains(it.key()))
+            continue;
+        Entry entry = it.value();
+        entry.error += ownFloor;
+        counters.insert(entry.key, entry);
+    }
+    floorWeight = ownFloor + other.floorWeight;
+    prune();
+}
+
+void HeavyHitters::prune()
+{
+    if (counters.size() <= capacity)
+        return;
+
+    QVector<Entry> entries;
+    entries.reserve(counters.size());
+    for (auto it = counters.constBegin(); it != counters.constEnd(); ++it)
+        entries.append(it.value());
+    std::partial_sort(entries.begin(), entries.begin() + capacity, entries.end(), heavierThan);
+
+    counters.clear();
+    for (int i = 0; i < capacity; ++i)
+        counters.insert(entries[i].key, entries[i]);
+    for (int i = capacity; i < entries.size(); ++i)
+        floorWeight = qMax(floorWeight, entries[i].weight + entries[i].error);
+}
+
+QVector<HeavyHitters::Entry> HeavyHitters::top(int count) const
+{
+    QVector<Entry> entries;
+    entries.reserve(counters.size());
+    for (auto it = counters.constBegin(); it != counters.constEnd(); ++it)
+        entries.append(it.value());
+    std::sort(entries.begin(), entries.end(), heavierThan);
+    if (entries.size() > count)
+        entries.resize(count);
+    return entries;
+}
+
+qint64 HeavyHitters::floor() const
+{
+    return floorWeight;
+}
+
+int HeavyHitters::size() const
+{
+    return counters.size();
+}
+
+MerchantRanking::MerchantRanking()
+{
+}
+
+void MerchantRanking::clear()
+{
+    QMutexLocker locker(&lock);
+    months.clear();
+    ++generation;
+}
+
+int MerchantRanking::monthKey(const QDate &day, bool income)
+{
+    return (day.year() * 12 + day.month() - 1) * 2 + (income ? 1 : 0);
+}
+
+void MerchantRanking::invalidate(const QDate &day)
+{
+    if (!day.isValid())
+        return;
+    QMutexLocker locker(&lock);
+    months.remove(monthKey(day, false));
+    months.remove(monthKey(day, true));
+    ++generation;
+}
+
+// 写入先修补快照再调用 invalidate：重建期间代数变了，说明读到的快照可能早于那次写入
+HeavyHitters MerchantRanking::monthSummary(const BillColumnStore &store, const QDate &monthStart, bool income,
+                                           int *built)
+{
+    int key = monthKey(monthStart, income);
+    quint64 seen = 0;
+    {
+        QMutexLocker locker(&lock);
+        auto it = months.constFind(key);
+        if (it != months.constEnd())
+            return it.value();
+        seen = generation;
+    }
+    bool cacheable = store.isLoaded();
+
+    QDate monthEnd = monthStart.addDays(monthStart.daysInMonth() - 1);
+    HeavyHitters summary = HeavyHitters::fromTotals(store.counterpartyTotals(monthStart, monthEnd, income),
+                                                    MONTH_CAPACITY);
+    ++*built;
+
+    QMutexLocker locker(&lock);
+    if (cacheable && generation == seen)
+        months.insert(key, summary);
+    return summary;
+}
+
+QVector<HeavyHitters::Entry> MerchantRanking::top(const BillColumnStore &store, const QDate &from, const QDate &to,
+                                                  bool income, int count, bool *exact, QHash<int, int> *counts)
+{
+    // 区间中的整月：首月不从 1 号开始、末月不到月底时各自让出，按精确统计处理
+    QDate firstFull = from.day() == 1 ? from : QDate(from.year(), from.month(), 1).addMonths(1);
+    QDate lastFullEnd = to.day() == to.daysInMonth() ? to : QDate(to.year(), to.month(), 1).addDays(-1);
+
+    if (store.rowCount(from, to) <= EXACT_ROW_LIMIT || firstFull > lastFullEnd) {
+        *exact = true;
+        return HeavyHitters::fromTotals(store.counterpartyTotals(from, to, income, counts), count).top(count);
+    }
+
+    *exact = false;
+    HeavyHitters summary(MONTH_CAPACITY);
+    if (from < firstFull)
+        summary.merge(HeavyHitters::fromTotals(store.counterpartyTotals(from, firstFull.addDays(-1), income),
+                                               MONTH_CAPACITY));
+    if (lastFullEnd < to)
+        summary.merge(HeavyHitters::fromTotals(store.counterpartyTotals(lastFullEnd.addDays(1), to, income),
+                                               MONTH_CAPACITY));
+
+    // 冷启动时每个整月都要从快照重建一次，记下耗时（目标：千万行内 50 ms）
+    QElapsedTimer timer;
+    timer.start();
+    int built = 0;
+    for (QDate month = firstFull; month <= lastFullEnd; month = month.addMonths(1))
+        summary.merge(monthSummary(store, month, income, &built));
+    if (built > 0)
+        qDebug() << "交易对方排行重建" << built << "个月摘要，快照" << store.size() << "行，耗时"
+                 << timer.elapsed() << "ms";
+    return summary.top(count);
+}
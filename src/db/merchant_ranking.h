@@ -0,0 +1,70 @@
+#ifndef MERCHANT_RANKING_H
+#define MERCHANT_RANKING_H
+
+#include <QHash>
+#include <QVector>
+#include <QDate>
+#include <QMutex>
+
+class BillColumnStore;
+
+// 有界的高频项摘要（Space-Saving / Misra-Gries 一类的可合并摘要）。
+// 最多保留 capacity 个键的金额下界 weight 和误差 error（真实值在 [weight, weight + error] 内），
+// 未保留的键真实值不超过 floor；两个摘要相加后再裁剪回 capacity，误差随之累加。
+class HeavyHitters
+{
+public:
+    struct Entry {
+        int key = 0;
+        qint64 weight = 0;
+        qint64 error = 0;
+    };
+
+    explicit HeavyHitters(int capacity = 64);
+
+    // 由一段数据的精确合计建立摘要：保留最大的 capacity 个，floor 为第 capacity + 1 大的值
+    static HeavyHitters fromTotals(const QHash<int, qint64> &totals, int capacity);
+
+    void merge(const HeavyHitters &other);
+    QVector<Entry> top(int count) const;   // 按 weight 降序
+    qint64 floor() const;
+    int size() const;
+
+private:
+    void prune();
+
+    int capacity;
+    qint64 floorWeight = 0;
+    QHash<int, Entry> counters;
+};
+
+// 交易对方排行：按月缓存收入/支出各一份摘要，任意区间由整月摘要合并，首尾不满一月的部分精确统计。
+// 区间内账单不多时直接精确分组。摘要在写入后按月失效，下次使用时从列式快照重建该月；
+// 重建在锁外进行，期间发生过失效的摘要只用于本次结果，不写回缓存。
+class MerchantRanking
+{
+public:
+    // 不超过这个条数的区间直接精确分组
+    static const int EXACT_ROW_LIMIT = 200000;
+    static const int MONTH_CAPACITY = 64;
+
+    MerchantRanking();
+
+    void clear();
+    void invalidate(const QDate &day);   // 某天所在月份的摘要失效
+
+    // exact 返回是否为精确结果；counts 仅在精确时填写
+    QVector<HeavyHitters::Entry> top(const BillColumnStore &store, const QDate &from, const QDate &to,
+                                     bool income, int count, bool *exact, QHash<int, int> *counts);
+
+private:
+    static int monthKey(const QDate &day, bool income);
+    // 缓存中没有时重建该月摘要，built 累计重建的月数
+    HeavyHitters monthSummary(const BillColumnStore &store, const QDate &monthStart, bool income, int *built);
+
+    QHash<int, HeavyHitters> months;   // (年 * 12 + 月) * 2 + 是否收入 -> 该月摘要
+    quint64 generation = 0;            // 每次 invalidate / clear 加一
+    QMutex lock;
+};
+
+#endif // MERCHANT_RANKING_H
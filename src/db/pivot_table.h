@@ -0,0 +1,40 @@
+#ifndef PIVOT_TABLE_H
+#define PIVOT_TABLE_H
+
+#include <QVector>
+#include <QStringList>
+
+// 透视表的行/列维度
+enum PivotDimension {
+    PivotCategory = 0,
+    PivotMonth,         // 月份 1-12，跨年时同月合并
+    PivotWeek,          // ISO 周数
+    PivotWeekday,       // 周一 = 1 ... 周日 = 7
+    PivotMethod,        // 交易方式
+    PivotCounterparty,  // 交易对方
+    PivotYear,
+    PivotHour,          // 交易时间的小时 0-23
+    PivotDimensionCount
+};
+
+// 行维度 × 列维度的稠密金额矩阵，由一次 GROUP BY 查询填充。
+// 数据都在隐式共享的 QVector / QStringList 里，按值传递和交给表格模型都不会深拷贝。
+struct PivotTable
+{
+    PivotDimension rowDimension = PivotCategory;
+    PivotDimension columnDimension = PivotMonth;
+    QVector<int> rowKeys;           // 维度取值（分类 id、月份、年份……），升序
+    QVector<int> columnKeys;
+    QStringList rowLabels;
+    QStringList columnLabels;
+    QVector<double> cells;          // 行优先，rowKeys.size() × columnKeys.size()
+    QVector<double> rowTotals;
+    QVector<double> columnTotals;
+    double grandTotal = 0;
+
+    int rowCount() const { return rowKeys.size(); }
+    int columnCount() const { return columnKeys.size(); }
+    double value(int row, int column) const { return cells[row * columnKeys.size() + column]; }
+};
+
+#endif // PIVOT_TABLE_H
@@ -0,0 +1,68 @@
+#include "query_result_cache.h"
+
+QueryResultCache::QueryResultCache(int maxBytes)
+    : entries(maxBytes)
+{
+}
+
+quint64 QueryResultCache::version(int fromYear, int toYear) const
+{
+    QMutexLocker locker(&lock);
+    quint64 result = globalGeneration;
+    for (auto it = yearGenerations.constBegin(); it != yearGenerations.constEnd(); ++it) {
+        if (it.key() >= fromYear && it.key() <= toYear)
+            result += it.value();
+    }
+    return result;
+}
+
+void QueryResultCache::invalidateAll()
+{
+    QMutexLocker locker(&lock);
+    ++globalGeneration;
+    // 全部失效后旧条目不会再命中，直接释放内存
+    entries.clear();
+}
+
+void QueryResultCache::invalidateYear(int year)
+{
+    QMutexLocker locker(&lock);
+    ++yearGenerations[year];
+}
+
+int QueryResultCache::hits() const
+{
+    QMutexLocker locker(&lock);
+    return hitCount;
+}
+
+int QueryResultCache::misses() const
+{
+    QMutexLocker locker(&lock);
+    return missCount;
+}
+
+double QueryResultCache::hitRate() const
+{
+    QMutexLocker locker(&lock);
+    int total = hitCount + missCount;
+    return total > 0 ? static_cast<double>(hitCount) / total : 0.0;
+}
+
+int QueryResultCache::size() const
+{
+    QMutexLocker locker(&lock);
+    return entries.size();
+}
+
+int QueryResultCache::totalBytes() const
+{
+    QMutexLocker locker(&lock);
+    return entries.totalCost();
+}
+
+int QueryResultCache::maxBytes() const
+{
+    QMutexLocker locker(&lock);
+    return entries.maxCost();
+}
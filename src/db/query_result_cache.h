@@ -0,0 +1,89 @@
+#ifndef QUERY_RESULT_CACHE_H
+#define QUERY_RESULT_CACHE_H
+
+#include <QCache>
+#include <QHash>
+#include <QMutex>
+#include <QString>
+
+/**
+ * @brief 带写入版本号的查询结果缓存
+ *
+ * - 键由调用方按（查询类型, 周期, 收支类型）拼成
+ * - 每条结果记录计算时的版本号：全局写入代数加上所涉年份各自的写入代数之和，
+ *   任一相关年份有写入时版本号都会变化，旧结果自然失效，不需要逐条清理
+ * - 增删改只推进受影响年份的代数，导入等批量写入推进全局代数
+ * - 按估算字节数做 LRU 淘汰，总量不超过预算
+ * - 可在多个读线程上同时使用
+ */
+class QueryResultCache
+{
+public:
+    explicit QueryResultCache(int maxBytes = 4 * 1024 * 1024);
+
+    // 查询开始前取版本号；计算期间有写入时存入的结果会带旧版本，下次查询即失效
+    quint64 version(int fromYear, int toYear) const;
+
+    template <typename T>
+    bool lookup(const QString &key, quint64 version, T *out);
+
+    template <typename T>
+    void store(const QString &key, quint64 version, const T &value, int bytes);
+
+    void invalidateAll();
+    void invalidateYear(int year);
+
+    int hits() const;
+    int misses() const;
+    double hitRate() const;
+    int size() const;
+    int totalBytes() const;
+    int maxBytes() const;
+
+private:
+    struct Slot {
+        virtual ~Slot() {}
+        quint64 version = 0;
+    };
+
+    template <typename T>
+    struct Value : Slot {
+        T value;
+    };
+
+    mutable QMutex lock;
+    QCache<QString, Slot> entries;
+    quint64 globalGeneration = 0;
+    QHash<int, quint64> yearGenerations;
+    int hitCount = 0;
+    int missCount = 0;
+};
+
+template <typename T>
+bool QueryResultCache::lookup(const QString &key, quint64 version, T *out)
+{
+    QMutexLocker locker(&lock);
+    // object() 同时把条目移到 LRU 队首
+    Value<T> *slot = dynamic_cast<Value<T> *>(entries.object(key));
+    if (!slot || slot->version != version) {
+        ++missCount;
+        return false;
+    }
+    ++hitCount;
+    *out = slot->value;
+    return true;
+}
+
+template <typename T>
+void QueryResultCache::store(const QString &key, quint64 version, const T &value, int bytes)
+{
+    Value<T> *slot = new Value<T>;
+    slot->version = version;
+    slot->value = value;
+
+    QMutexLocker locker(&lock);
+    // 超出预算的单条结果 QCache 会直接丢弃
+    entries.insert(key, slot, qMax(1, bytes));
+}
+
+#endif // QUERY_RESULT_CACHE_H
@@ -0,0 +1,233 @@
+#include "recurring_detector.h"
+#include "bill_column_store.h"
+
+#include <QMutexLocker>
+#include <QDebug>
+#include <QElapsedTimer>
+#include <algorithm>
+
+// 每种周期的间隔范围（天）：间隔中位数落在范围内即判为该周期，
+// 大部分间隔都落在范围内才算规律；tolerance 为推算下一次扣费时允许的延迟
+struct CadenceRule
+{
+    RecurringDetector::Cadence cadence;
+    int minDays;
+    int maxDays;
+    int tolerance;
+};
+
+static const CadenceRule CADENCE_RULES[] = {
+    { RecurringDetector::Weekly, 6, 8, 1 },
+    { RecurringDetector::Monthly, 27, 33, 3 },
+    { RecurringDetector::Yearly, 350, 380, 10 },
+};
+
+// 至少这个比例的间隔符合周期才算规律扣费
+static const double MIN_REGULAR_RATIO = 0.75;
+
+// 同组内金额排序后，不超过簇内最小一笔 115% 的算同一簇，小幅调价仍留在同一序列；
+// 以簇首为界而不是与相邻一笔比较，逐笔相差不到 15% 的金额不会连成一条漂移的长链；
+// 按相对差切分没有固定档位边界，99.9 与 100.1 不会被分开
+static const qint64 AMOUNT_GAP_PERCENT = 115;
+
+// 排序扫描的一行：交易对方组 + 金额 + 日期
+struct SweepRow
+{
+    quint32 group;
+    qint32 day;
+    qint32 counterpartyId;
+    qint64 cents;
+};
+
+static bool amountLess(const SweepRow &a, const SweepRow &b)
+{
+    if (a.group != b.group)
+        return a.group < b.group;
+    return a.cents < b.cents || (a.cents == b.cents && a.day < b.day);
+}
+
+static bool dayLess(const SweepRow &a, const SweepRow &b)
+{
+    return a.day < b.day;
+}
+
+bool RecurringDetector::Series::operator==(const Series &other) const
+{
+    return counterpartyId == other.counterpartyId && cadence == other.cadence && cents == other.cents
+        && occurrences == other.occurrences && lastDate == other.lastDate;
+}
+
+RecurringDetector::RecurringDetector()
+{
+}
+
+QString RecurringDetector::cadenceName(Cadence cadence)
+{
+    switch (cadence) {
+    case Weekly: return "每周";
+    case Monthly: return "每月";
+    case Yearly: return "每年";
+    }
+    return QString();
+}
+
+QDate RecurringDetector::advance(const QDate &day, Cadence cadence, int periods)
+{
+    switch (cadence) {
+    case Weekly: return day.addDays(7 * periods);
+    case Monthly: return day.addMonths(periods);
+    case Yearly: return day.addYears(periods);
+    }
+    return day;
+}
+
+QString RecurringDetector::normalizeName(const QString &name)
+{
+    QString normalized;
+    normalized.reserve(name.size());
+    for (const QChar &c : name.toLower()) {
+        if (c.isLetter())
+            normalized.append(c);
+    }
+
+    static const char *SUFFIXES[] = { "股份有限公司", "有限责任公司", "有限公司", "公司" };
+    for (const char *suffix : SUFFIXES) {
+        QString text = QString::fromUtf8(suffix);
+        if (normalized.size() > text.size() && normalized.endsWith(text)) {
+            normalized.chop(text.size());
+            break;
+        }
+    }
+    return normalized;
+}
+
+QVector<RecurringDetector::Series> RecurringDetector::detect(const BillColumnStore &store,
+                                                             const QHash<int, QString> &names, const QDate &today)
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    // 规范化后同名的交易对方合成一组；名称为空或全是数字符号的按原 id 单独成组
+    QHash<QString, int> groupOfName;
+    QHash<int, int> groupOf;
+    for (auto it = names.constBegin(); it != names.constEnd(); ++it) {
+        QString normalized = normalizeName(it.value());
+        if (normalized.isEmpty())
+            continue;
+        auto found = groupOfName.constFind(normalized);
+        if (found == groupOfName.constEnd())
+            found = groupOfName.insert(normalized, it.key());
+        groupOf.insert(it.key(), found.value());
+    }
+
+    QVector<BillColumnStore::Charge> charges = store.charges(false);
+    QVector<SweepRow> rows;
+    rows.reserve(charges.size());
+    for (const BillColumnStore::Charge &charge : charges) {
+        if (charge.cents <= 0)
+            continue;
+        SweepRow row;
+        row.group = static_cast<quint32>(groupOf.value(charge.counterpartyId, charge.counterpartyId));
+        row.day = charge.day;
+        row.counterpartyId = charge.counterpartyId;
+        row.cents = charge.cents;
+        rows.append(row);
+    }
+    std::sort(rows.begin(), rows.end(), amountLess);
+
+    QVector<Series> result;
+    QVector<int> intervals;
+    const int n = rows.size();
+    for (int begin = 0; begin < n; ) {
+        int end = begin + 1;
+        while (end < n && rows[end].group == rows[begin].group
+               && rows[end].cents * 100 <= rows[begin].cents * AMOUNT_GAP_PERCENT)
+            ++end;
+        // 簇内改按日期排列，各簇互不重叠，总耗时仍是一次排序
+        std::sort(rows.begin() + begin, rows.begin() + end, dayLess);
+
+        // 同一天的多笔只算一次扣费
+        intervals.clear();
+        int occurrences = 1;
+        int last = begin;
+        for (int i = begin + 1; i < end; ++i) {
+            if (rows[i].day == rows[last].day) {
+                last = i;
+                continue;
+            }
+            intervals.append(rows[i].day - rows[last].day);
+            last = i;
+            ++occurrences;
+        }
+
+        if (occurrences >= MIN_YEARLY_OCCURRENCES) {
+            QVector<int> sorted = intervals;
+            std::nth_element(sorted.begin(), sorted.begin() + sorted.size() / 2, sorted.end());
+            int median = sorted[sorted.size() / 2];
+
+            for (const CadenceRule &rule : CADENCE_RULES) {
+                if (median < rule.minDays || median > rule.maxDays)
+                    continue;
+                // 只有两次的年度扣费证据较弱，要求两次金额完全相同
+                if (occurrences < MIN_OCCURRENCES
+                        && (rule.cadence != Yearly || rows[begin].cents != rows[last].cents))
+                    break;
+
+                int regular = 0;
+                for (int interval : intervals) {
+                    if (interval >= rule.minDays && interval <= rule.maxDays)
+                        ++regular;
+                }
+                if (regular < MIN_REGULAR_RATIO * intervals.size())
+                    break;
+
+                Series series;
+                series.counterpartyId = rows[last].counterpartyId;
+                series.cadence = rule.cadence;
+                series.cents = rows[last].cents;
+                series.occurrences = occurrences;
+                series.firstDate = QDate::fromJulianDay(rows[begin].day);
+                series.lastDate = QDate::fromJulianDay(rows[last].day);
+                series.nextDate = advance(series.lastDate, rule.cadence);
+
+                // 连续两个周期都没有扣费，视为已经停止（账单可能还没导入，留出一个周期）
+                if (advance(series.lastDate, rule.cadence, 2).addDays(rule.tolerance) >= today)
+                    result.append(series);
+                break;
+            }
+        }
+        begin = end;
+    }
+
+    qDebug() << "周期扣费检测完成，账单数:" << rows.size() << "周期序列:" << result.size()
+             << "耗时" << timer.elapsed() << "ms";
+    return result;
+}
+
+bool RecurringDetector::store(const QVector<Series> &series)
+{
+    QMutexLocker locker(&lock);
+    bool changed = !detected || !(series == lastResult);
+    lastResult = series;
+    detected = true;
+    return changed;
+}
+
+QVector<RecurringDetector::Series> RecurringDetector::series() const
+{
+    QMutexLocker locker(&lock);
+    return lastResult;
+}
+
+bool RecurringDetector::hasResult() const
+{
+    QMutexLocker locker(&lock);
+    return detected;
+}
+
+void RecurringDetector::clear()
+{
+    QMutexLocker locker(&lock);
+    lastResult.clear();
+    detected = false;
+}
@@ -0,0 +1,62 @@
+#ifndef RECURRING_DETECTOR_H
+#define RECURRING_DETECTOR_H
+
+#include <QVector>
+#include <QHash>
+#include <QDate>
+#include <QString>
+#include <QMutex>
+
+class BillColumnStore;
+
+// 周期性扣费（订阅、会员、房租等）检测。
+// 支出按规范化后的交易对方分组、组内按金额排序一次，排序后相邻金额相差不超过 15% 的归为一簇，
+// 簇内再按日期排序，用相邻两次扣费的间隔中位数判断是否为每周 / 每月 / 每年扣费。
+// 检测耗时是一次 O(n log n) 排序加一次线性扫描，由后台任务执行，结果留到下一次检测前复用。
+class RecurringDetector
+{
+public:
+    enum Cadence { Weekly = 0, Monthly, Yearly };
+
+    // 一个周期性扣费序列
+    struct Series {
+        int counterpartyId = 0;     // 最近一次扣费的交易对方
+        Cadence cadence = Monthly;
+        qint64 cents = 0;           // 最近一次扣费金额（单位：分）
+        int occurrences = 0;
+        QDate firstDate;
+        QDate lastDate;
+        QDate nextDate;             // 按周期推算的下一次扣费日期
+
+        bool operator==(const Series &other) const;
+    };
+
+    // 参与判断的最少扣费次数
+    static const int MIN_OCCURRENCES = 3;
+    static const int MIN_YEARLY_OCCURRENCES = 2;
+
+    RecurringDetector();
+
+    static QString cadenceName(Cadence cadence);
+    static QDate advance(const QDate &day, Cadence cadence, int periods = 1);
+
+    // 规范化商户名：去掉数字、空白和标点，英文转小写，"XX有限公司" 之类的后缀也去掉，
+    // 让 "Netflix.com 1234" 与 "NETFLIX.COM" 归为同一个交易对方
+    static QString normalizeName(const QString &name);
+
+    // 在列式快照上检测；names 为 counterparty_id -> 名称，today 之前已中断的序列不返回
+    static QVector<Series> detect(const BillColumnStore &store, const QHash<int, QString> &names, const QDate &today);
+
+    // 后台检测完成后保存结果，返回结果是否与上一次不同
+    bool store(const QVector<Series> &series);
+    QVector<Series> series() const;
+    bool hasResult() const;
+    void clear();
+
+private:
+    QVector<Series> lastResult;
+    bool detected = false;
+    mutable QMutex lock;
+};
+
+#endif // RECURRING_DETECTOR_H
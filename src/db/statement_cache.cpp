@@ -0,0 +1,62 @@
+#include "statement_cache.h"
+
+#include <QSqlError>
+#include <QDebug>
+
+StatementCache::StatementCache()
+{
+}
+
+void StatementCache::setDatabase(const QSqlDatabase &database)
+{
+    clear();
+    db = database;
+}
+
+void StatementCache::clear()
+{
+    for (Entry &entry : entries) {
+        entry.query.finish();
+    }
+    entries.clear();
+}
+
+QSqlQuery StatementCache::statement(const QString &id, const QString &sql)
+{
+    auto it = entries.find(id);
+    if (it != entries.end() && it.value().sql == sql) {
+        ++hitCount;
+        // 复位上一次的执行状态，释放读锁
+        it.value().query.finish();
+        return it.value().query;
+    }
+
+    ++missCount;
+    QSqlQuery query(db);
+    if (!query.prepare(sql)) {
+        qDebug() << "预编译语句失败:" << id << query.lastError().text();
+        entries.remove(id);
+        return query;
+    }
+
+    Entry entry;
+    entry.sql = sql;
+    entry.query = query;
+    entries.insert(id, entry);
+    return query;
+}
+
+int StatementCache::hits() const
+{
+    return hitCount;
+}
+
+int StatementCache::misses() const
+{
+    return missCount;
+}
+
+int StatementCache::size() const
+{
+    return entries.size();
+}
@@ -0,0 +1,39 @@
+#ifndef STATEMENT_CACHE_H
+#define STATEMENT_CACHE_H
+
+#include <QSqlDatabase>
+#include <QSqlQuery>
+#include <QHash>
+
+// 单个连接上的预编译语句缓存。
+// 同一 id 的语句只 prepare 一次，之后每次取出时先 reset，再由调用方重新绑定参数执行。
+// 返回的 QSqlQuery 与缓存共享同一条语句，只适合在函数内读完即 finish() 的查询，
+// 需要把结果交给调用方遍历的查询不要放进缓存。
+class StatementCache
+{
+public:
+    StatementCache();
+
+    void setDatabase(const QSqlDatabase &database);
+    void clear();
+
+    // id 相同但 SQL 文本变了（例如换了分区表）时重新 prepare，记为未命中
+    QSqlQuery statement(const QString &id, const QString &sql);
+
+    int hits() const;
+    int misses() const;
+    int size() const;
+
+private:
+    struct Entry {
+        QString sql;
+        QSqlQuery query;
+    };
+
+    QSqlDatabase db;
+    QHash<QString, Entry> entries;
+    int hitCount = 0;
+    int missCount = 0;
+};
+
+#endif // STATEMENT_CACHE_H
@@ -1,9 +1,13 @@
 #include "mainwindow.h"
 #include "./ui_mainwindow.h"
 #include "./src/db/database_manager.h"
+#include "./src/db/maintenance_scheduler.h"
+#include "./src/db/db_executor.h"
 #include "./src/ui/weekviewwidget.h"
 #include "./src/ui/monthviewwidget.h"
 #include "./src/ui/yearviewwidget.h"
+#include "./src/ui/rangeviewwidget.h"
+#include "./src/ui/pivotviewwidget.h"
 #include "./src/ui/daydetailwidget.h"
 #include "./src/ui/helpdialog.h"
 #include <QFileDialog>
@@ -14,6 +18,9 @@
 #include <QStackedWidget>
 #include <QPushButton>
 #include <QLabel>
+#include <QMenu>
+#include <QInputDialog>
+#include <QApplication>
 
 
 MainWindow::MainWindow(QWidget *parent)
@@ -33,6 +40,20 @@ MainWindow::MainWindow(QWidget *parent)
 
     db.insertDefaultTables();
 
+    maintenanceScheduler = new MaintenanceScheduler(db.databasePath(), this);
+    maintenanceScheduler->start();
+
+    // 区间合计索引在数据库线程上预先建好，之后的区间查询不必再等首次加载
+    DbExecutor::instance().run<bool>([]() {
+        return DatabaseManager::instance().dailySums().isLoaded();
+    });
+
+    // 周期性扣费检测在后台低优先级执行；之后每次写入都重新计时，空闲 2 秒再检测
+    recurringTimer.setSingleShot(true);
+    recurringTimer.setInterval(2000);
+    connect(&recurringTimer, &QTimer::timeout, this, &MainWindow::runRecurringDetection);
+    runRecurringDetection();
+
     // 检查数据库是否为空，决定显示空状态还是默认视图
     // TODO: 连接数据库检查逻辑
 
@@ -100,6 +121,8 @@ MainWindow::MainWindow(QWidget *parent)
 
 MainWindow::~MainWindow()
 {
+    // 查询线程上的只读连接要在数据库管理器析构前关闭
+    DbExecutor::instance().shutdown();
     delete ui;
 }
 
@@ -193,6 +216,21 @@ void MainWindow::setupTopBar()
     );
     connect(importButton, &QPushButton::clicked, this, &MainWindow::onImportClicked);
     topLayout->addWidget(importButton);
+
+    // 耗时较长、不常用的数据库操作放在菜单里，由用户手动触发
+    toolsButton = new QPushButton("维护", topBar);
+    toolsButton->setFixedSize(80, 35);
+    toolsButton->setStyleSheet(importButton->styleSheet() +
+        "QPushButton::menu-indicator { width: 0; }");
+    QMenu *toolsMenu = new QMenu(toolsButton);
+    toolsMenu->addAction("整理数据库", this, &MainWindow::onCompactClicked);
+    toolsMenu->addSeparator();
+    toolsMenu->addAction("按年份分区存储", this, &MainWindow::onPartitionClicked);
+    toolsMenu->addAction("设置年份分区模式", this, &MainWindow::onPartitionModeClicked);
+    toolsMenu->addSeparator();
+    toolsMenu->addAction("视图加载耗时", this, &MainWindow::onLoadTimesClicked);
+    toolsButton->setMenu(toolsMenu);
+    topLayout->addWidget(toolsButton);
     topLayout->addSpacing(10);
 }
 
@@ -239,6 +277,16 @@ void MainWindow::setupSideBar()
     connect(yearButton, &QPushButton::clicked, this, &MainWindow::onYearViewClicked);
     sideLayout->addWidget(yearButton);
 
+    rangeButton = new QPushButton("自定义", sideBar);
+    rangeButton->setCheckable(true);
+    connect(rangeButton, &QPushButton::clicked, this, &MainWindow::onRangeViewClicked);
+    sideLayout->addWidget(rangeButton);
+
+    pivotButton = new QPushButton("透视", sideBar);
+    pivotButton->setCheckable(true);
+    connect(pivotButton, &QPushButton::clicked, this, &MainWindow::onPivotViewClicked);
+    sideLayout->addWidget(pivotButton);
+
     sideLayout->addStretch();
 }
 
@@ -277,6 +325,8 @@ void MainWindow::setupContentArea()
     weekViewWidget = new WeekViewWidget();
     monthViewWidget = new MonthViewWidget();
     yearViewWidget = new YearViewWidget();
+    rangeViewWidget = new RangeViewWidget();
+    pivotViewWidget = new PivotViewWidget();
     dayDetailWidget = new DayDetailWidget();
 
     connect(weekViewWidget, &WeekViewWidget::dayClicked, this, &MainWindow::showDayDetailView);
@@ -290,89 +340,74 @@ void MainWindow::setupContentArea()
     contentStack->addWidget(weekViewWidget);
     contentStack->addWidget(monthViewWidget);
     contentStack->addWidget(yearViewWidget);
+    contentStack->addWidget(rangeViewWidget);
+    contentStack->addWidget(pivotViewWidget);
     contentStack->addWidget(dayDetailWidget);
 }
 
 void MainWindow::showEmptyState()
 {
     contentStack->setCurrentWidget(emptyStateWidget);
-    // 禁用左侧栏按钮
-    weekButton->setEnabled(false);
-    monthButton->setEnabled(false);
-    yearButton->setEnabled(false);
-
-    // 取消所有按钮的选中状态
-    weekButton->setChecked(false);
-    monthButton->setChecked(false);
-    yearButton->setChecked(false);
-
-    // 重置按钮样式
-    weekButton->setStyleSheet("");
-    monthButton->setStyleSheet("");
-    yearButton->setStyleSheet("");
+    // 禁用左侧栏按钮，取消选中并重置样式
+    for (QPushButton *button : sideButtons()) {
+        button->setEnabled(false);
+        button->setChecked(false);
+        button->setStyleSheet("");
+    }
+}
+
+QList<QPushButton *> MainWindow::sideButtons() const
+{
+    return { weekButton, monthButton, yearButton, rangeButton, pivotButton };
+}
+
+// 启用左侧栏按钮，只有当前视图的按钮保持选中样式
+void MainWindow::activateSideButton(QPushButton *active)
+{
+    for (QPushButton *button : sideButtons()) {
+        button->setEnabled(true);
+        button->setChecked(button == active);
+        button->setStyleSheet(button == active ?
+            "QPushButton { "
+            "background-color: #1e3a5f; "
+            "color: white; "
+            "}" : "");
+    }
 }
 
 void MainWindow::showWeekView()
 {
-    // 启用左侧栏按钮
-    weekButton->setEnabled(true);
-    monthButton->setEnabled(true);
-    yearButton->setEnabled(true);
     currentViewType = "week";
     contentStack->setCurrentWidget(weekViewWidget);
-    weekButton->setChecked(true);
-    weekButton->setStyleSheet(
-        "QPushButton { "
-        "background-color: #1e3a5f; "
-        "color: white; "
-        "}"
-    );
-    monthButton->setChecked(false);
-    yearButton->setChecked(false);
-    monthButton->setStyleSheet("");
-    yearButton->setStyleSheet("");
+    activateSideButton(weekButton);
 }
 
 void MainWindow::showMonthView()
 {
-    // 启用左侧栏按钮
-    weekButton->setEnabled(true);
-    monthButton->setEnabled(true);
-    yearButton->setEnabled(true);
     currentViewType = "month";
     contentStack->setCurrentWidget(monthViewWidget);
-    monthButton->setChecked(true);
-    monthButton->setStyleSheet(
-        "QPushButton { "
-        "background-color: #1e3a5f; "
-        "color: white; "
-        "}"
-    );
-    weekButton->setChecked(false);
-    yearButton->setChecked(false);
-    weekButton->setStyleSheet("");
-    yearButton->setStyleSheet("");
+    activateSideButton(monthButton);
 }
 
 void MainWindow::showYearView()
 {
-    // 启用左侧栏按钮
-    weekButton->setEnabled(true);
-    monthButton->setEnabled(true);
-    yearButton->setEnabled(true);
     currentViewType = "year";
     contentStack->setCurrentWidget(yearViewWidget);
-    yearButton->setChecked(true);
-    yearButton->setStyleSheet(
-        "QPushButton { "
-        "background-color: #1e3a5f; "
-        "color: white; "
-        "}"
-    );
-    weekButton->setChecked(false);
-    monthButton->setChecked(false);
-    weekButton->setStyleSheet("");
-    monthButton->setStyleSheet("");
+    activateSideButton(yearButton);
+}
+
+void MainWindow::showRangeView()
+{
+    currentViewType = "range";
+    contentStack->setCurrentWidget(rangeViewWidget);
+    activateSideButton(rangeButton);
+}
+
+void MainWindow::showPivotView()
+{
+    currentViewType = "pivot";
+    contentStack->setCurrentWidget(pivotViewWidget);
+    activateSideButton(pivotButton);
 }
 
 void MainWindow::showDayDetailView(const QString &date)
@@ -406,7 +441,12 @@ void MainWindow::onImportClicked()
         }
         QMessageBox::information(this, "导入", "文件路径: " + filePath);
 
-        db.importAlipayCsv(filePath);
+        if (!db.importAlipayCsv(filePath)) {
+            QMessageBox::warning(this, "导入", "导入失败，未写入任何记录，请查看日志");
+            return;
+        }
+        maintenanceScheduler->notifyWrite();
+        recurringTimer.start();
 
         // 导入后切换到周度视图
         showWeekView();
@@ -419,6 +459,95 @@ void MainWindow::onHelpClicked()
     helpDialog->exec();
 }
 
+// 完整 VACUUM 在主连接上同步执行，期间界面无响应，先让用户确认
+void MainWindow::onCompactClicked()
+{
+    DatabaseManager &db = DatabaseManager::instance();
+    if (!db.isReady()) {
+        QMessageBox::information(this, "整理数据库", "数据库未打开");
+        return;
+    }
+    if (QMessageBox::question(this, "整理数据库",
+            "整理会重写数据库文件并回收空闲空间，之后后台维护会自动增量回收。\n"
+            "数据较多时可能需要几分钟，期间无法操作。是否继续？") != QMessageBox::Yes)
+        return;
+
+    QApplication::setOverrideCursor(Qt::WaitCursor);
+    bool ok = db.compactDatabase();
+    QApplication::restoreOverrideCursor();
+    QMessageBox::information(this, "整理数据库", ok ? "整理完成" : "整理失败，请查看日志");
+}
+
+// 迁移后永久使用分区布局，不能撤销，先让用户确认
+void MainWindow::onPartitionClicked()
+{
+    DatabaseManager &db = DatabaseManager::instance();
+    if (!db.isReady()) {
+        QMessageBox::information(this, "按年份分区存储", "数据库未打开");
+        return;
+    }
+    if (db.isPartitioned()) {
+        QMessageBox::information(this, "按年份分区存储", "账单已经按年份分区存储");
+        return;
+    }
+    if (QMessageBox::question(this, "按年份分区存储",
+            "账单将按年份迁移到各自的文件（app_<年份>.db），主库只保留分类等字典表。\n"
+            "迁移后不能恢复为单文件存储，已结账的年份可以设为只读。是否继续？") != QMessageBox::Yes)
+        return;
+
+    QApplication::setOverrideCursor(Qt::WaitCursor);
+    bool ok = db.convertToPartitionedLayout();
+    QApplication::restoreOverrideCursor();
+    if (!ok) {
+        QMessageBox::warning(this, "按年份分区存储", "迁移失败，账单仍保留在主库中，请查看日志");
+        return;
+    }
+    QMessageBox::information(this, "按年份分区存储",
+        QString("迁移完成，共 %1 个年份").arg(db.partitionYearList().size()));
+    onDataChanged();
+}
+
+void MainWindow::onPartitionModeClicked()
+{
+    DatabaseManager &db = DatabaseManager::instance();
+    QList<int> years = db.isReady() && db.isPartitioned() ? db.partitionYearList() : QList<int>();
+    if (years.isEmpty()) {
+        QMessageBox::information(this, "设置年份分区模式", "请先按年份分区存储");
+        return;
+    }
+
+    QStringList yearItems;
+    for (int year : years)
+        yearItems << QString::number(year);
+    bool ok = false;
+    QString yearText = QInputDialog::getItem(this, "设置年份分区模式", "年份：", yearItems,
+                                             yearItems.size() - 1, false, &ok);
+    if (!ok)
+        return;
+    int year = yearText.toInt();
+
+    // 下标与 DatabaseManager::PartitionMode 的取值一致
+    QStringList modeItems = { "可读写", "只读", "只读且不再变化（不可变）" };
+    QString modeText = QInputDialog::getItem(this, "设置年份分区模式", QString("%1 年：").arg(year), modeItems,
+                                             static_cast<int>(db.partitionMode(year)), false, &ok);
+    if (!ok)
+        return;
+    DatabaseManager::PartitionMode mode = static_cast<DatabaseManager::PartitionMode>(modeItems.indexOf(modeText));
+    if (!db.setPartitionMode(year, mode))
+        QMessageBox::warning(this, "设置年份分区模式", "设置失败，请查看日志");
+}
+
+// 本次运行中各视图加载耗时的中位数，按读并行度分开列出；并行度由环境变量 EXPENSE_READ_THREADS 设置
+void MainWindow::onLoadTimesClicked()
+{
+    DbExecutor &executor = DbExecutor::instance();
+    QString summary = executor.loadTimeSummary();
+    if (summary.isEmpty())
+        summary = "还没有加载过视图";
+    QMessageBox::information(this, "视图加载耗时",
+        QString("当前读并行度：%1\n\n%2").arg(executor.readParallelism()).arg(summary));
+}
+
 void MainWindow::onWeekViewClicked()
 {
     showWeekView();
@@ -434,6 +563,16 @@ void MainWindow::onYearViewClicked()
     showYearView();
 }
 
+void MainWindow::onRangeViewClicked()
+{
+    showRangeView();
+}
+
+void MainWindow::onPivotViewClicked()
+{
+    showPivotView();
+}
+
 void MainWindow::onBackFromDetail()
 {
     if (currentViewType == "week") {
@@ -442,15 +581,50 @@ void MainWindow::onBackFromDetail()
         showMonthView();
     } else if (currentViewType == "year") {
         showYearView();
+    } else if (currentViewType == "range") {
+        showRangeView();
+    } else if (currentViewType == "pivot") {
+        showPivotView();
     }
 }
 
 
 void MainWindow::onDataChanged()
 {
+    maintenanceScheduler->notifyWrite();
+    recurringTimer.start();
+
     // 刷新所有视图的数据
     weekViewWidget->refreshData();
     monthViewWidget->refreshData();
     yearViewWidget->refreshData();
+    rangeViewWidget->refreshData();
+    pivotViewWidget->refreshData();
 }
 
+// 检测以低优先级在读连接池中执行，不阻塞工作线程上的视图加载；
+// 结果有变化时刷新显示预计扣费的周度和月度视图
+void MainWindow::runRecurringDetection()
+{
+    if (recurringRunning) {
+        recurringPending = true;
+        return;
+    }
+    recurringRunning = true;
+    DbExecutor::instance().background<bool>(
+        []() {
+            return DatabaseManager::instance().detectRecurringCharges();
+        },
+        this,
+        [this](const bool &changed) {
+            recurringRunning = false;
+            if (changed) {
+                weekViewWidget->refreshData();
+                monthViewWidget->refreshData();
+            }
+            if (recurringPending) {
+                recurringPending = false;
+                runRecurringDetection();
+            }
+        });
+}
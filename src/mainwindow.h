@@ -8,12 +8,16 @@
 #include <QPushButton>
 #include <QLabel>
 #include <QWidget>
+#include <QTimer>
 
 // 前向声明
 class WeekViewWidget;
 class MonthViewWidget;
 class YearViewWidget;
+class RangeViewWidget;
+class PivotViewWidget;
 class DayDetailWidget;
+class MaintenanceScheduler;
 
 QT_BEGIN_NAMESPACE
 namespace Ui { class MainWindow; }
@@ -32,6 +36,8 @@ QT_END_NAMESPACE
  *      - 周度视图（WeekViewWidget）
  *      - 月度视图（MonthViewWidget）
  *      - 年度视图（YearViewWidget）
+ *      - 自定义区间视图（RangeViewWidget）
+ *      - 透视表视图（PivotViewWidget）
  *      - 单日详情视图（DayDetailWidget）
  *
  * 视图切换逻辑：
@@ -70,12 +76,19 @@ private slots:
      */
     void onImportClicked();
     void onHelpClicked();
+    void onCompactClicked();
+    void onPartitionClicked();
+    void onPartitionModeClicked();
+    void onLoadTimesClicked();
     void onWeekViewClicked();
     void onMonthViewClicked();
     void onYearViewClicked();
+    void onRangeViewClicked();
+    void onPivotViewClicked();
     void onBackFromDetail();
     void showDayDetailView(const QString &date);
      void onDataChanged();
+    void runRecurringDetection();
 
 private:
     void setupUI();
@@ -86,6 +99,10 @@ private:
     void showWeekView();
     void showMonthView();
     void showYearView();
+    void showRangeView();
+    void showPivotView();
+    QList<QPushButton *> sideButtons() const;
+    void activateSideButton(QPushButton *active);
 
     Ui::MainWindow *ui;
 
@@ -94,12 +111,15 @@ private:
     QLabel *appTitleLabel;
     QPushButton *helpButton;
     QPushButton *importButton;
+    QPushButton *toolsButton;       // 数据库维护菜单
 
     // 左侧栏组件
     QWidget *sideBar;
     QPushButton *weekButton;
     QPushButton *monthButton;
     QPushButton *yearButton;
+    QPushButton *rangeButton;
+    QPushButton *pivotButton;
 
     // 主内容区
     QStackedWidget *contentStack;
@@ -107,10 +127,21 @@ private:
     WeekViewWidget *weekViewWidget;        // 周度视图
     MonthViewWidget *monthViewWidget;      // 月度视图
     YearViewWidget *yearViewWidget;        // 年度视图
+    RangeViewWidget *rangeViewWidget;      // 自定义区间视图
+    PivotViewWidget *pivotViewWidget;      // 透视表视图
     DayDetailWidget *dayDetailWidget;
 
+    // 空闲时的后台数据库维护
+    MaintenanceScheduler *maintenanceScheduler;
+
+    // 写入停止一段时间后在后台重新检测周期性扣费
+    QTimer recurringTimer;
+    // 检测进行中又被触发时只记一笔，当前这次结束后再跑一次
+    bool recurringRunning = false;
+    bool recurringPending = false;
+
     // 当前选中的视图类型
-    QString currentViewType;        // "week", "month", "year"
+    QString currentViewType;        // "week", "month", "year", "range", "pivot"
     QString currentTransactionType; // "支出", "收入"
 };
 
@@ -0,0 +1,115 @@
+#include "budgetdialog.h"
+#include <QVBoxLayout>
+#include <QHBoxLayout>
+#include <QScrollArea>
+#include <QLabel>
+#include <QDoubleValidator>
+#include <QDebug>
+#include "../db/database_manager.h"
+
+BudgetDialog::BudgetDialog(QWidget *parent)
+    : QDialog(parent)
+{
+    setWindowTitle("分类月度预算");
+    setFixedSize(420, 600);
+    setStyleSheet("QDialog { background-color: #f0f4f8; }");
+
+    setupUI();
+    loadBudgets();
+}
+
+void BudgetDialog::setupUI()
+{
+    QVBoxLayout *mainLayout = new QVBoxLayout(this);
+    mainLayout->setSpacing(15);
+    mainLayout->setContentsMargins(20, 20, 20, 20);
+
+    QLabel *hintLabel = new QLabel("每月额度（元），留空表示不设预算");
+    hintLabel->setStyleSheet("QLabel { color: #666; background: transparent; }");
+    mainLayout->addWidget(hintLabel);
+
+    // 支出分类较多，放进滚动区域
+    QWidget *formWidget = new QWidget();
+    formWidget->setStyleSheet("QWidget { background-color: white; }");
+    formLayout = new QFormLayout(formWidget);
+    formLayout->setSpacing(10);
+    formLayout->setLabelAlignment(Qt::AlignRight);
+
+    QScrollArea *scrollArea = new QScrollArea();
+    scrollArea->setWidgetResizable(true);
+    scrollArea->setStyleSheet("QScrollArea { border: 1px solid #d0d8e0; border-radius: 5px; background-color: white; }");
+    scrollArea->setWidget(formWidget);
+    mainLayout->addWidget(scrollArea, 1);
+
+    QHBoxLayout *buttonLayout = new QHBoxLayout();
+    buttonLayout->addStretch();
+
+    confirmButton = new QPushButton("确定");
+    confirmButton->setFixedSize(80, 35);
+    confirmButton->setStyleSheet(
+        "QPushButton { "
+        "background-color: #3b6ea5; "
+        "color: white; "
+        "border: none; "
+        "border-radius: 5px; "
+        "}"
+        "QPushButton:hover { background-color: #4a7fb8; }"
+    );
+    connect(confirmButton, &QPushButton::clicked, this, &BudgetDialog::onConfirmClicked);
+
+    cancelButton = new QPushButton("取消");
+    cancelButton->setFixedSize(80, 35);
+    cancelButton->setStyleSheet(
+        "QPushButton { "
+        "background-color: #e0e8f0; "
+        "color: #333; "
+        "border: none; "
+        "border-radius: 5px; "
+        "}"
+        "QPushButton:hover { background-color: #d0d8e0; }"
+    );
+    connect(cancelButton, &QPushButton::clicked, this, &QDialog::reject);
+
+    buttonLayout->addWidget(confirmButton);
+    buttonLayout->addWidget(cancelButton);
+    mainLayout->addLayout(buttonLayout);
+}
+
+void BudgetDialog::loadBudgets()
+{
+    DatabaseManager &db = DatabaseManager::instance();
+    if (!db.isReady()) {
+        if (!db.openDatabase()) {
+            qDebug() << "打开预算设置时数据库开启失败";
+            return;
+        }
+    }
+
+    savedBudgets = db.getBudgets();
+    QMap<int, QString> categories = db.getCategories("expense");
+    for (auto it = categories.constBegin(); it != categories.constEnd(); ++it) {
+        QLineEdit *edit = new QLineEdit();
+        edit->setPlaceholderText("不设预算");
+        QDoubleValidator *validator = new QDoubleValidator(0, 1e9, 2, edit);
+        validator->setNotation(QDoubleValidator::StandardNotation);
+        edit->setValidator(validator);
+        if (savedBudgets.contains(it.key()))
+            edit->setText(QString::number(savedBudgets.value(it.key()), 'f', 2));
+
+        formLayout->addRow(it.value() + ":", edit);
+        amountEdits.insert(it.key(), edit);
+    }
+}
+
+void BudgetDialog::onConfirmClicked()
+{
+    DatabaseManager &db = DatabaseManager::instance();
+    for (auto it = amountEdits.constBegin(); it != amountEdits.constEnd(); ++it) {
+        double amount = it.value()->text().trimmed().toDouble();
+        if (qFuzzyCompare(amount + 1, savedBudgets.value(it.key(), 0) + 1))
+            continue;
+        if (!db.setBudget(it.key(), amount))
+            qDebug() << "保存预算失败，分类:" << it.key();
+    }
+    accept();
+}
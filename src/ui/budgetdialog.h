@@ -0,0 +1,43 @@
+#ifndef BUDGETDIALOG_H
+#define BUDGETDIALOG_H
+
+#include <QDialog>
+#include <QLineEdit>
+#include <QFormLayout>
+#include <QPushButton>
+#include <QMap>
+
+/**
+ * @brief 分类月度预算对话框
+ *
+ * 功能说明：
+ * - 列出全部支出分类，每个分类一个月度额度输入框
+ * - 留空或填 0 表示该分类不设预算
+ * - 确认后逐项写回数据库，只提交有变化的分类
+ *
+ * 用途：
+ * - 由月度视图的"预算"按钮打开，保存后月度视图重新评估预算执行情况
+ */
+
+class BudgetDialog : public QDialog
+{
+    Q_OBJECT
+
+public:
+    explicit BudgetDialog(QWidget *parent = nullptr);
+
+private slots:
+    void onConfirmClicked();
+
+private:
+    void setupUI();
+    void loadBudgets();
+
+    QFormLayout *formLayout;
+    QMap<int, QLineEdit*> amountEdits;   // 分类 id -> 额度输入框
+    QMap<int, double> savedBudgets;      // 打开时的额度，用于只提交变化的分类
+    QPushButton *confirmButton;
+    QPushButton *cancelButton;
+};
+
+#endif // BUDGETDIALOG_H
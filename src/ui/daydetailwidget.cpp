@@ -9,7 +9,9 @@
 #include <QJsonDocument>
 #include <QSqlQuery>
 #include <QDebug>
+#include <QElapsedTimer>
 #include "../db/database_manager.h"
+#include "../db/db_executor.h"
 #include "weekviewwidget.h"
 #include "monthviewwidget.h"
 #include "yearviewwidget.h"
@@ -67,6 +69,20 @@ void DayDetailWidget::setupHeader()
     connect(addButton, &QPushButton::clicked, this, &DayDetailWidget::onAddClicked);
     headerLayout->addWidget(addButton);
 
+    // 异常提示：当天合计或某几笔远高于平常时显示，悬停看原因
+    anomalyLabel = new QLabel();
+    anomalyLabel->setStyleSheet(
+        "QLabel { "
+        "background-color: #fdebd0; "
+        "color: #c0392b; "
+        "border: 1px solid #f5c28b; "
+        "border-radius: 5px; "
+        "padding: 6px 10px; "
+        "}"
+    );
+    anomalyLabel->hide();
+    headerLayout->addWidget(anomalyLabel);
+
     headerLayout->addStretch();
 
     dateCardLabel = new QLabel();
@@ -146,103 +162,121 @@ void DayDetailWidget::loadDayData(const QString &date)
             return;
         }
     }
-    QSqlQuery query;
-
-    // 载入数据
-
-        QJsonObject testData;
-        testData["operation"] = true;
-        query = db.getTotalRecordsByDay(date);
-        query.next();
-        double income = query.value(1).toDouble();
-        double expense = query.value(0).toDouble();
-        testData["dailyIncome"] = income;
-        testData["dailyExpense"] = expense;
-
-        QJsonArray records;
-        QJsonObject record1;
-        query = db.getRecordsByDay(date);
-        while(query.next()){
-            record1["id"] = query.value(0).toInt();
-            record1["transactionDate"] = query.value(1).toString();
-            record1["amount"] = query.value(5).toDouble();
-            if(query.value(6).toString()=="income"){
-                record1["transactionType"] = "收入";
-            }
-            else{
-                record1["transactionType"] = "支出";
-            }
-            switch(query.value(7).toInt()){
-                case 1:record1["category"] = "餐饮美食";break;
-                case 2:record1["category"] = "服饰装扮";break;
-                case 3:record1["category"] = "日用百货";break;
-                case 4:record1["category"] = "家居家装";break;
-                case 5:record1["category"] = "数码电器";break;
-                case 6:record1["category"] = "运动户外";break;
-                case 7:record1["category"] = "美容美发";break;
-                case 8:record1["category"] = "母婴亲子";break;
-                case 9:record1["category"] = "宠物";break;
-                case 10:record1["category"] = "交通出行";break;
-                case 11:record1["category"] = "爱车养车";break;
-                case 12:record1["category"] = "住房物业";break;
-                case 13:record1["category"] = "酒店旅游";break;
-                case 14:record1["category"] = "文化休闲";break;
-                case 15:record1["category"] = "教育培训";break;
-                case 16:record1["category"] = "医疗健康";break;
-                case 17:record1["category"] = "生活服务";break;
-                case 18:record1["category"] = "公共服务";break;
-                case 19:record1["category"] = "商业服务";break;
-                case 20:record1["category"] = "公益捐赠";break;
-                case 21:record1["category"] = "互助保障";break;
-                case 22:record1["category"] = "投资理财";break;
-                case 23:record1["category"] = "保险";break;
-                case 24:record1["category"] = "信用借还";break;
-                case 25:record1["category"] = "充值缴费";break;
-                case 26:record1["category"] = "其他";break;
-                case 27:record1["category"] = "收入";break;
-                case 28:record1["category"] = "转账红包";break;
-                case 29:record1["category"] = "亲友代付";break;
-                case 30:record1["category"] = "账户存取";break;
-                case 31:record1["category"] = "退款";break;
-                case 32:record1["category"] = "其他";break;
-                default:record1["category"] = "其他";break;
-            }
-
-            if(query.value(8).toInt()==1){
-                record1["transactionMethod"] = "支付宝";
-            }
-            else if(query.value(8).toInt()==2){
-                record1["transactionMethod"] = "现金";
-            }
-            else{
-                record1["transactionMethod"] = "其他";
-            }
-            record1["counterparty"] = query.value(9).toString();
-            record1["productName"] = query.value(10).toString();
-            record1["remark"] = query.value(11).toString();
-            record1["sourceId"] = query.value(12).toString();
-            records.append(record1);
-        }
 
-        testData["records"] = records;
-
-        updateDayData(testData);
+    // 当天的合计、记录和异常打分都在数据库线程上查询，先显示占位；结果回来时如果已经切到别的日期就丢弃
+    int generation = ++loadGeneration;
+    showLoadingState();
+    QElapsedTimer timer;
+    timer.start();
+    DbExecutor::instance().run<QJsonObject>(
+        [date]() {
+            return fetchDayData(date);
+        },
+        this,
+        [this, generation, timer](const QJsonObject &response) {
+            if (generation != loadGeneration)
+                return;
+            DbExecutor::instance().recordLoadTime("day", timer.elapsed());
+            updateDayData(response);
+        });
+}
 
-    // 更新日期卡片
-    //dateCardLabel->setText(QString("日期: %1\n交易笔数: 0\n总金额: ￥0.00")
-        //.arg(date));
+// 在数据库线程上执行，只使用参数，不访问界面
+QJsonObject DayDetailWidget::fetchDayData(const QString &date)
+{
+    DatabaseManager &db = DatabaseManager::instance();
 
-    // TODO: 调用后端接口获取数据
+    QJsonObject response;
+    response["operation"] = true;
+    DayTotal dayTotal = db.getTotalRecordsByDay(date);
+    response["dailyIncome"] = dayTotal.income;
+    response["dailyExpense"] = dayTotal.expense;
+
+    // 异常打分（基线首次使用时要加载）与记录在同一次任务里完成，按记录 id 对上原因
+    QDate day = QDate::fromString(date, "yyyy-MM-dd");
+    QHash<int, QString> anomalyReasons;
+    for (const SpendAnomaly &anomaly : db.getAnomalies(day, day)) {
+        if (anomaly.recordId > 0)
+            anomalyReasons.insert(anomaly.recordId, anomaly.reason);
+        else
+            response["dayAnomaly"] = anomaly.reason;
+    }
 
-    //currentDate = date;
+    QJsonArray records;
+    QJsonObject record1;
+    for (const BillRecord &bill : db.getRecordsByDay(date)) {
+        record1["id"] = bill.id;
+        record1["transactionDate"] = bill.transactionDate;
+        record1["amount"] = bill.amount;
+        if(bill.transactionType=="income"){
+            record1["transactionType"] = "收入";
+        }
+        else{
+            record1["transactionType"] = "支出";
+        }
+        switch(bill.categoryId){
+            case 1:record1["category"] = "餐饮美食";break;
+            case 2:record1["category"] = "服饰装扮";break;
+            case 3:record1["category"] = "日用百货";break;
+            case 4:record1["category"] = "家居家装";break;
+            case 5:record1["category"] = "数码电器";break;
+            case 6:record1["category"] = "运动户外";break;
+            case 7:record1["category"] = "美容美发";break;
+            case 8:record1["category"] = "母婴亲子";break;
+            case 9:record1["category"] = "宠物";break;
+            case 10:record1["category"] = "交通出行";break;
+            case 11:record1["category"] = "爱车养车";break;
+            case 12:record1["category"] = "住房物业";break;
+            case 13:record1["category"] = "酒店旅游";break;
+            case 14:record1["category"] = "文化休闲";break;
+            case 15:record1["category"] = "教育培训";break;
+            case 16:record1["category"] = "医疗健康";break;
+            case 17:record1["category"] = "生活服务";break;
+            case 18:record1["category"] = "公共服务";break;
+            case 19:record1["category"] = "商业服务";break;
+            case 20:record1["category"] = "公益捐赠";break;
+            case 21:record1["category"] = "互助保障";break;
+            case 22:record1["category"] = "投资理财";break;
+            case 23:record1["category"] = "保险";break;
+            case 24:record1["category"] = "信用借还";break;
+            case 25:record1["category"] = "充值缴费";break;
+            case 26:record1["category"] = "其他";break;
+            case 27:record1["category"] = "收入";break;
+            case 28:record1["category"] = "转账红包";break;
+            case 29:record1["category"] = "亲友代付";break;
+            case 30:record1["category"] = "账户存取";break;
+            case 31:record1["category"] = "退款";break;
+            case 32:record1["category"] = "其他";break;
+            default:record1["category"] = "其他";break;
+        }
 
-    // 构造 API 2.2.4 请求
+        if(bill.methodId==1){
+            record1["transactionMethod"] = "支付宝";
+        }
+        else if(bill.methodId==2){
+            record1["transactionMethod"] = "现金";
+        }
+        else{
+            record1["transactionMethod"] = "其他";
+        }
+        record1["counterparty"] = bill.counterparty;
+        record1["productName"] = bill.description;
+        record1["remark"] = bill.remark;
+        record1["sourceId"] = bill.sourceId;
+        record1["anomaly"] = anomalyReasons.value(bill.id);
+        records.append(record1);
+    }
 
-    //QJsonObject request;
-    //request["date"] = date;
+    response["records"] = records;
+    return response;
+}
 
-    // 发送给后台
-    //emit queryDayRecords(request);
+// 查询期间清空表格，避免按行号操作到上一天的记录
+void DayDetailWidget::showLoadingState()
+{
+    dateCardLabel->setText(QString("日期: %1\n加载中…").arg(currentDate));
+    recordsTable->setRowCount(0);
+    anomalyLabel->hide();
 }
 
 void DayDetailWidget::updateDayData(const QJsonObject &data)
@@ -258,6 +292,10 @@ void DayDetailWidget::updateDayData(const QJsonObject &data)
         .arg(recordCount)
         .arg(dailyIncome + dailyExpense, 0, 'f', 2));
 
+    QStringList anomalies;
+    if (!data["dayAnomaly"].toString().isEmpty())
+        anomalies << data["dayAnomaly"].toString();
+
     QJsonArray records = data["records"].toArray();
     for (const QJsonValue &value : records) {
         QJsonObject record = value.toObject();
@@ -321,6 +359,31 @@ void DayDetailWidget::updateDayData(const QJsonObject &data)
         recordsTable->setItem(row, 8, new QTableWidgetItem(record["remark"].toString()));
         QString sourceId = record["sourceId"].isNull() ? "" : record["sourceId"].toString();
         recordsTable->setItem(row, 9, new QTableWidgetItem(sourceId));
+
+        // 异常的账单整行标橙，金额标红，悬停显示原因
+        QString anomaly = record["anomaly"].toString();
+        if (!anomaly.isEmpty()) {
+            anomalies << QString("%1 %2 ￥%3：%4")
+                             .arg(record["transactionDate"].toString().mid(11, 5))
+                             .arg(record["counterparty"].toString())
+                             .arg(amountValue, 0, 'f', 2)
+                             .arg(anomaly);
+            for (int column = 1; column < recordsTable->columnCount(); ++column) {
+                QTableWidgetItem *item = recordsTable->item(row, column);
+                item->setBackground(QColor("#fdebd0"));
+                item->setToolTip(anomaly);
+            }
+            amountItem->setForeground(QColor("#c0392b"));
+        }
+    }
+
+    if (anomalies.isEmpty()) {
+        anomalyLabel->hide();
+        anomalyLabel->setToolTip(QString());
+    } else {
+        anomalyLabel->setText(QString("异常 %1 项").arg(anomalies.size()));
+        anomalyLabel->setToolTip(anomalies.join("\n"));
+        anomalyLabel->show();
     }
 }
 
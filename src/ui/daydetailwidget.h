@@ -45,6 +45,7 @@
  *   "operation": true,
  *   "dailyIncome": 0.00,
  *   "dailyExpense": 2600.00,
+ *   "dayAnomaly": "",  // 可选，当天合计异常的原因，正常为空
  *   "records": [
  *     {
  *       "id": 1001,  // 可选，本地主键
@@ -56,7 +57,8 @@
  *       "counterparty": "XX电商平台",
  *       "productName": "智能手机",
  *       "remark": "分期购买",
- *       "sourceId": "202401152030001234567890"  // 可选，支付宝交易号
+ *       "sourceId": "202401152030001234567890",  // 可选，支付宝交易号
+ *       "anomaly": "餐饮美食单笔平均 ￥35.20，这笔高出 5.3 个标准差"  // 可选，异常原因，正常为空
  *     }
  *     // ... 更多记录
  *   ]
@@ -263,13 +265,19 @@ private:
      */
     void updateDayData(const QJsonObject &data);
 
+    // 在数据库线程上组装单日数据（合计、记录和异常原因），只使用参数，不访问界面
+    static QJsonObject fetchDayData(const QString &date);
+    void showLoadingState();
+
     QPushButton *backButton;
     QPushButton *addButton;
     QLabel *dateCardLabel;
+    QLabel *anomalyLabel;       // 当天的异常提示，没有异常时隐藏
     QTableWidget *recordsTable;
     QHBoxLayout *headerLayout;
 
     QString currentDate;
+    int loadGeneration = 0;  // 每次发起查询加一，用于丢弃过期的结果
 };
 
 #endif // DAYDETAILWIDGET_H
@@ -0,0 +1,197 @@
+#include "heatmapwidget.h"
+#include <QPainter>
+#include <QMouseEvent>
+#include <QHelpEvent>
+#include <QToolTip>
+#include <QFontMetrics>
+#include <QLinearGradient>
+#include <cmath>
+
+// 行标签区域宽度、列标签区域高度、底部图例高度
+static const int LABEL_WIDTH = 90;
+static const int HEADER_HEIGHT = 28;
+static const int LEGEND_HEIGHT = 36;
+
+static const QColor LOW_COLOR("#eef3f8");
+static const QColor HIGH_COLOR("#1e3a5f");
+
+static QColor blend(double t)
+{
+    return QColor::fromRgbF(LOW_COLOR.redF() + (HIGH_COLOR.redF() - LOW_COLOR.redF()) * t,
+                            LOW_COLOR.greenF() + (HIGH_COLOR.greenF() - LOW_COLOR.greenF()) * t,
+                            LOW_COLOR.blueF() + (HIGH_COLOR.blueF() - LOW_COLOR.blueF()) * t);
+}
+
+HeatmapWidget::HeatmapWidget(QWidget *parent)
+    : QWidget(parent)
+{
+    setMouseTracking(true);
+    setFont(QFont("DengXian", 10));
+    // 整个区域每次都完整重画，省去 Qt 先擦背景
+    setAttribute(Qt::WA_OpaquePaintEvent);
+}
+
+QSize HeatmapWidget::minimumSizeHint() const
+{
+    return QSize(LABEL_WIDTH + 24 * 16, HEADER_HEIGHT + 7 * 20 + LEGEND_HEIGHT);
+}
+
+void HeatmapWidget::setTable(const PivotTable &table)
+{
+    pivot = table;
+    hoveredCell = -1;
+
+    maxValue = 0;
+    for (double value : pivot.cells)
+        maxValue = qMax(maxValue, value);
+
+    cellColors.resize(pivot.cells.size());
+    for (int i = 0; i < pivot.cells.size(); ++i) {
+        double t = maxValue > 0 ? std::sqrt(qMax(0.0, pivot.cells[i]) / maxValue) : 0;
+        cellColors[i] = blend(t);
+    }
+
+    layoutGrid();
+    update();
+}
+
+void HeatmapWidget::resizeEvent(QResizeEvent *event)
+{
+    QWidget::resizeEvent(event);
+    layoutGrid();
+}
+
+// 网格铺满标签和图例以外的区域；列标签按字宽决定间隔，避免重叠
+void HeatmapWidget::layoutGrid()
+{
+    gridRect = rect().adjusted(LABEL_WIDTH, HEADER_HEIGHT, -10, -LEGEND_HEIGHT);
+    int rows = pivot.rowCount();
+    int columns = pivot.columnCount();
+    cellWidth = columns > 0 ? gridRect.width() / double(columns) : 0;
+    cellHeight = rows > 0 ? gridRect.height() / double(rows) : 0;
+
+    int widest = 0;
+    QFontMetrics metrics(font());
+    for (const QString &label : pivot.columnLabels)
+        widest = qMax(widest, metrics.boundingRect(label).width());
+    labelStep = 1;
+    while (cellWidth > 0 && labelStep * cellWidth < widest + 6)
+        ++labelStep;
+}
+
+QRect HeatmapWidget::cellRect(int row, int column) const
+{
+    int left = gridRect.left() + static_cast<int>(column * cellWidth);
+    int top = gridRect.top() + static_cast<int>(row * cellHeight);
+    int right = gridRect.left() + static_cast<int>((column + 1) * cellWidth);
+    int bottom = gridRect.top() + static_cast<int>((row + 1) * cellHeight);
+    return QRect(left, top, right - left, bottom - top);
+}
+
+int HeatmapWidget::cellAt(const QPoint &pos) const
+{
+    if (!gridRect.contains(pos) || cellWidth <= 0 || cellHeight <= 0)
+        return -1;
+    int column = static_cast<int>((pos.x() - gridRect.left()) / cellWidth);
+    int row = static_cast<int>((pos.y() - gridRect.top()) / cellHeight);
+    if (row < 0 || row >= pivot.rowCount() || column < 0 || column >= pivot.columnCount())
+        return -1;
+    return row * pivot.columnCount() + column;
+}
+
+void HeatmapWidget::paintEvent(QPaintEvent *)
+{
+    QPainter painter(this);
+    painter.fillRect(rect(), QColor("#f5f8fb"));
+
+    const int rows = pivot.rowCount();
+    const int columns = pivot.columnCount();
+    if (rows == 0 || columns == 0) {
+        painter.setPen(QColor("#999999"));
+        painter.drawText(rect(), Qt::AlignCenter, "暂无数据");
+        return;
+    }
+
+    // 1. 单元格：颜色已在 setTable 中算好，这里只填充
+    for (int r = 0; r < rows; ++r) {
+        for (int c = 0; c < columns; ++c)
+            painter.fillRect(cellRect(r, c).adjusted(0, 0, -1, -1), cellColors[r * columns + c]);
+    }
+
+    // 2. 悬停描边
+    if (hoveredCell >= 0) {
+        painter.setPen(QPen(QColor("#d97706"), 2));
+        painter.setBrush(Qt::NoBrush);
+        painter.drawRect(cellRect(hoveredCell / columns, hoveredCell % columns).adjusted(1, 1, -2, -2));
+    }
+
+    // 3. 行标签与列标签
+    painter.setPen(QColor("#3b6ea5"));
+    for (int r = 0; r < rows; ++r) {
+        QRect cell = cellRect(r, 0);
+        QRect labelRect(0, cell.top(), LABEL_WIDTH - 8, cell.height());
+        QString label = painter.fontMetrics().elidedText(pivot.rowLabels.value(r), Qt::ElideRight, labelRect.width());
+        painter.drawText(labelRect, Qt::AlignRight | Qt::AlignVCenter, label);
+    }
+    for (int c = 0; c < columns; c += labelStep) {
+        QRect cell = cellRect(0, c);
+        QRect labelRect(cell.left() - 20, 0, cell.width() + 40, HEADER_HEIGHT - 4);
+        painter.drawText(labelRect, Qt::AlignHCenter | Qt::AlignBottom, pivot.columnLabels.value(c));
+    }
+
+    // 4. 图例：与单元格相同的平方根刻度
+    QRect legend(gridRect.left(), gridRect.bottom() + 12, qMin(240, gridRect.width() / 2), 10);
+    QLinearGradient gradient(legend.topLeft(), legend.topRight());
+    for (int i = 0; i <= 4; ++i)
+        gradient.setColorAt(i / 4.0, blend(i / 4.0));
+    painter.fillRect(legend, gradient);
+    painter.setPen(QColor("#666666"));
+    painter.drawText(QRect(legend.left() - 60, legend.top() - 4, 54, 18), Qt::AlignRight | Qt::AlignVCenter, "￥0");
+    painter.drawText(QRect(legend.right() + 6, legend.top() - 4, 160, 18), Qt::AlignLeft | Qt::AlignVCenter,
+                     QString("￥%1").arg(maxValue, 0, 'f', 2));
+}
+
+void HeatmapWidget::mouseMoveEvent(QMouseEvent *event)
+{
+    int cell = cellAt(event->pos());
+    if (cell != hoveredCell) {
+        hoveredCell = cell;
+        update();
+    }
+    QWidget::mouseMoveEvent(event);
+}
+
+void HeatmapWidget::leaveEvent(QEvent *event)
+{
+    if (hoveredCell >= 0) {
+        hoveredCell = -1;
+        update();
+    }
+    QWidget::leaveEvent(event);
+}
+
+bool HeatmapWidget::event(QEvent *event)
+{
+    if (event->type() == QEvent::ToolTip) {
+        QHelpEvent *help = static_cast<QHelpEvent *>(event);
+        int cell = cellAt(help->pos());
+        if (cell < 0) {
+            QToolTip::hideText();
+            event->ignore();
+            return true;
+        }
+        int columns = pivot.columnCount();
+        int r = cell / columns;
+        int c = cell % columns;
+        double value = pivot.cells[cell];
+        double share = pivot.grandTotal > 0 ? value / pivot.grandTotal * 100 : 0;
+        QToolTip::showText(help->globalPos(),
+                           QString("%1 %2\n￥%3（占 %4%）")
+                               .arg(pivot.rowLabels.value(r), pivot.columnLabels.value(c))
+                               .arg(value, 0, 'f', 2)
+                               .arg(share, 0, 'f', 1),
+                           this);
+        return true;
+    }
+    return QWidget::event(event);
+}
@@ -11,8 +11,11 @@
 #include <QPainter>
 #include <QTextCharFormat>
 #include <QDebug>
+#include <QElapsedTimer>
 #include <QSqlQuery>
 #include "../db/database_manager.h"
+#include "../db/db_executor.h"
+#include "budgetdialog.h"
 
 class CalendarDataDelegate : public QStyledItemDelegate {
     MonthViewWidget *m_view;
@@ -109,6 +112,36 @@ public:
             painter->drawText(amtRect, Qt::AlignCenter, QString("￥%1").arg(amount, 0, 'f', 1));
         }
 
+        // 6. 预计扣费圆点
+        if (m_view->hasUpcomingCharge(date) && isCurrentMonth) {
+            painter->setPen(Qt::NoPen);
+            painter->setBrush(isSelected ? QColor(Qt::white) : QColor("#3b6ea5"));
+            painter->drawEllipse(QRect(rect.left() + 8, rect.top() + 8, 7, 7));
+        }
+
+        // 7. 预算角标：当月累计支出在这一天越过额度的分类数
+        int alerts = m_view->getBudgetAlertCount(date);
+        if (alerts > 0 && isCurrentMonth) {
+            QRect badge(rect.right() - 20, rect.top() + 6, 14, 14);
+            painter->setPen(Qt::NoPen);
+            painter->setBrush(QColor("#d9534f"));
+            painter->drawEllipse(badge);
+            painter->setPen(Qt::white);
+            painter->setFont(QFont("DengXian", 8, QFont::Bold));
+            painter->drawText(badge, Qt::AlignCenter, QString::number(alerts));
+        }
+
+        // 8. 异常标记：当天合计或某一笔支出远高于平常
+        if (m_view->getAnomalyCount(date) > 0 && isCurrentMonth) {
+            QRect mark(rect.right() - 20, rect.bottom() - 20, 14, 14);
+            painter->setPen(Qt::NoPen);
+            painter->setBrush(QColor("#e67e22"));
+            painter->drawEllipse(mark);
+            painter->setPen(Qt::white);
+            painter->setFont(QFont("DengXian", 8, QFont::Bold));
+            painter->drawText(mark, Qt::AlignCenter, "!");
+        }
+
         painter->restore();
     }
 };
@@ -165,7 +198,8 @@ void MonthViewWidget::setupUI()
     cardLayout->setSpacing(15);
     cardLayout->addWidget(expenseCard);
     cardLayout->addWidget(incomeCard);
-    cardLayout->addStretch();
+    cardLayout->addWidget(upcomingLabel, 1);
+    cardLayout->addWidget(budgetButton);
 
     // 3. 纯净日历容器
     QFrame *calendarContainer = new QFrame();
@@ -178,10 +212,14 @@ void MonthViewWidget::setupUI()
     setupCalendar();
     calLayout->addWidget(calendarWidget);
 
+    // 4. 滚动日均趋势
+    setupTrendChart();
+
     // 组装右侧
     rightLayout->addLayout(monthSelectorLayout);
     rightLayout->addLayout(cardLayout);
     rightLayout->addWidget(calendarContainer, 1); // Stretch 1 使日历自动拉伸至底部对齐
+    rightLayout->addWidget(trendChartView);
 
     mainLayout->addLayout(leftLayout, 0);
     mainLayout->addLayout(rightLayout, 1);
@@ -236,6 +274,58 @@ void MonthViewWidget::setupPieChart()
     pieChartView->setChart(chart);
 }
 
+void MonthViewWidget::setupTrendChart()
+{
+    trendChartView = new QChartView();
+    trendChartView->setFixedHeight(180);
+    trendChartView->setRenderHint(QPainter::Antialiasing);
+
+    QChart *chart = new QChart();
+    chart->setTitle("滚动日均");
+    chart->setBackgroundBrush(QBrush(QColor("#ffffff")));
+    chart->legend()->setAlignment(Qt::AlignRight);
+    chart->setMargins(QMargins(5, 0, 5, 0));
+
+    trend7Series = new QLineSeries();
+    trend30Series = new QLineSeries();
+    trend90Series = new QLineSeries();
+    trend7Series->setName("近7日");
+    trend30Series->setName("近30日");
+    trend90Series->setName("近90日");
+    trend7Series->setPen(QPen(QColor("#3b6ea5"), 2));
+    trend30Series->setPen(QPen(QColor("#e07b39"), 2));
+    trend90Series->setPen(QPen(QColor("#a0b8d5"), 2, Qt::DashLine));
+
+    trendAxisX = new QValueAxis();
+    trendAxisX->setLabelFormat("%d日");
+    trendAxisX->setTickCount(7);
+    trendAxisY = new QValueAxis();
+    trendAxisY->setLabelFormat("%.0f");
+    chart->addAxis(trendAxisX, Qt::AlignBottom);
+    chart->addAxis(trendAxisY, Qt::AlignLeft);
+
+    for (QLineSeries *series : {trend7Series, trend30Series, trend90Series}) {
+        chart->addSeries(series);
+        series->attachAxis(trendAxisX);
+        series->attachAxis(trendAxisY);
+        connect(series, &QLineSeries::hovered, this, [this, series](const QPointF &point, bool state) {
+            if (state) {
+                QString tooltip = QString(
+                    "<div style='font-family: Microsoft YaHei;'>"
+                    "<b>%1月%2日</b> %3<br/>"
+                    "日均: <span style='color:#3b6ea5;'>￥%4</span>"
+                    "</div>"
+                ).arg(currentMonth).arg(qRound(point.x())).arg(series->name()).arg(point.y(), 0, 'f', 2);
+                QToolTip::showText(QCursor::pos(), tooltip, trendChartView);
+            } else {
+                QToolTip::hideText();
+            }
+        });
+    }
+
+    trendChartView->setChart(chart);
+}
+
 void MonthViewWidget::setupCalendar()
 {
     calendarWidget = new QCalendarWidget();
@@ -295,7 +385,7 @@ void MonthViewWidget::setupTransactionTypeCards()
 {
     auto initCard = [this](QPushButton* &btn, const QString &title) {
         btn = new QPushButton();
-        btn->setFixedSize(160, 60);
+        btn->setFixedSize(180, 76);
         btn->setCheckable(true);
         QVBoxLayout *layout = new QVBoxLayout(btn);
         layout->setContentsMargins(15, 8, 15, 8);
@@ -306,15 +396,35 @@ void MonthViewWidget::setupTransactionTypeCards()
         QLabel *aLabel = new QLabel("￥0.00");
         aLabel->setObjectName("amountLabel");
         aLabel->setStyleSheet("font-size: 18px; font-weight: bold; background-color: transparent;");
+        QLabel *dLabel = new QLabel();
+        dLabel->setObjectName("deltaLabel");
+        dLabel->setStyleSheet("font-size: 11px; color: #666; background-color: transparent;");
 
         layout->addWidget(tLabel);
         layout->addWidget(aLabel);
+        layout->addWidget(dLabel);
         layout->addStretch();
     };
 
     initCard(expenseCard, "支出");
     initCard(incomeCard, "收入");
 
+    upcomingLabel = new QLabel();
+    upcomingLabel->setWordWrap(true);
+    upcomingLabel->setStyleSheet("QLabel { color: #3b6ea5; font-size: 12px; background: transparent; }");
+
+    budgetButton = new QPushButton("预算");
+    budgetButton->setFixedSize(80, 36);
+    budgetButton->setStyleSheet(
+        "QPushButton { background-color: white; border: 1px solid #d0d8e0; border-radius: 6px; color: #3b6ea5; }"
+        "QPushButton:hover { border-color: #3b6ea5; }"
+    );
+    connect(budgetButton, &QPushButton::clicked, this, [this]() {
+        BudgetDialog dialog(this);
+        if (dialog.exec() == QDialog::Accepted)
+            loadMonthData();
+    });
+
     connect(expenseCard, &QPushButton::clicked, this, [this](){ switchTransactionType("支出"); });
     connect(incomeCard, &QPushButton::clicked, this, [this](){ switchTransactionType("收入"); });
 }
@@ -340,6 +450,9 @@ void MonthViewWidget::updateMonthData(const QJsonObject &json)
 {
     if (!json["operation"].toBool()) return;
 
+    if (json.contains("dataFromYear"))
+        updateYearRange(json["dataFromYear"].toInt(), json["dataToYear"].toInt());
+
     // 直接解析协议字段
     double expTotal = json["monthlyExpenseTotal"].toDouble();
     double incTotal = json["monthlyIncomeTotal"].toDouble();
@@ -347,6 +460,25 @@ void MonthViewWidget::updateMonthData(const QJsonObject &json)
     if(auto l = expenseCard->findChild<QLabel*>("amountLabel")) l->setText(QString("￥%1").arg(expTotal, 0, 'f', 2));
     if(auto l = incomeCard->findChild<QLabel*>("amountLabel")) l->setText(QString("￥%1").arg(incTotal, 0, 'f', 2));
 
+    // 环比 / 同比：与上月、去年同月相比
+    QJsonObject compare = json["comparison"].toObject();
+    if (auto l = expenseCard->findChild<QLabel*>("deltaLabel")) {
+        l->setText(QString("环比 %1  同比 %2")
+                       .arg(PeriodComparison::changeText(expTotal, compare["previousExpense"].toDouble()))
+                       .arg(PeriodComparison::changeText(expTotal, compare["lastYearExpense"].toDouble())));
+        l->setToolTip(QString("上月 ￥%1\n去年同月 ￥%2")
+                          .arg(compare["previousExpense"].toDouble(), 0, 'f', 2)
+                          .arg(compare["lastYearExpense"].toDouble(), 0, 'f', 2));
+    }
+    if (auto l = incomeCard->findChild<QLabel*>("deltaLabel")) {
+        l->setText(QString("环比 %1  同比 %2")
+                       .arg(PeriodComparison::changeText(incTotal, compare["previousIncome"].toDouble()))
+                       .arg(PeriodComparison::changeText(incTotal, compare["lastYearIncome"].toDouble())));
+        l->setToolTip(QString("上月 ￥%1\n去年同月 ￥%2")
+                          .arg(compare["previousIncome"].toDouble(), 0, 'f', 2)
+                          .arg(compare["lastYearIncome"].toDouble(), 0, 'f', 2));
+    }
+
 
     m_dayAmounts.clear();
         QJsonArray calArray = json["monthCalendar"].toArray();
@@ -371,10 +503,117 @@ void MonthViewWidget::updateMonthData(const QJsonObject &json)
             .arg(i+1).arg(item["category"].toString())
             .arg(item["ratio"].toDouble()*100, 0, 'f', 1)
             .arg(item["totalAmount"].toDouble(), 0, 'f', 2);
-        rankListWidget->addItem(text);
+        text += "  " + PeriodComparison::changeText(item["totalAmount"].toDouble(), item["previousAmount"].toDouble());
+        QListWidgetItem *rankItem = new QListWidgetItem(text);
+        rankItem->setData(Qt::UserRole, item["category"].toString());
+        rankItem->setToolTip(QString("上月 ￥%1\n去年同月 ￥%2")
+                                 .arg(item["previousAmount"].toDouble(), 0, 'f', 2)
+                                 .arg(item["lastYearAmount"].toDouble(), 0, 'f', 2));
+        rankListWidget->addItem(rankItem);
     }
 
     commentLabel->setText(json["comment"].toString());
+    updateBudgetIndicators(json["budgets"].toArray());
+    updateUpcomingCharges(json["upcoming"].toArray());
+
+    m_anomalyDays.clear();
+    for (const QJsonValue &value : json["anomalies"].toArray()) {
+        QDate day = QDate::fromString(value.toObject()["date"].toString(), "yyyy-MM-dd");
+        m_anomalyDays[day] += 1;
+    }
+    calendarWidget->update();
+
+    // 滚动日均：一次 replace 整条折线
+    QJsonArray rollingArray = json["rolling"].toArray();
+    QVector<QPointF> points7, points30, points90;
+    double maxVal = 0;
+    for (int i = 0; i < rollingArray.size(); ++i) {
+        QJsonObject point = rollingArray[i].toObject();
+        int day = QDate::fromString(point["date"].toString(), "yyyy-MM-dd").day();
+        points7.append(QPointF(day, point["average7"].toDouble()));
+        points30.append(QPointF(day, point["average30"].toDouble()));
+        points90.append(QPointF(day, point["average90"].toDouble()));
+        maxVal = qMax(maxVal, qMax(points7.last().y(), qMax(points30.last().y(), points90.last().y())));
+    }
+    trend7Series->replace(points7);
+    trend30Series->replace(points30);
+    trend90Series->replace(points90);
+    trendAxisX->setRange(1, qMax(1, rollingArray.size()));
+    trendAxisY->setRange(0, maxVal > 0 ? maxVal * 1.2 : 1);
+}
+
+// 预算只针对支出：卡片标题标出超支分类数，排行榜补上预算使用比例，日历记下越线的日期
+void MonthViewWidget::updateBudgetIndicators(const QJsonArray &budgets)
+{
+    m_budgetAlerts.clear();
+    QMap<QString, QJsonObject> byCategory;
+    QStringList overNames;
+    for (const QJsonValue &value : budgets) {
+        QJsonObject budget = value.toObject();
+        byCategory.insert(budget["category"].toString(), budget);
+        if (budget["spent"].toDouble() > budget["limit"].toDouble()) {
+            overNames << QString("%1：￥%2 / ￥%3")
+                             .arg(budget["category"].toString())
+                             .arg(budget["spent"].toDouble(), 0, 'f', 2)
+                             .arg(budget["limit"].toDouble(), 0, 'f', 2);
+            QDate day = QDate::fromString(budget["exceededOn"].toString(), "yyyy-MM-dd");
+            if (day.isValid())
+                m_budgetAlerts[day] += 1;
+        }
+    }
+
+    if (auto l = expenseCard->findChild<QLabel*>("titleLabel")) {
+        if (overNames.isEmpty())
+            l->setText("支出");
+        else
+            l->setText(QString("支出 <span style='color:#d9534f;'>超支 %1 项</span>").arg(overNames.size()));
+    }
+    expenseCard->setToolTip(overNames.isEmpty() ? QString() : "超出预算：\n" + overNames.join("\n"));
+
+    if (currentTransactionType == "支出") {
+        for (int i = 0; i < rankListWidget->count(); ++i) {
+            QListWidgetItem *item = rankListWidget->item(i);
+            QString category = item->data(Qt::UserRole).toString();
+            if (!byCategory.contains(category))
+                continue;
+            QJsonObject budget = byCategory.value(category);
+            double limit = budget["limit"].toDouble();
+            double used = limit > 0 ? budget["spent"].toDouble() / limit : 0;
+            item->setText(item->text() + QString("  预算 %1%").arg(used * 100, 0, 'f', 0));
+            if (used > 1)
+                item->setForeground(QColor("#d9534f"));
+        }
+    }
+    calendarWidget->update();
+}
+
+// 预计扣费：卡片旁汇总本月的笔数和金额，悬停看明细；日历上对应日期加圆点
+void MonthViewWidget::updateUpcomingCharges(const QJsonArray &upcoming)
+{
+    m_upcomingDays.clear();
+    QStringList details;
+    double total = 0;
+    for (const QJsonValue &value : upcoming) {
+        QJsonObject charge = value.toObject();
+        QDate day = QDate::fromString(charge["date"].toString(), "yyyy-MM-dd");
+        QString text = QString("%1 %2 ￥%3（%4）")
+                           .arg(day.toString("MM/dd"))
+                           .arg(charge["name"].toString())
+                           .arg(charge["amount"].toDouble(), 0, 'f', 2)
+                           .arg(charge["cadence"].toString());
+        m_upcomingDays[day] << text;
+        details << text;
+        total += charge["amount"].toDouble();
+    }
+
+    if (details.isEmpty()) {
+        upcomingLabel->clear();
+        upcomingLabel->setToolTip(QString());
+    } else {
+        upcomingLabel->setText(QString("预计扣费 %1 笔，共 ￥%2").arg(details.size()).arg(total, 0, 'f', 2));
+        upcomingLabel->setToolTip(details.join("\n"));
+    }
+    calendarWidget->update();
 }
 
 void MonthViewWidget::setupRankList() {
@@ -458,7 +697,8 @@ void MonthViewWidget::setupMonthSelector() {
         yearComboBox->setStyleSheet(minimalistCombo);
         monthComboBox->setStyleSheet(minimalistCombo);
 
-        for (int y = 2020; y <= 2030; y++) yearComboBox->addItem(QString::number(y));
+        // 年份范围随数据变化，先只放今年，数据加载后由 updateYearRange() 补全
+        updateYearRange(QDate::currentDate().year(), QDate::currentDate().year());
         for (int m = 1; m <= 12; m++) monthComboBox->addItem(QString::number(m));
 
         // “年”和“月”标签样式：无背景，淡灰色
@@ -540,73 +780,197 @@ void MonthViewWidget::loadMonthData(){
             return;
         }
     }
-    QSqlQuery query;
+
+    int year = currentYear;
+    int month = currentMonth;
+    QString transactionType = currentTransactionType;
+
+    // 查询在数据库线程执行，先显示占位；结果回来时如果已经切到别的月份或类型就丢弃
+    int generation = ++loadGeneration;
+    showLoadingState();
+    QElapsedTimer timer;
+    timer.start();
+    DbExecutor::instance().run<QJsonObject>(
+        [year, month, transactionType]() {
+            return fetchMonthData(year, month, transactionType);
+        },
+        this,
+        [this, generation, timer](const QJsonObject &resp) {
+            if (generation != loadGeneration)
+                return;
+            DbExecutor::instance().recordLoadTime("month", timer.elapsed());
+            updateMonthData(resp);
+        });
+}
+
+// 在数据库线程上执行，只使用参数，不访问界面
+QJsonObject MonthViewWidget::fetchMonthData(int year, int month, const QString &transactionType)
+{
+    DbExecutor &executor = DbExecutor::instance();
+    PeriodKey period = PeriodKey::ofMonth(year, month);
+    QDate first(year, month, 1);
+    QString type;
+    if(transactionType == "支出"){
+        type = "expense";
+    }
+    else{
+        type = "income";
+    }
+
+    // 本月、上月与去年同月一次查出，卡片总额、环比 / 同比和日历的逐日金额都取自这里
+    QFuture<PeriodComparison> comparisonFuture = executor.fork<PeriodComparison>([first]() {
+        return DatabaseManager::instance().comparePeriods(first, CompareMonth);
+    });
+    QFuture<QVector<CategoryStat> > statsFuture = executor.fork<QVector<CategoryStat> >([period, type]() {
+        return DatabaseManager::instance().getCategoryStats(period, type);
+    });
+    QFuture<QString> commentFuture = executor.fork<QString>([year, month, type]() {
+        return DatabaseManager::instance().getTopCategoryByMonthWithComment(year, month, type);
+    });
+    // 当月每天结尾的滚动窗口，由内存中的区间合计索引算出
+    QFuture<QVector<RollingPoint> > rollingFuture = executor.fork<QVector<RollingPoint> >([first, type]() {
+        return DatabaseManager::instance().getRollingMetrics(first, first.addDays(first.daysInMonth() - 1), type);
+    });
+
+    // 周期性扣费取最近一次后台检测的结果按周期推算
+    QFuture<QVector<RecurringCharge> > upcomingFuture = executor.fork<QVector<RecurringCharge> >([first]() {
+        return DatabaseManager::instance().getUpcomingCharges(first, first.addDays(first.daysInMonth() - 1));
+    });
+    // 异常基线常驻内存，当月逐笔打分
+    QFuture<QVector<SpendAnomaly> > anomaliesFuture = executor.fork<QVector<SpendAnomaly> >([first]() {
+        return DatabaseManager::instance().getAnomalies(first, first.addDays(first.daysInMonth() - 1));
+    });
+    QFuture<QVector<BudgetStatus> > budgetsFuture = executor.fork<QVector<BudgetStatus> >([year, month]() {
+        return DatabaseManager::instance().evaluateBudgets(year, month);
+    });
 
     QJsonObject resp;
     resp["operation"] = true;
-    query = db.getTotalIncomeByMonth(currentYear,currentMonth);
-    query.next();
-    double income= query.value(0).toDouble();
+    PeriodComparison comparison = comparisonFuture.result();
+    double income = comparison.income[PeriodComparison::Current];
     resp["monthlyIncomeTotal"] = income;
-    query = db.getTotalExpenseByMonth(currentYear,currentMonth);
-    query.next();
-    double expense= query.value(0).toDouble();
+    double expense = comparison.expense[PeriodComparison::Current];
     resp["monthlyExpenseTotal"] = expense;
 
+    QJsonObject compareObj;
+    compareObj["previousExpense"] = comparison.expense[PeriodComparison::Previous];
+    compareObj["previousIncome"] = comparison.income[PeriodComparison::Previous];
+    compareObj["lastYearExpense"] = comparison.expense[PeriodComparison::LastYear];
+    compareObj["lastYearIncome"] = comparison.income[PeriodComparison::LastYear];
+    resp["comparison"] = compareObj;
+
+    // 分类的上月 / 去年同月金额按名称并入饼图数据
+    QHash<QString, const PeriodComparison::Category *> previousByName;
+    for (const PeriodComparison::Category &category : comparison.categories) {
+        if (category.income == (type == "income"))
+            previousByName.insert(category.name, &category);
+    }
+
     QJsonObject c1;
     QJsonArray pie;
-    if (currentTransactionType == "支出") {
-        query = db.getExpenseCategoryStatsByMonth(currentYear,currentMonth);
-        while(query.next()){
-            c1["category"] = query.value(0).toString();
-            c1["totalAmount"] = query.value(2).toDouble();
-            c1["ratio"] = query.value(2).toDouble()/expense;
-            c1["count"] = query.value(1).toInt();
-            pie.append(c1);
-        }
-    } else {
-        query = db.getIncomeCategoryStatsByMonth(currentYear,currentMonth);
-        while(query.next()){
-            c1["category"] = query.value(0).toString();
-            c1["totalAmount"] = query.value(2).toDouble();
-            c1["ratio"] = query.value(2).toDouble()/income;
-            c1["count"] = query.value(1).toInt();
-            pie.append(c1);
-        }
+    double total = (type == "expense") ? expense : income;
+    for (const CategoryStat &stat : statsFuture.result()) {
+        c1["category"] = stat.name;
+        c1["totalAmount"] = stat.total;
+        c1["ratio"] = stat.total/total;
+        c1["count"] = stat.count;
+        const PeriodComparison::Category *category = previousByName.value(stat.name, nullptr);
+        c1["previousAmount"] = category ? category->amount[PeriodComparison::Previous] : 0.0;
+        c1["lastYearAmount"] = category ? category->amount[PeriodComparison::LastYear] : 0.0;
+        pie.append(c1);
     }
     resp["pie"] = pie;
+    resp["comment"] = commentFuture.result();
 
-    QString type;
-    if(currentTransactionType == "支出"){
-        type = "expense";
-    }
-    else{
-        type = "income";
-    }
-    QString comment=db.getTopCategoryByMonthWithComment(currentYear,currentMonth,type);
-    resp["comment"] = comment;
-
+    // 日历取对比结果中本月的逐日序列，不再单独查询
     QJsonArray calArray;
-    QDate first(currentYear, currentMonth, 1);
-    int days = first.daysInMonth();
-    for (int d = 1; d <= days; ++d) {
-        QDate day(currentYear, currentMonth, d);
+    for (const DayTotal &day : comparison.daily[PeriodComparison::Current]) {
         QJsonObject obj;
-        obj["date"] = day.toString("yyyy-MM-dd");
-        query=db.getTotalRecordsByDay(day.toString("yyyy-MM-dd"));
-        query.next();
-        if (currentTransactionType == "支出") {
-            obj["dailyAmount"] = query.value(0).toDouble(); // 示例：替换为真实数据
+        obj["date"] = day.date.toString("yyyy-MM-dd");
+        if (type == "expense") {
+            obj["dailyAmount"] = day.expense;
         } else {
-            obj["dailyAmount"] = query.value(1).toDouble();
+            obj["dailyAmount"] = day.income;
         }
         calArray.append(obj);
     }
     resp["monthCalendar"] = calArray;
-    updateMonthData(resp);
 
+    QJsonArray rollingArray;
+    for (const RollingPoint &point : rollingFuture.result()) {
+        QJsonObject obj;
+        obj["date"] = point.date.toString("yyyy-MM-dd");
+        obj["average7"] = point.average7;
+        obj["average30"] = point.average30;
+        obj["average90"] = point.average90;
+        rollingArray.append(obj);
+    }
+    resp["rolling"] = rollingArray;
+
+    QJsonArray upcomingArray;
+    for (const RecurringCharge &charge : upcomingFuture.result()) {
+        QJsonObject obj;
+        obj["date"] = charge.nextDate.toString("yyyy-MM-dd");
+        obj["name"] = charge.name;
+        obj["amount"] = charge.amount;
+        obj["cadence"] = charge.cadence;
+        upcomingArray.append(obj);
+    }
+    resp["upcoming"] = upcomingArray;
+
+    // 预算执行情况来自内存计数器，只与设了预算的分类数有关
+    QJsonArray budgetArray;
+    for (const BudgetStatus &status : budgetsFuture.result()) {
+        QJsonObject obj;
+        obj["category"] = status.name;
+        obj["limit"] = status.limit;
+        obj["spent"] = status.spent;
+        obj["exceededOn"] = status.exceededOn.isValid() ? status.exceededOn.toString("yyyy-MM-dd") : QString();
+        budgetArray.append(obj);
+    }
+    resp["budgets"] = budgetArray;
+
+    QJsonArray anomalyArray;
+    for (const SpendAnomaly &anomaly : anomaliesFuture.result()) {
+        QJsonObject obj;
+        obj["date"] = anomaly.date.toString("yyyy-MM-dd");
+        obj["id"] = anomaly.recordId;
+        obj["amount"] = anomaly.amount;
+        obj["reason"] = anomaly.reason;
+        anomalyArray.append(obj);
+    }
+    resp["anomalies"] = anomalyArray;
+
+    DateRange span = DatabaseManager::instance().getDataDateRange();
+    resp["dataFromYear"] = span.from.isValid() ? span.from.year() : year;
+    resp["dataToYear"] = span.to.isValid() ? span.to.year() : year;
+    return resp;
+}
+
+// 年份下拉框覆盖数据的首末年份和今年，不再写死范围
+void MonthViewWidget::updateYearRange(int fromYear, int toYear)
+{
+    int thisYear = QDate::currentDate().year();
+    fromYear = qMin(qMin(fromYear, thisYear), currentYear);
+    toYear = qMax(qMax(toYear, thisYear), currentYear);
+    if (yearComboBox->count() == toYear - fromYear + 1
+            && yearComboBox->itemText(0).toInt() == fromYear)
+        return;
+
+    QSignalBlocker blocker(yearComboBox);
+    QString selected = yearComboBox->currentText();
+    yearComboBox->clear();
+    for (int y = fromYear; y <= toYear; y++) yearComboBox->addItem(QString::number(y));
+    yearComboBox->setCurrentText(selected.isEmpty() ? QString::number(thisYear) : selected);
 }
 
+// 查询进行中的占位：金额和评价先显示加载中，饼图和日历保留上一次的内容直到新数据到达
+void MonthViewWidget::showLoadingState()
+{
+    if(auto l = expenseCard->findChild<QLabel*>("amountLabel")) l->setText("…");
+    if(auto l = incomeCard->findChild<QLabel*>("amountLabel")) l->setText("…");
+    commentLabel->setText("加载中…");
+}
 
 void MonthViewWidget::refreshData()
 {
@@ -11,7 +11,11 @@
 #include <QtCharts/QChartView>
 #include <QtCharts/QPieSeries>
 #include <QtCharts/QPieSlice>
+#include <QtCharts/QLineSeries>
+#include <QtCharts/QValueAxis>
 #include <QPainter>
+#include <QJsonObject>
+#include <QJsonArray>
 
 QT_CHARTS_USE_NAMESPACE
 
@@ -28,6 +32,9 @@ QT_CHARTS_USE_NAMESPACE
  *   3. 评论卡片：显示对应分类的评价文本
  *   4. 日历：显示当月每日金额，无记录日期变灰但可点击
  *   5. 收支卡片：显示本月总收入/总支出
+ *   6. 趋势图：当月每天的近 7 / 30 / 90 日滚动日均
+ *   7. 分类预算：支出卡片标出超支分类数，排行榜显示预算使用比例，日历在超支当天加红色角标
+ *   8. 预计扣费：按周期推算的订阅、房租等扣费列在收支卡片旁，日历在对应日期加蓝色圆点
  *
  * 数据接口：
  * - 槽函数 onQueryMonthData()：接收后端返回的月度数据
@@ -56,16 +63,26 @@ QT_CHARTS_USE_NAMESPACE
  *   ],
  *   "monthlyIncomeTotal": 8000.00,
  *   "monthlyExpenseTotal": 6200.00,
+ *   "comparison": { "previousExpense": 5800.00, "previousIncome": 8000.00,       // 上月
+ *                   "lastYearExpense": 6000.00, "lastYearIncome": 7500.00 },     // 去年同月
  *   "pie": [
  *     {
  *       "category": "餐饮美食",
  *       "totalAmount": 8000.00,
  *       "ratio": 1.00,
- *       "count": 4
+ *       "count": 4,
+ *       "previousAmount": 7200.00,   // 上月
+ *       "lastYearAmount": 6900.00    // 去年同月
  *     }
  *     // ... 分类数据
  *   ],
- *   "comment": "实用才是第一原则！"
+ *   "comment": "实用才是第一原则！",
+ *   "rolling": [ { "date": "2024-01-01", "average7": 95.0, "average30": 88.0, "average90": 90.0 } ],  // 每天结尾的滚动日均
+ *   "dataFromYear": 2019,   // 数据的首末年份，用于年份下拉框
+ *   "dataToYear": 2024,
+ *   "budgets": [ { "category": "餐饮美食", "limit": 1500.00, "spent": 1620.00, "exceededOn": "2024-01-27" } ],  // 仅设了预算的支出分类，exceededOn 未超支时为空
+ *   "upcoming": [ { "date": "2024-01-17", "name": "某视频会员", "amount": 25.00, "cadence": "每月" } ],  // 当月预计的周期性扣费
+ *   "anomalies": [ { "date": "2024-01-20", "id": 1001, "amount": 680.00, "reason": "..." } ]  // 支出异常，id 为 0 表示整天
  * }
  */
 
@@ -98,6 +115,22 @@ public:
      */
     double getDayAmount(const QDate &date) const;
 
+    /**
+     * @brief 某天超出预算的分类数
+     * @return 当月累计支出在这一天越过额度的分类个数，用于日历角标
+     */
+    int getBudgetAlertCount(const QDate &date) const { return m_budgetAlerts.value(date, 0); }
+
+    /**
+     * @brief 某天是否有预计的周期性扣费，用于日历圆点
+     */
+    bool hasUpcomingCharge(const QDate &date) const { return m_upcomingDays.contains(date); }
+
+    /**
+     * @brief 某天被标记的支出异常数（单笔异常与整天异常合计），用于日历角标
+     */
+    int getAnomalyCount(const QDate &date) const { return m_anomalyDays.value(date, 0); }
+
     /**
      * @brief 获取日历组件当前显示的月份
      * @return 月份（1-12）
@@ -151,9 +184,16 @@ private:
     void setupRankList();
     void setupCommentCard();
     void setupMonthSelector();
+    void updateYearRange(int fromYear, int toYear);
     void setupTransactionTypeCards();
     void setupCalendar();
+    void updateBudgetIndicators(const QJsonArray &budgets);
+    void updateUpcomingCharges(const QJsonArray &upcoming);
+    void setupTrendChart();
     void loadMonthData();
+    // 在数据库线程上查询某月数据并组装成 API 响应格式，不访问界面组件
+    static QJsonObject fetchMonthData(int year, int month, const QString &transactionType);
+    void showLoadingState();  // 查询进行中时显示占位
     QFrame* createCalendarContainer();
 
     // 数据处理
@@ -182,8 +222,12 @@ private:
     int currentYear;
     int currentMonth;
     QString currentTransactionType;
+    int loadGeneration = 0;  // 每次发起查询加一，用于丢弃过期的结果
     QMap<QPieSlice*, QJsonObject> sliceDataMap;
     QMap<QDate, double> m_dayAmounts; // 存储日期 -> 金额的映射
+    QMap<QDate, int> m_budgetAlerts;  // 日期 -> 当天越过额度的分类数
+    QMap<QDate, QStringList> m_upcomingDays; // 日期 -> 当天预计扣费的描述
+    QMap<QDate, int> m_anomalyDays;   // 日期 -> 当天的支出异常数
 
     // UI 组件
     QPieSeries *pieSeries;
@@ -193,7 +237,15 @@ private:
 
     QPushButton *expenseCard;
     QPushButton *incomeCard;
+    QPushButton *budgetButton;
+    QLabel *upcomingLabel;
     QCalendarWidget *calendarWidget;
+    QChartView *trendChartView;
+    QLineSeries *trend7Series;
+    QLineSeries *trend30Series;
+    QLineSeries *trend90Series;
+    QValueAxis *trendAxisX;
+    QValueAxis *trendAxisY;
 
     QComboBox *yearComboBox;
     QComboBox *monthComboBox;
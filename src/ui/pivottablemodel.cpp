@@ -0,0 +1,88 @@
+#include "pivottablemodel.h"
+#include <QColor>
+#include <QFont>
+
+PivotTableModel::PivotTableModel(QObject *parent)
+    : QAbstractTableModel(parent)
+{
+}
+
+void PivotTableModel::setTable(const PivotTable &table)
+{
+    beginResetModel();
+    pivot = table;
+    endResetModel();
+}
+
+const PivotTable &PivotTableModel::table() const
+{
+    return pivot;
+}
+
+// 没有数据时不显示合计行列
+int PivotTableModel::rowCount(const QModelIndex &parent) const
+{
+    if (parent.isValid() || pivot.rowCount() == 0)
+        return 0;
+    return pivot.rowCount() + 1;
+}
+
+int PivotTableModel::columnCount(const QModelIndex &parent) const
+{
+    if (parent.isValid() || pivot.columnCount() == 0)
+        return 0;
+    return pivot.columnCount() + 1;
+}
+
+// 越过矩阵边界的一行/一列是合计
+double PivotTableModel::cellValue(int row, int column) const
+{
+    bool totalRow = row == pivot.rowCount();
+    bool totalColumn = column == pivot.columnCount();
+    if (totalRow && totalColumn)
+        return pivot.grandTotal;
+    if (totalRow)
+        return pivot.columnTotals[column];
+    if (totalColumn)
+        return pivot.rowTotals[row];
+    return pivot.value(row, column);
+}
+
+QVariant PivotTableModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid())
+        return QVariant();
+
+    bool isTotal = index.row() == pivot.rowCount() || index.column() == pivot.columnCount();
+    switch (role) {
+    case Qt::DisplayRole: {
+        double value = cellValue(index.row(), index.column());
+        return value == 0 ? QString() : QString::number(value, 'f', 2);
+    }
+    case Qt::UserRole:
+        return cellValue(index.row(), index.column());
+    case Qt::TextAlignmentRole:
+        return int(Qt::AlignRight | Qt::AlignVCenter);
+    case Qt::FontRole:
+        if (isTotal) {
+            QFont font;
+            font.setBold(true);
+            return font;
+        }
+        return QVariant();
+    case Qt::BackgroundRole:
+        return isTotal ? QVariant(QColor("#eef3f9")) : QVariant();
+    default:
+        return QVariant();
+    }
+}
+
+QVariant PivotTableModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    if (role != Qt::DisplayRole)
+        return QVariant();
+
+    if (orientation == Qt::Horizontal)
+        return section < pivot.columnLabels.size() ? pivot.columnLabels[section] : QString("合计");
+    return section < pivot.rowLabels.size() ? pivot.rowLabels[section] : QString("合计");
+}
@@ -0,0 +1,39 @@
+#ifndef PIVOTTABLEMODEL_H
+#define PIVOTTABLEMODEL_H
+
+#include <QAbstractTableModel>
+#include "../db/pivot_table.h"
+
+/**
+ * @brief 透视表的表格模型
+ *
+ * 直接读取 PivotTable 的稠密矩阵，不另外保存一份单元格数据；
+ * PivotTable 内部是隐式共享的容器，setTable() 只增加引用计数。
+ * 最后一列为行合计，最后一行为列合计。
+ *
+ * 角色：
+ * - Qt::DisplayRole：保留两位小数的金额，0 显示为空
+ * - Qt::UserRole：原始金额（double），供排序使用
+ */
+class PivotTableModel : public QAbstractTableModel
+{
+    Q_OBJECT
+
+public:
+    explicit PivotTableModel(QObject *parent = nullptr);
+
+    void setTable(const PivotTable &table);
+    const PivotTable &table() const;
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+
+private:
+    double cellValue(int row, int column) const;
+
+    PivotTable pivot;
+};
+
+#endif // PIVOTTABLEMODEL_H
@@ -0,0 +1,204 @@
+#include "pivotviewwidget.h"
+#include "pivottablemodel.h"
+#include "heatmapwidget.h"
+#include <QVBoxLayout>
+#include <QHBoxLayout>
+#include <QHeaderView>
+#include <QDate>
+#include <QElapsedTimer>
+#include "../db/database_manager.h"
+#include "../db/db_executor.h"
+
+PivotViewWidget::PivotViewWidget(QWidget *parent)
+    : QWidget(parent)
+{
+    setupUI();
+    loadPivotData();
+}
+
+void PivotViewWidget::setupUI()
+{
+    setStyleSheet("QWidget { background-color: #f5f8fb; }");
+    this->setFont(QFont("DengXian", 12));
+
+    QVBoxLayout *mainLayout = new QVBoxLayout(this);
+    mainLayout->setSpacing(10);
+    mainLayout->setContentsMargins(20, 6, 20, 10);
+
+    setupSelector();
+    mainLayout->addWidget(selectorWidget);
+
+    model = new PivotTableModel(this);
+    tableView = new QTableView();
+    tableView->setModel(model);
+    tableView->setSelectionMode(QAbstractItemView::ContiguousSelection);
+    tableView->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    tableView->horizontalHeader()->setSectionResizeMode(QHeaderView::ResizeToContents);
+    tableView->verticalHeader()->setSectionResizeMode(QHeaderView::ResizeToContents);
+    tableView->setStyleSheet(
+        "QTableView { "
+        "background-color: white; "
+        "border: 1px solid #d0d8e0; "
+        "border-radius: 5px; "
+        "gridline-color: #e0e8f0; "
+        "}"
+        "QHeaderView::section { "
+        "background-color: #f0f4f8; "
+        "color: #3b6ea5; "
+        "border: none; "
+        "border-bottom: 1px solid #d0d8e0; "
+        "padding: 4px 8px; "
+        "}"
+    );
+
+    // 表格与热力图读同一份透视结果，切换显示不重新查询
+    heatmapWidget = new HeatmapWidget();
+    contentStack = new QStackedWidget();
+    contentStack->addWidget(tableView);
+    contentStack->addWidget(heatmapWidget);
+    mainLayout->addWidget(contentStack, 1);
+
+    summaryLabel = new QLabel();
+    summaryLabel->setStyleSheet("QLabel { background: transparent; color: #666; }");
+    mainLayout->addWidget(summaryLabel);
+}
+
+void PivotViewWidget::setupSelector()
+{
+    selectorWidget = new QWidget();
+    selectorWidget->setStyleSheet("QWidget { background-color: transparent; }");
+    QHBoxLayout *layout = new QHBoxLayout(selectorWidget);
+    layout->setContentsMargins(0, 5, 0, 5);
+    layout->setSpacing(8);
+    selectorWidget->setFixedHeight(45);
+
+    QString editStyle =
+        "QDateEdit, QComboBox { "
+        "   border: 1px solid #d0d8e0; "
+        "   border-radius: 4px; "
+        "   background: white; "
+        "   padding: 4px 8px; "
+        "   color: #3b6ea5; "
+        "}"
+        "QDateEdit:hover, QComboBox:hover { border-color: #3b6ea5; }";
+    QString labelStyle = "QLabel { background: transparent; color: #666; }";
+
+    // 下拉框的 data 存 PivotDimension
+    const QStringList dimensionNames = { "分类", "月份", "周", "星期几", "交易方式", "交易对方", "年份", "小时" };
+    rowComboBox = new QComboBox();
+    columnComboBox = new QComboBox();
+    for (int d = 0; d < PivotDimensionCount; ++d) {
+        rowComboBox->addItem(dimensionNames[d], d);
+        columnComboBox->addItem(dimensionNames[d], d);
+    }
+    rowComboBox->setCurrentIndex(PivotCategory);
+    columnComboBox->setCurrentIndex(PivotMonth);
+
+    typeComboBox = new QComboBox();
+    typeComboBox->addItem("支出", "expense");
+    typeComboBox->addItem("收入", "income");
+
+    QDate today = QDate::currentDate();
+    fromDateEdit = new QDateEdit(QDate(today.year(), 1, 1));
+    toDateEdit = new QDateEdit(QDate(today.year(), 12, 31));
+    for (QDateEdit *edit : {fromDateEdit, toDateEdit}) {
+        edit->setCalendarPopup(true);
+        edit->setDisplayFormat("yyyy-MM-dd");
+    }
+
+    QPushButton *queryButton = new QPushButton("查询");
+    queryButton->setFixedHeight(32);
+
+    heatmapButton = new QPushButton("热力图");
+    heatmapButton->setCheckable(true);
+    heatmapButton->setFixedHeight(32);
+
+    QLabel *rowLabel = new QLabel("行");
+    QLabel *columnLabel = new QLabel("列");
+    QLabel *toLabel = new QLabel("至");
+    for (QLabel *label : {rowLabel, columnLabel, toLabel})
+        label->setStyleSheet(labelStyle);
+    for (QWidget *edit : std::initializer_list<QWidget*>{rowComboBox, columnComboBox, typeComboBox, fromDateEdit, toDateEdit})
+        edit->setStyleSheet(editStyle);
+
+    layout->addWidget(rowLabel);
+    layout->addWidget(rowComboBox);
+    layout->addWidget(columnLabel);
+    layout->addWidget(columnComboBox);
+    layout->addSpacing(10);
+    layout->addWidget(typeComboBox);
+    layout->addSpacing(10);
+    layout->addWidget(fromDateEdit);
+    layout->addWidget(toLabel);
+    layout->addWidget(toDateEdit);
+    layout->addWidget(queryButton);
+    layout->addSpacing(10);
+    layout->addWidget(heatmapButton);
+    layout->addStretch();
+
+    connect(queryButton, &QPushButton::clicked, this, &PivotViewWidget::loadPivotData);
+    connect(heatmapButton, &QPushButton::toggled, this, &PivotViewWidget::onHeatmapToggled);
+    for (QComboBox *combo : {rowComboBox, columnComboBox, typeComboBox})
+        connect(combo, QOverload<int>::of(&QComboBox::activated), this, &PivotViewWidget::loadPivotData);
+}
+
+void PivotViewWidget::loadPivotData()
+{
+    //载入数据库
+    DatabaseManager &db = DatabaseManager::instance();
+    if(!db.isReady()){
+        if(!db.openDatabase()){
+            return;
+        }
+    }
+
+    RangeFilter filter;
+    filter.from = fromDateEdit->date();
+    filter.to = toDateEdit->date();
+    if (filter.to < filter.from)
+        qSwap(filter.from, filter.to);
+    PivotDimension rows = static_cast<PivotDimension>(rowComboBox->currentData().toInt());
+    PivotDimension columns = static_cast<PivotDimension>(columnComboBox->currentData().toInt());
+    QString type = typeComboBox->currentData().toString();
+
+    int generation = ++loadGeneration;
+    summaryLabel->setText("加载中…");
+    QElapsedTimer timer;
+    timer.start();
+    DbExecutor::instance().run<PivotTable>(
+        [filter, rows, columns, type]() {
+            return DatabaseManager::instance().pivot(filter, rows, columns, type);
+        },
+        this,
+        [this, generation, timer](const PivotTable &table) {
+            if (generation != loadGeneration)
+                return;
+            DbExecutor::instance().recordLoadTime("pivot", timer.elapsed());
+            model->setTable(table);
+            heatmapWidget->setTable(table);
+            summaryLabel->setText(QString("%1 行 × %2 列，合计 ￥%3")
+                .arg(table.rowCount()).arg(table.columnCount())
+                .arg(table.grandTotal, 0, 'f', 2));
+        });
+}
+
+// 热力图默认看 星期几 × 小时：行列都不是小时的话先换过去再查询，之后仍可任选维度
+void PivotViewWidget::onHeatmapToggled(bool checked)
+{
+    contentStack->setCurrentWidget(checked ? static_cast<QWidget *>(heatmapWidget) : tableView);
+    if (!checked)
+        return;
+
+    int rows = rowComboBox->currentData().toInt();
+    int columns = columnComboBox->currentData().toInt();
+    if (rows != PivotHour && columns != PivotHour) {
+        rowComboBox->setCurrentIndex(rowComboBox->findData(static_cast<int>(PivotWeekday)));
+        columnComboBox->setCurrentIndex(columnComboBox->findData(static_cast<int>(PivotHour)));
+        loadPivotData();
+    }
+}
+
+void PivotViewWidget::refreshData()
+{
+    loadPivotData();
+}
@@ -0,0 +1,64 @@
+#ifndef PIVOTVIEWWIDGET_H
+#define PIVOTVIEWWIDGET_H
+
+#include <QWidget>
+#include <QComboBox>
+#include <QPushButton>
+#include <QLabel>
+#include <QDateEdit>
+#include <QTableView>
+#include <QStackedWidget>
+
+class PivotTableModel;
+class HeatmapWidget;
+
+/**
+ * @brief 透视表视图组件
+ *
+ * 功能说明：
+ * - 区间内的支出或收入按任意两个维度交叉汇总（分类、月份、周、星期几、交易方式、交易对方、年份、小时）
+ * - 默认显示今年的 分类 × 月份，用于做预算
+ * - "热力图"按钮把结果画成热力图，默认换成 星期几 × 小时，看一周里各时段的花销
+ * - 数据由 DatabaseManager::pivot() 一次分组查询得到，表格模型直接读取结果矩阵
+ */
+class PivotViewWidget : public QWidget
+{
+    Q_OBJECT
+
+public:
+    explicit PivotViewWidget(QWidget *parent = nullptr);
+
+public slots:
+    void refreshData();
+
+private:
+    void setupUI();
+    void setupSelector();
+
+    /**
+     * @brief 加载透视数据
+     *
+     * 查询在数据库线程执行，结果到达后整体替换模型中的矩阵
+     */
+    void loadPivotData();
+
+    // 在表格和热力图之间切换
+    void onHeatmapToggled(bool checked);
+
+    QWidget *selectorWidget;
+    QComboBox *rowComboBox;
+    QComboBox *columnComboBox;
+    QComboBox *typeComboBox;
+    QDateEdit *fromDateEdit;
+    QDateEdit *toDateEdit;
+    QPushButton *heatmapButton;
+    QStackedWidget *contentStack;
+    QTableView *tableView;
+    PivotTableModel *model;
+    HeatmapWidget *heatmapWidget;
+    QLabel *summaryLabel;
+
+    int loadGeneration = 0;  // 每次发起查询加一，用于丢弃过期的结果
+};
+
+#endif // PIVOTVIEWWIDGET_H
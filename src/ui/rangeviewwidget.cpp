@@ -0,0 +1,761 @@
+#include "rangeviewwidget.h"
+#include <QVBoxLayout>
+#include <QHBoxLayout>
+#include <QJsonObject>
+#include <QJsonArray>
+#include <QDate>
+#include <QDateTime>
+#include <QToolTip>
+#include <QCursor>
+#include <QBrush>
+#include <QPen>
+#include <QDebug>
+#include <QElapsedTimer>
+#include "../db/database_manager.h"
+#include "../db/db_executor.h"
+
+RangeViewWidget::RangeViewWidget(QWidget *parent)
+    : QWidget(parent)
+    , currentTransactionType("支出")
+{
+    setupUI();
+}
+
+void RangeViewWidget::setupUI()
+{
+    setStyleSheet("QWidget { background-color: #f5f8fb; }");
+    this->setFont(QFont("DengXian", 12));
+
+    QHBoxLayout *mainLayout = new QHBoxLayout(this);
+    mainLayout->setSpacing(20);
+    mainLayout->setContentsMargins(20, 6, 20, 0);
+
+    // 左侧：饼图、排行榜、区间概况
+    QVBoxLayout *leftLayout = new QVBoxLayout();
+    leftLayout->setSpacing(15);
+    leftLayout->setContentsMargins(0, 0, 0, 0);
+
+    setupPieChart();
+    leftLayout->addWidget(pieChartView);
+
+    setupRankList();
+    leftLayout->addWidget(rankListWidget);
+
+    setupSummaryCard();
+    leftLayout->addWidget(summaryLabel);
+    leftLayout->addStretch(1);
+    mainLayout->addLayout(leftLayout, 0);
+
+    // 右侧：区间与筛选、收支卡片、折线图、交易对方排行
+    QVBoxLayout *rightLayout = new QVBoxLayout();
+    rightLayout->setSpacing(10);
+    rightLayout->setContentsMargins(0, 0, 0, 0);
+
+    setupRangeSelector();
+    rightLayout->addWidget(rangeSelectorWidget);
+
+    setupTransactionTypeCards();
+    QHBoxLayout *cardLayout = new QHBoxLayout();
+    cardLayout->setSpacing(10);
+    cardLayout->setContentsMargins(0, 5, 0, 5);
+    cardLayout->addWidget(expenseCard);
+    cardLayout->addWidget(incomeCard);
+    cardLayout->addStretch();
+    rightLayout->addLayout(cardLayout);
+
+    setupLineChart();
+    rightLayout->addWidget(lineChartView);
+
+    setupMerchantPanel();
+    QHBoxLayout *merchantLayout = new QHBoxLayout();
+    merchantLayout->setSpacing(10);
+    merchantLayout->setContentsMargins(0, 0, 0, 0);
+    merchantLayout->addWidget(merchantListWidget);
+    merchantLayout->addWidget(merchantTrendView, 1);
+    rightLayout->addLayout(merchantLayout, 1);
+
+    mainLayout->addLayout(rightLayout, 1);
+    switchTransactionType("支出");
+}
+
+void RangeViewWidget::setupPieChart()
+{
+    pieChartView = new QChartView();
+    pieChartView->setMinimumSize(300, 300);
+    pieChartView->setMaximumSize(300, 300);
+    pieChartView->setRenderHint(QPainter::Antialiasing);
+
+    pieSeries = new QPieSeries();
+    pieSeries->setHoleSize(0.35);
+
+    connect(pieSeries, &QPieSeries::hovered, this, [this](QPieSlice *slice, bool state) {
+        if (!slice) return;
+        if (state) {
+            slice->setExploded(true);
+            slice->setExplodeDistanceFactor(0.05);
+            slice->setPen(QPen(QColor("#3b6ea5"), 2));
+            if (sliceDataMap.contains(slice)) {
+                QJsonObject data = sliceDataMap[slice];
+                QString tooltip = QString(
+                    "<div style='font-family: Microsoft YaHei;'>"
+                    "<b>类别:</b> %1<br/>"
+                    "<b>占比:</b> <span style='color:#3b6ea5;'>%2%</span><br/>"
+                    "<b>金额:</b> ￥%3<br/>"
+                    "<b>笔数:</b> %4"
+                    "</div>"
+                ).arg(data["category"].toString())
+                 .arg(data["ratio"].toDouble() * 100, 0, 'f', 1)
+                 .arg(data["totalAmount"].toDouble(), 0, 'f', 2)
+                 .arg(data["count"].toInt());
+                QToolTip::showText(QCursor::pos(), tooltip, pieChartView);
+            }
+        } else {
+            slice->setExploded(false);
+            slice->setPen(QPen(Qt::NoPen));
+            QToolTip::hideText();
+        }
+    });
+
+    QChart *chart = new QChart();
+    chart->addSeries(pieSeries);
+    chart->setTitle("分类占比");
+    chart->setAnimationOptions(QChart::AllAnimations);
+    chart->legend()->setVisible(false);
+    chart->setBackgroundBrush(QBrush(QColor("#ffffff")));
+    pieChartView->setChart(chart);
+}
+
+void RangeViewWidget::setupRankList()
+{
+    rankListWidget = new QListWidget();
+    rankListWidget->setFixedHeight(200);
+    rankListWidget->setSelectionMode(QAbstractItemView::NoSelection);
+    rankListWidget->setStyleSheet(
+        "QListWidget { "
+        "background-color: white; "
+        "border: 1px solid #d0d8e0; "
+        "border-radius: 5px; "
+        "}"
+        "QListWidget::item { "
+        "padding: 8px; "
+        "border-bottom: 1px solid #e0e8f0; "
+        "background-color: transparent; "
+        "}"
+        "QListWidget::item:hover { background-color: transparent; }"
+    );
+}
+
+void RangeViewWidget::setupSummaryCard()
+{
+    summaryLabel = new QLabel();
+    summaryLabel->setFixedHeight(80);
+    summaryLabel->setFixedWidth(300);
+    summaryLabel->setStyleSheet(
+        "QLabel { "
+        "background-color: white; "
+        "border: 2px dashed #3b6ea5; "
+        "border-radius: 10px; "
+        "padding: 10px; "
+        "font-size: 13px; "
+        "color: #333; "
+        "}"
+    );
+    summaryLabel->setWordWrap(true);
+    summaryLabel->setAlignment(Qt::AlignCenter);
+}
+
+void RangeViewWidget::setupRangeSelector()
+{
+    rangeSelectorWidget = new QWidget();
+    rangeSelectorWidget->setStyleSheet("QWidget { background-color: transparent; }");
+    QHBoxLayout *layout = new QHBoxLayout(rangeSelectorWidget);
+    layout->setContentsMargins(0, 5, 0, 5);
+    layout->setSpacing(8);
+    rangeSelectorWidget->setFixedHeight(45);
+
+    QString editStyle =
+        "QDateEdit, QComboBox { "
+        "   border: 1px solid #d0d8e0; "
+        "   border-radius: 4px; "
+        "   background: white; "
+        "   padding: 4px 8px; "
+        "   color: #3b6ea5; "
+        "}"
+        "QDateEdit:hover, QComboBox:hover { border-color: #3b6ea5; }";
+
+    // 默认今年年初到今天
+    QDate today = QDate::currentDate();
+    fromDateEdit = new QDateEdit(QDate(today.year(), 1, 1));
+    toDateEdit = new QDateEdit(today);
+    for (QDateEdit *edit : {fromDateEdit, toDateEdit}) {
+        edit->setCalendarPopup(true);
+        edit->setDisplayFormat("yyyy-MM-dd");
+        edit->setStyleSheet(editStyle);
+    }
+
+    categoryComboBox = new QComboBox();
+    categoryComboBox->setStyleSheet(editStyle);
+    categoryComboBox->setMinimumWidth(110);
+
+    // 交易方式 id 与 transaction_method 表一致，0 表示不限
+    methodComboBox = new QComboBox();
+    methodComboBox->setStyleSheet(editStyle);
+    methodComboBox->addItem("全部方式", 0);
+    methodComboBox->addItem("现金", 1);
+    methodComboBox->addItem("支付宝", 2);
+    methodComboBox->addItem("微信", 3);
+
+    QPushButton *queryButton = new QPushButton("查询");
+    queryButton->setFixedHeight(32);
+
+    QLabel *toLabel = new QLabel("至");
+    toLabel->setStyleSheet("QLabel { background: transparent; color: #666; }");
+
+    layout->addWidget(fromDateEdit);
+    layout->addWidget(toLabel);
+    layout->addWidget(toDateEdit);
+    layout->addSpacing(10);
+    layout->addWidget(categoryComboBox);
+    layout->addWidget(methodComboBox);
+    layout->addWidget(queryButton);
+    layout->addStretch();
+
+    connect(queryButton, &QPushButton::clicked, this, &RangeViewWidget::loadRangeData);
+    connect(categoryComboBox, QOverload<int>::of(&QComboBox::activated), this, &RangeViewWidget::loadRangeData);
+    connect(methodComboBox, QOverload<int>::of(&QComboBox::activated), this, &RangeViewWidget::loadRangeData);
+}
+
+void RangeViewWidget::setupTransactionTypeCards()
+{
+    expenseCard = createCustomCard("支出");
+    incomeCard = createCustomCard("收入");
+
+    connect(expenseCard, &QPushButton::clicked, this, [this](){ switchTransactionType("支出"); });
+    connect(incomeCard, &QPushButton::clicked, this, [this](){ switchTransactionType("收入"); });
+}
+
+QPushButton* RangeViewWidget::createCustomCard(const QString &title) {
+    QPushButton *card = new QPushButton();
+    card->setFixedSize(160, 60);
+    card->setCheckable(true);
+    QVBoxLayout *layout = new QVBoxLayout(card);
+    layout->setContentsMargins(15, 8, 15, 8);
+    layout->setSpacing(0);
+
+    QLabel *tLabel = new QLabel(title);
+    tLabel->setObjectName("titleLabel");
+    QLabel *vLabel = new QLabel("￥0.00");
+    vLabel->setObjectName("amountLabel");
+    vLabel->setStyleSheet("font-size: 18px; font-weight: bold; background-color: transparent;");
+
+    layout->addWidget(tLabel);
+    layout->addWidget(vLabel);
+    layout->addStretch();
+    return card;
+}
+
+void RangeViewWidget::switchTransactionType(const QString &type)
+{
+    currentTransactionType = type;
+    QString activeStyle =
+        "QPushButton { background-color: white; border: 2px solid #3b6ea5; border-radius: 10px; }"
+        "QLabel#titleLabel { color: #3b6ea5; background-color: transparent; font-size: 12px; }"
+        "QLabel#amountLabel { color: #3b6ea5; background-color: transparent; }";
+    QString inactiveStyle =
+        "QPushButton { background-color: white; border: 2px solid #e0e8f0; border-radius: 10px; }"
+        "QLabel#titleLabel { color: #999; background-color: transparent; font-size: 12px; }"
+        "QLabel#amountLabel { color: #999; background-color: transparent; }";
+
+    if (type == "支出") {
+        expenseCard->setStyleSheet(activeStyle);
+        incomeCard->setStyleSheet(inactiveStyle);
+        expenseCard->setChecked(true);
+        incomeCard->setChecked(false);
+    } else {
+        expenseCard->setStyleSheet(inactiveStyle);
+        incomeCard->setStyleSheet(activeStyle);
+        expenseCard->setChecked(false);
+        incomeCard->setChecked(true);
+    }
+    reloadCategoryFilter();
+    loadRangeData();
+}
+
+// 收入和支出的分类 id 不同，切换类型或数据变化时重新填充分类下拉框；
+// 原来选中的分类仍然存在时保持选中
+void RangeViewWidget::reloadCategoryFilter()
+{
+    int selected = categoryComboBox->currentData().toInt();
+    categoryComboBox->clear();
+    categoryComboBox->addItem("全部分类", 0);
+
+    DatabaseManager &db = DatabaseManager::instance();
+    if (!db.isReady())
+        return;
+
+    QMap<int, QString> categories = db.getCategories(currentTransactionType == "支出" ? "expense" : "income");
+    for (auto it = categories.constBegin(); it != categories.constEnd(); ++it) {
+        categoryComboBox->addItem(it.value(), it.key());
+    }
+    categoryComboBox->setCurrentIndex(qMax(0, categoryComboBox->findData(selected)));
+}
+
+void RangeViewWidget::setupLineChart()
+{
+    lineChartView = new QChartView();
+    lineChartView->setFixedHeight(300);
+    lineChartView->setRenderHint(QPainter::Antialiasing);
+
+    QChart *chart = new QChart();
+    chart->setTitle("区间逐日趋势");
+    chart->setBackgroundBrush(QBrush(QColor("#ffffff")));
+    chart->legend()->setAlignment(Qt::AlignBottom);
+
+    lineSeries = new QLineSeries();
+    lineSeries->setName("逐日金额");
+    lineSeries->setPen(QPen(QColor("#3b6ea5"), 2));
+    chart->addSeries(lineSeries);
+
+    axisX = new QDateTimeAxis();
+    axisX->setFormat("yyyy-MM-dd");
+    axisX->setTickCount(6);
+    chart->addAxis(axisX, Qt::AlignBottom);
+    lineSeries->attachAxis(axisX);
+
+    axisY = new QValueAxis();
+    axisY->setLabelFormat("%.0f");
+    chart->addAxis(axisY, Qt::AlignLeft);
+    lineSeries->attachAxis(axisY);
+
+    // 累计结余量级与逐日金额不同，单独放右侧纵轴
+    balanceSeries = new QLineSeries();
+    balanceSeries->setName("累计结余");
+    balanceSeries->setPen(QPen(QColor("#5aa469"), 2, Qt::DashLine));
+    chart->addSeries(balanceSeries);
+    balanceSeries->attachAxis(axisX);
+    balanceAxis = new QValueAxis();
+    balanceAxis->setLabelFormat("%.0f");
+    chart->addAxis(balanceAxis, Qt::AlignRight);
+    balanceSeries->attachAxis(balanceAxis);
+
+    connect(lineSeries, &QLineSeries::hovered, this, [this](const QPointF &point, bool state) {
+        if (state) {
+            QDate day = QDateTime::fromMSecsSinceEpoch(static_cast<qint64>(point.x())).date();
+            QString tooltip = QString(
+                "<div style='font-family: Microsoft YaHei;'>"
+                "<b>%1</b><br/>"
+                "金额: <span style='color:#3b6ea5; font-size:14px;'>￥%2</span>"
+                "</div>"
+            ).arg(day.toString("yyyy-MM-dd")).arg(point.y(), 0, 'f', 2);
+            QToolTip::showText(QCursor::pos(), tooltip, lineChartView);
+        } else {
+            QToolTip::hideText();
+        }
+    });
+
+    connect(balanceSeries, &QLineSeries::hovered, this, [this](const QPointF &point, bool state) {
+        if (state) {
+            QDate day = QDateTime::fromMSecsSinceEpoch(static_cast<qint64>(point.x())).date();
+            QString tooltip = QString(
+                "<div style='font-family: Microsoft YaHei;'>"
+                "<b>%1</b><br/>"
+                "累计结余: <span style='color:#5aa469; font-size:14px;'>￥%2</span>"
+                "</div>"
+            ).arg(day.toString("yyyy-MM-dd")).arg(point.y(), 0, 'f', 2);
+            QToolTip::showText(QCursor::pos(), tooltip, lineChartView);
+        } else {
+            QToolTip::hideText();
+        }
+    });
+
+    lineChartView->setChart(chart);
+}
+
+void RangeViewWidget::setupMerchantPanel()
+{
+    merchantListWidget = new QListWidget();
+    merchantListWidget->setFixedWidth(320);
+    merchantListWidget->setMinimumHeight(200);
+    merchantListWidget->setSelectionMode(QAbstractItemView::SingleSelection);
+    merchantListWidget->setStyleSheet(
+        "QListWidget { "
+        "background-color: white; "
+        "border: 1px solid #d0d8e0; "
+        "border-radius: 5px; "
+        "}"
+        "QListWidget::item { "
+        "padding: 6px; "
+        "border-bottom: 1px solid #e0e8f0; "
+        "}"
+        "QListWidget::item:selected { background-color: #e8f0f8; color: #3b6ea5; }"
+    );
+
+    connect(merchantListWidget, &QListWidget::itemClicked, this, [this](QListWidgetItem *item) {
+        loadMerchantTrend(item->data(Qt::UserRole).toInt(), item->data(Qt::UserRole + 1).toString());
+    });
+
+    merchantTrendView = new QChartView();
+    merchantTrendView->setMinimumHeight(200);
+    merchantTrendView->setRenderHint(QPainter::Antialiasing);
+
+    QChart *chart = new QChart();
+    chart->setTitle("交易对方逐月金额");
+    chart->setBackgroundBrush(QBrush(QColor("#ffffff")));
+    chart->legend()->setVisible(false);
+
+    merchantTrendSeries = new QBarSeries();
+    chart->addSeries(merchantTrendSeries);
+
+    merchantTrendAxisX = new QBarCategoryAxis();
+    chart->addAxis(merchantTrendAxisX, Qt::AlignBottom);
+    merchantTrendSeries->attachAxis(merchantTrendAxisX);
+
+    merchantTrendAxisY = new QValueAxis();
+    merchantTrendAxisY->setLabelFormat("%.0f");
+    chart->addAxis(merchantTrendAxisY, Qt::AlignLeft);
+    merchantTrendSeries->attachAxis(merchantTrendAxisY);
+
+    connect(merchantTrendSeries, &QBarSeries::hovered, this, [this](bool status, int index, QBarSet *set) {
+        if (status) {
+            QString tooltip = QString(
+                "<div style='font-family: Microsoft YaHei;'>"
+                "<b>%1</b><br/>"
+                "金额: <span style='color:#3b6ea5; font-size:14px;'>￥%2</span>"
+                "</div>"
+            ).arg(merchantTrendAxisX->at(index)).arg(set->at(index), 0, 'f', 2);
+            QToolTip::showText(QCursor::pos(), tooltip, merchantTrendView);
+        } else {
+            QToolTip::hideText();
+        }
+    });
+
+    merchantTrendView->setChart(chart);
+}
+
+void RangeViewWidget::loadRangeData()
+{
+    //载入数据库
+    DatabaseManager &db = DatabaseManager::instance();
+    if(!db.isReady()){
+        if(!db.openDatabase()){
+            return;
+        }
+    }
+
+    QDate from = fromDateEdit->date();
+    QDate to = toDateEdit->date();
+    if (to < from)
+        qSwap(from, to);
+    int categoryId = categoryComboBox->currentData().toInt();
+    int methodId = methodComboBox->currentData().toInt();
+    QString transactionType = currentTransactionType;
+
+    // 查询在数据库线程执行，先显示占位；结果回来时如果条件已经变了就丢弃
+    int generation = ++loadGeneration;
+    showLoadingState();
+    QElapsedTimer timer;
+    timer.start();
+    DbExecutor::instance().run<QJsonObject>(
+        [from, to, categoryId, methodId, transactionType]() {
+            return fetchRangeData(from, to, categoryId, methodId, transactionType);
+        },
+        this,
+        [this, generation, timer](const QJsonObject &response) {
+            if (generation != loadGeneration)
+                return;
+            DbExecutor::instance().recordLoadTime("range", timer.elapsed());
+            updateRangeData(response);
+        });
+}
+
+// 在数据库线程上执行，只使用参数，不访问界面
+QJsonObject RangeViewWidget::fetchRangeData(const QDate &from, const QDate &to, int categoryId, int methodId,
+                                            const QString &transactionType)
+{
+    DbExecutor &executor = DbExecutor::instance();
+    RangeFilter filter;
+    filter.from = from;
+    filter.to = to;
+    filter.categoryId = categoryId;
+    filter.methodId = methodId;
+    QString type = (transactionType == "支出") ? "expense" : "income";
+
+    // 三项统计都是同一段索引上的范围扫描，互不依赖，并行执行
+    QFuture<PeriodSummary> summaryFuture = executor.fork<PeriodSummary>([filter]() {
+        return DatabaseManager::instance().summarizeRange(filter);
+    });
+    QFuture<QVector<DayTotal> > daysFuture = executor.fork<QVector<DayTotal> >([filter]() {
+        return DatabaseManager::instance().getRangeDailyTotals(filter);
+    });
+    QFuture<QVector<CategoryStat> > statsFuture = executor.fork<QVector<CategoryStat> >([filter, type]() {
+        return DatabaseManager::instance().getRangeCategoryStats(filter, type);
+    });
+    // 交易对方排行走内存中的列式快照，不受分类/交易方式筛选影响
+    QFuture<QVector<MerchantStat> > merchantsFuture = executor.fork<QVector<MerchantStat> >([from, to, type]() {
+        return DatabaseManager::instance().getTopMerchants(from, to, type);
+    });
+    // 累计结余不受筛选影响，取内存中的树状数组，与区间长度和历史长度无关
+    QFuture<QVector<double> > balanceFuture = executor.fork<QVector<double> >([from, to]() {
+        return DatabaseManager::instance().getRunningBalance(from, to);
+    });
+
+    QJsonObject response;
+    response["operation"] = true;
+    response["from"] = from.toString("yyyy-MM-dd");
+    response["to"] = to.toString("yyyy-MM-dd");
+
+    PeriodSummary summary = summaryFuture.result();
+    double expense = summary.expense;
+    double income = summary.income;
+    response["rangeExpenseTotal"] = expense;
+    response["rangeIncomeTotal"] = income;
+    response["count"] = (type == "expense") ? summary.expenseCount : summary.incomeCount;
+    response["maxAmount"] = (type == "expense") ? summary.maxExpense : summary.maxIncome;
+    response["firstRecord"] = summary.firstRecord.toString("yyyy-MM-dd HH:mm:ss");
+    response["lastRecord"] = summary.lastRecord.toString("yyyy-MM-dd HH:mm:ss");
+
+    QJsonArray daily;
+    for (const DayTotal &day : daysFuture.result()) {
+        QJsonObject obj;
+        obj["date"] = day.date.toString("yyyy-MM-dd");
+        obj["amount"] = (type == "expense") ? day.expense : day.income;
+        daily.append(obj);
+    }
+    response["daily"] = daily;
+
+    QJsonArray balance;
+    for (double value : balanceFuture.result())
+        balance.append(value);
+    response["balance"] = balance;
+
+    QJsonArray pie;
+    QJsonObject item;
+    double total = (type == "expense") ? expense : income;
+    for (const CategoryStat &stat : statsFuture.result()) {
+        item["category"] = stat.name;
+        item["totalAmount"] = stat.total;
+        item["ratio"] = total > 0 ? stat.total / total : 0;
+        item["count"] = stat.count;
+        pie.append(item);
+    }
+    response["pie"] = pie;
+
+    QJsonArray merchants;
+    for (const MerchantStat &stat : merchantsFuture.result()) {
+        QJsonObject obj;
+        obj["counterpartyId"] = stat.counterpartyId;
+        obj["name"] = stat.name;
+        obj["total"] = stat.total;
+        obj["upperBound"] = stat.upperBound;
+        obj["count"] = stat.count;
+        obj["exact"] = stat.exact;
+        merchants.append(obj);
+    }
+    response["merchants"] = merchants;
+
+    return response;
+}
+
+// 查询进行中的占位：金额和概况先显示加载中，图表保留上一次的内容直到新数据到达
+void RangeViewWidget::showLoadingState()
+{
+    QLabel *expVal = expenseCard->findChild<QLabel*>("amountLabel");
+    if (expVal) expVal->setText("…");
+
+    QLabel *incVal = incomeCard->findChild<QLabel*>("amountLabel");
+    if (incVal) incVal->setText("…");
+
+    summaryLabel->setText("加载中…");
+}
+
+void RangeViewWidget::updateRangeData(const QJsonObject &json)
+{
+    if (!json["operation"].toBool()) return;
+
+    // --- A. 收支卡片 ---
+    QLabel *expVal = expenseCard->findChild<QLabel*>("amountLabel");
+    if (expVal) expVal->setText(QString("￥%1").arg(json["rangeExpenseTotal"].toDouble(), 0, 'f', 2));
+
+    QLabel *incVal = incomeCard->findChild<QLabel*>("amountLabel");
+    if (incVal) incVal->setText(QString("￥%1").arg(json["rangeIncomeTotal"].toDouble(), 0, 'f', 2));
+
+    // --- B. 饼图与排行榜 ---
+    pieSeries->clear();
+    sliceDataMap.clear();
+    rankListWidget->clear();
+
+    int rank = 1;
+    for (const QJsonValue &value : json["pie"].toArray()) {
+        QJsonObject item = value.toObject();
+        QString category = item["category"].toString();
+        double amount = item["totalAmount"].toDouble();
+
+        QPieSlice *slice = pieSeries->append(category, amount);
+        sliceDataMap[slice] = item;
+
+        QString rankText = QString("%1. %2 (%3%) - ￥%4")
+                            .arg(rank++).arg(category)
+                            .arg(item["ratio"].toDouble() * 100, 0, 'f', 1)
+                            .arg(amount, 0, 'f', 2);
+        rankListWidget->addItem(new QListWidgetItem(rankText));
+    }
+
+    // --- C. 区间概况 ---
+    int count = json["count"].toInt();
+    if (count == 0) {
+        summaryLabel->setText("区间内没有记录");
+    } else {
+        summaryLabel->setText(QString("%1共 %2 笔，单笔最大 ￥%3\n%4 ~ %5")
+            .arg(currentTransactionType).arg(count)
+            .arg(json["maxAmount"].toDouble(), 0, 'f', 2)
+            .arg(json["firstRecord"].toString().left(10))
+            .arg(json["lastRecord"].toString().left(10)));
+    }
+
+    // --- D. 逐日折线：一次 replace，避免逐点追加触发重绘 ---
+    QJsonArray daily = json["daily"].toArray();
+    QVector<QPointF> points;
+    points.reserve(daily.size());
+    double maxVal = 0;
+    for (const QJsonValue &value : daily) {
+        QJsonObject day = value.toObject();
+        QDateTime time(QDate::fromString(day["date"].toString(), "yyyy-MM-dd"), QTime(0, 0));
+        double amount = day["amount"].toDouble();
+        points.append(QPointF(time.toMSecsSinceEpoch(), amount));
+        maxVal = qMax(maxVal, amount);
+    }
+    lineSeries->replace(points);
+
+    QDate from = QDate::fromString(json["from"].toString(), "yyyy-MM-dd");
+    QDate to = QDate::fromString(json["to"].toString(), "yyyy-MM-dd");
+
+    QJsonArray balance = json["balance"].toArray();
+    QVector<QPointF> balancePoints;
+    balancePoints.reserve(balance.size());
+    double minBalance = 0;
+    double maxBalance = 0;
+    for (int i = 0; i < balance.size(); ++i) {
+        QDateTime time(from.addDays(i), QTime(0, 0));
+        double value = balance[i].toDouble();
+        balancePoints.append(QPointF(time.toMSecsSinceEpoch(), value));
+        minBalance = qMin(minBalance, value);
+        maxBalance = qMax(maxBalance, value);
+    }
+    balanceSeries->replace(balancePoints);
+    balanceAxis->setRange(minBalance * 1.2, maxBalance > 0 ? maxBalance * 1.2 : 1);
+    axisX->setRange(QDateTime(from, QTime(0, 0)), QDateTime(to, QTime(0, 0)));
+    axisY->setRange(0, maxVal > 0 ? maxVal * 1.2 : 1);
+
+    // --- E. 交易对方排行 ---
+    loadedFrom = from;
+    loadedTo = to;
+    updateMerchantList(json["merchants"].toArray());
+}
+
+void RangeViewWidget::updateMerchantList(const QJsonArray &merchants)
+{
+    merchantListWidget->clear();
+    ++trendGeneration;
+    merchantTrendSeries->clear();
+    merchantTrendAxisX->clear();
+    merchantTrendView->chart()->setTitle("交易对方逐月金额");
+
+    if (merchants.isEmpty()) {
+        QListWidgetItem *item = new QListWidgetItem("区间内没有交易对方记录");
+        item->setFlags(Qt::NoItemFlags);
+        merchantListWidget->addItem(item);
+        return;
+    }
+
+    int rank = 1;
+    for (const QJsonValue &value : merchants) {
+        QJsonObject merchant = value.toObject();
+        QString name = merchant["name"].toString();
+        double total = merchant["total"].toDouble();
+
+        // 近似结果的金额是下界，括号里给出上界
+        QString text;
+        if (merchant["exact"].toBool()) {
+            text = QString("%1. %2 - ￥%3（%4 笔）")
+                       .arg(rank++).arg(name)
+                       .arg(total, 0, 'f', 2)
+                       .arg(merchant["count"].toInt());
+        } else {
+            text = QString("%1. %2 - ≈￥%3（≤￥%4）")
+                       .arg(rank++).arg(name)
+                       .arg(total, 0, 'f', 2)
+                       .arg(merchant["upperBound"].toDouble(), 0, 'f', 2);
+        }
+
+        QListWidgetItem *item = new QListWidgetItem(text);
+        item->setData(Qt::UserRole, merchant["counterpartyId"].toInt());
+        item->setData(Qt::UserRole + 1, name);
+        merchantListWidget->addItem(item);
+    }
+}
+
+void RangeViewWidget::loadMerchantTrend(int counterpartyId, const QString &name)
+{
+    if (counterpartyId <= 0 || !loadedFrom.isValid())
+        return;
+
+    QDate from = loadedFrom;
+    QDate to = loadedTo;
+    QString type = (currentTransactionType == "支出") ? "expense" : "income";
+
+    int generation = ++trendGeneration;
+    merchantTrendView->chart()->setTitle(QString("%1 逐月金额（加载中…）").arg(name));
+    QElapsedTimer timer;
+    timer.start();
+    DbExecutor::instance().run<QJsonObject>(
+        [counterpartyId, name, from, to, type]() {
+            QJsonObject response;
+            response["name"] = name;
+            QJsonArray months;
+            for (const MerchantMonth &month : DatabaseManager::instance().getMerchantTrend(counterpartyId, from, to, type)) {
+                QJsonObject obj;
+                obj["label"] = QString("%1-%2").arg(month.year).arg(month.month, 2, 10, QChar('0'));
+                obj["total"] = month.total;
+                obj["count"] = month.count;
+                months.append(obj);
+            }
+            response["months"] = months;
+            return response;
+        },
+        this,
+        [this, generation, timer](const QJsonObject &response) {
+            if (generation != trendGeneration)
+                return;
+            DbExecutor::instance().recordLoadTime("merchantTrend", timer.elapsed());
+            updateMerchantTrend(response);
+        });
+}
+
+void RangeViewWidget::updateMerchantTrend(const QJsonObject &json)
+{
+    merchantTrendSeries->clear();
+    merchantTrendAxisX->clear();
+
+    QBarSet *set = new QBarSet(json["name"].toString());
+    set->setColor(QColor("#3b6ea5"));
+    QStringList labels;
+    double maxVal = 0;
+    for (const QJsonValue &value : json["months"].toArray()) {
+        QJsonObject month = value.toObject();
+        double total = month["total"].toDouble();
+        *set << total;
+        labels << month["label"].toString();
+        maxVal = qMax(maxVal, total);
+    }
+    merchantTrendSeries->append(set);
+    merchantTrendAxisX->append(labels);
+    merchantTrendAxisY->setRange(0, maxVal > 0 ? maxVal * 1.2 : 1);
+    merchantTrendView->chart()->setTitle(QString("%1 逐月金额").arg(json["name"].toString()));
+}
+
+void RangeViewWidget::refreshData()
+{
+    // 导入或新增记录可能带来新的分类
+    reloadCategoryFilter();
+    loadRangeData();
+}
@@ -0,0 +1,145 @@
+#ifndef RANGEVIEWWIDGET_H
+#define RANGEVIEWWIDGET_H
+
+#include <QWidget>
+#include <QComboBox>
+#include <QPushButton>
+#include <QLabel>
+#include <QDateEdit>
+#include <QChart>
+#include <QChartView>
+#include <QPieSeries>
+#include <QLineSeries>
+#include <QBarSeries>
+#include <QBarSet>
+#include <QBarCategoryAxis>
+#include <QDateTimeAxis>
+#include <QValueAxis>
+#include <QListWidget>
+#include <QJsonObject>
+#include <QJsonArray>
+
+QT_CHARTS_USE_NAMESPACE
+
+
+/**
+ * @brief 自定义区间视图组件
+ *
+ * 功能说明：
+ * - 显示任意起止日期之间的收支统计，可跨年
+ * - 可按分类、交易方式筛选
+ * - 支持切换"支出"/"收入"两种交易类型
+ * - 包含以下可视化组件：
+ *   1. 饼图 + 排行榜：区间内的分类占比
+ *   2. 概况卡片：笔数、单笔最大、首末记录时间
+ *   3. 折线图：区间内逐日金额，以及截至每天的累计结余（收入减支出）
+ *   4. 收支卡片：区间总收入/总支出
+ *   5. 交易对方排行：区间内金额最高的交易对方，点击后显示该对方的逐月金额
+ *      账单很多时排行由按月摘要合并得出，金额前加"≈"并给出上界
+ *
+ * 响应格式：
+ * {
+ *   "operation": true,
+ *   "from": "2023-01-01",
+ *   "to": "2024-06-30",
+ *   "rangeExpenseTotal": 75000.00,
+ *   "rangeIncomeTotal": 90000.00,
+ *   "count": 1200,
+ *   "maxAmount": 3000.00,
+ *   "firstRecord": "2023-01-02 08:12:00",
+ *   "lastRecord": "2024-06-29 21:40:00",
+ *   "daily": [ { "date": "2023-01-01", "amount": 35.20 } ],
+ *   "balance": [ 12000.00 ],   // 与 daily 一一对应，不受分类/交易方式筛选影响
+ *   "pie": [ { "category": "餐饮美食", "totalAmount": 1500.00, "ratio": 0.4, "count": 30 } ],
+ *   "merchants": [ { "counterpartyId": 12, "name": "某超市", "total": 3200.00, "upperBound": 3200.00,
+ *                    "count": 41, "exact": true } ]
+ * }
+ */
+class RangeViewWidget : public QWidget
+{
+    Q_OBJECT
+
+public:
+    explicit RangeViewWidget(QWidget *parent = nullptr);
+
+public slots:
+    /**
+     * @brief 切换交易类型（支出/收入）
+     * @param type "支出" 或 "收入"
+     *
+     * 分类下拉框随之换成对应类型的分类
+     */
+    void switchTransactionType(const QString &type);
+
+    void refreshData();
+
+private:
+    void setupUI();
+    void setupPieChart();
+    void setupRankList();
+    void setupSummaryCard();
+    void setupRangeSelector();
+    void setupTransactionTypeCards();
+    void setupLineChart();
+    void setupMerchantPanel();
+    void reloadCategoryFilter();
+
+    /**
+     * @brief 加载区间数据
+     *
+     * 查询在数据库线程执行，先显示占位，结果到达后更新界面
+     */
+    void loadRangeData();
+
+    /**
+     * @brief 查询区间数据并组装成响应格式
+     *
+     * 在数据库线程上执行，只使用参数，不访问界面组件
+     */
+    static QJsonObject fetchRangeData(const QDate &from, const QDate &to, int categoryId, int methodId,
+                                      const QString &transactionType);
+
+    // 查询进行中时显示占位
+    void showLoadingState();
+
+    void updateRangeData(const QJsonObject &json);
+    void updateMerchantList(const QJsonArray &merchants);
+
+    // 在数据库线程上查询某个交易对方在当前区间内的逐月金额，回来后画到下钻图上
+    void loadMerchantTrend(int counterpartyId, const QString &name);
+    void updateMerchantTrend(const QJsonObject &json);
+
+    QPushButton* createCustomCard(const QString &);
+
+    QWidget *rangeSelectorWidget;
+    QDateEdit *fromDateEdit;
+    QDateEdit *toDateEdit;
+    QComboBox *categoryComboBox;
+    QComboBox *methodComboBox;
+    QChartView *pieChartView;
+    QPieSeries *pieSeries;
+    QMap<QPieSlice*, QJsonObject> sliceDataMap;
+    QListWidget *rankListWidget;
+    QLabel *summaryLabel;
+    QPushButton *expenseCard;
+    QPushButton *incomeCard;
+    QChartView *lineChartView;
+    QLineSeries *lineSeries;
+    QDateTimeAxis *axisX;
+    QValueAxis *axisY;
+    QLineSeries *balanceSeries;
+    QValueAxis *balanceAxis;
+    QListWidget *merchantListWidget;
+    QChartView *merchantTrendView;
+    QBarSeries *merchantTrendSeries;
+    QBarCategoryAxis *merchantTrendAxisX;
+    QValueAxis *merchantTrendAxisY;
+
+    QString currentTransactionType;
+    int loadGeneration = 0;  // 每次发起查询加一，用于丢弃过期的结果
+    int trendGeneration = 0; // 交易对方下钻同上
+    QDate loadedFrom;        // 当前显示的区间，下钻查询沿用
+    QDate loadedTo;
+};
+
+#endif // RANGEVIEWWIDGET_H
@@ -10,7 +10,9 @@
 #include <QFont>
 #include <QSqlQuery>
 #include <QDebug>
+#include <QElapsedTimer>
 #include "../db/database_manager.h"
+#include "../db/db_executor.h"
 
 
 WeekViewWidget::WeekViewWidget(QWidget *parent)
@@ -144,6 +146,11 @@ void WeekViewWidget::setupUI()
 
     setupWeekCalendarButtons();
     rightLayout->addLayout(weekButtonsLayout);
+
+    upcomingLabel = new QLabel();
+    upcomingLabel->setWordWrap(true);
+    upcomingLabel->setStyleSheet("QLabel { color: #3b6ea5; font-size: 12px; background: transparent; padding: 0 0 6px 0; }");
+    rightLayout->addWidget(upcomingLabel);
     mainLayout->addLayout(rightLayout, 2);
 
     // 默认选中支出
@@ -499,40 +506,88 @@ void WeekViewWidget::loadWeekData()
             return;
         }
     }
+
+    int year = currentYear;
+    int week = currentWeek;
+    QDate weekStart = getMondayOfISOWeek(currentYear, currentWeek);
+    QString transactionType = currentTransactionType;
+
+    // 查询在数据库线程执行，先显示占位；结果回来时如果已经切到别的周或类型就丢弃
+    int generation = ++loadGeneration;
+    showLoadingState();
+    QElapsedTimer timer;
+    timer.start();
+    DbExecutor::instance().run<QJsonObject>(
+        [year, week, weekStart, transactionType]() {
+            return fetchWeekData(year, week, weekStart, transactionType);
+        },
+        this,
+        [this, generation, timer](const QJsonObject &response) {
+            if (generation != loadGeneration)
+                return;
+            DbExecutor::instance().recordLoadTime("week", timer.elapsed());
+            updateWeekData(response);
+        });
+}
+
+// 在数据库线程上执行，只使用参数，不访问界面
+QJsonObject WeekViewWidget::fetchWeekData(int year, int week, const QDate &weekStart, const QString &transactionType)
+{
+    DbExecutor &executor = DbExecutor::instance();
+    PeriodKey period = PeriodKey::ofWeek(year, week);
+    QString type;
+    if(transactionType == "支出"){
+        type = "expense";
+    }
+    else{
+        type = "income";
+    }
+
+    // 本周、上周与去年同周一次查出：卡片总额和两周的逐日柱状图都取自这里
+    QFuture<PeriodComparison> comparisonFuture = executor.fork<PeriodComparison>([weekStart]() {
+        return DatabaseManager::instance().comparePeriods(weekStart, CompareWeek);
+    });
+    QFuture<QVector<CategoryStat> > statsFuture = executor.fork<QVector<CategoryStat> >([period, type]() {
+        return DatabaseManager::instance().getCategoryStats(period, type);
+    });
+    QFuture<QString> commentFuture = executor.fork<QString>([year, week, type]() {
+        return DatabaseManager::instance().getTopCategoryByWeekWithComment(year, week, type);
+    });
+    // 周期性扣费取最近一次后台检测的结果按周期推算，不扫描账单
+    QFuture<QVector<RecurringCharge> > upcomingFuture = executor.fork<QVector<RecurringCharge> >([weekStart]() {
+        return DatabaseManager::instance().getUpcomingCharges(weekStart, weekStart.addDays(6));
+    });
+    // 本周每天结尾的滚动窗口，由内存中的区间合计索引算出
+    QFuture<QVector<RollingPoint> > rollingFuture = executor.fork<QVector<RollingPoint> >([weekStart, type]() {
+        return DatabaseManager::instance().getRollingMetrics(weekStart, weekStart.addDays(6), type);
+    });
+
     QJsonObject response;
     response["operation"] = true;
     QJsonObject currentWeekObj;
-    currentWeekObj["year"] = currentYear;
-    currentWeekObj["week"] = currentWeek;
+    currentWeekObj["year"] = year;
+    currentWeekObj["week"] = week;
     // 周总收支
-    QSqlQuery query = db.getTotalIncomeByWeek(currentYear,currentWeek);
-    query.next();
-    double income=query.value(0).toDouble();
+    PeriodComparison comparison = comparisonFuture.result();
+    double income = comparison.income[PeriodComparison::Current];
     currentWeekObj["weeklyIncomeTotal"] = income;
-
-    query = db.getTotalExpenseByWeek(currentYear,currentWeek);
-    query.next();
-    double expense=query.value(0).toDouble();
-    qDebug() << expense;
+    double expense = comparison.expense[PeriodComparison::Current];
     currentWeekObj["weeklyExpenseTotal"] = expense;
 
     //单日收支
     QJsonArray currentBars;
     QJsonArray previousBars;
-    QDate weekStart=getMondayOfISOWeek(currentYear, currentWeek);
-    for (int i = 0; i < 7; i++) {
-        query=db.getTotalRecordsByDay(weekStart.addDays(i).toString("yyyy-MM-dd"));
-        query.next();
+    const QVector<DayTotal> &currentDays = comparison.daily[PeriodComparison::Current];
+    const QVector<DayTotal> &previousDays = comparison.daily[PeriodComparison::Previous];
+    for (int i = 0; i < 7 && currentDays.size() == 7 && previousDays.size() == 7; i++) {
         QJsonObject cDay;
-        cDay["dailyExpense"] = query.value(0).toDouble();
-        cDay["dailyIncome"] = query.value(1).toDouble();
+        cDay["dailyExpense"] = currentDays[i].expense;
+        cDay["dailyIncome"] = currentDays[i].income;
         currentBars.append(cDay);
 
-        query=db.getTotalRecordsByDay(weekStart.addDays(i-7).toString("yyyy-MM-dd"));
-        query.next();
         QJsonObject pDay;
-        pDay["dailyExpense"] = query.value(0).toDouble();
-        pDay["dailyIncome"] = query.value(1).toDouble();
+        pDay["dailyExpense"] = previousDays[i].expense;
+        pDay["dailyIncome"] = previousDays[i].income;
         previousBars.append(pDay);
     }
     currentWeekObj["dailyBars"] = currentBars;
@@ -543,42 +598,54 @@ void WeekViewWidget::loadWeekData()
     // 饼图数据根据类型变化
     QJsonArray pieArray;
     QJsonObject cat;
-    if (currentTransactionType == "支出") {
-        query = db.getExpenseCategoryStatsByWeek(currentYear,currentWeek);
-        while(query.next()){
-            cat["category"] = query.value(0).toString();
-            cat["totalAmount"] = query.value(2).toDouble();
-            cat["ratio"] = query.value(2).toDouble()/expense;
-            cat["count"] = query.value(1).toInt();
-            pieArray.append(cat);
-        }
-
-    } else {
-        query = db.getIncomeCategoryStatsByWeek(currentYear,currentWeek);
-        while(query.next()){
-            cat["category"] = query.value(0).toString();
-            cat["totalAmount"] = query.value(2).toDouble();
-            cat["ratio"] = query.value(2).toDouble()/income;
-            cat["count"] = query.value(1).toInt();
-            pieArray.append(cat);
-        }
+    double total = (type == "expense") ? expense : income;
+    for (const CategoryStat &stat : statsFuture.result()) {
+        cat["category"] = stat.name;
+        cat["totalAmount"] = stat.total;
+        cat["ratio"] = stat.total/total;
+        cat["count"] = stat.count;
+        pieArray.append(cat);
     }
     currentWeekObj["pie"] = pieArray;
-    QString type;
-    if(currentTransactionType == "支出"){
-        type = "expense";
+    currentWeekObj["comment"] = commentFuture.result();
+
+    QJsonArray rollingArray;
+    for (const RollingPoint &point : rollingFuture.result()) {
+        QJsonObject obj;
+        obj["date"] = point.date.toString("yyyy-MM-dd");
+        obj["total7"] = point.total7;
+        obj["total30"] = point.total30;
+        obj["average7"] = point.average7;
+        obj["average30"] = point.average30;
+        obj["average90"] = point.average90;
+        rollingArray.append(obj);
     }
-    else{
-        type = "income";
+    currentWeekObj["rolling"] = rollingArray;
+
+    QJsonArray upcomingArray;
+    for (const RecurringCharge &charge : upcomingFuture.result()) {
+        QJsonObject obj;
+        obj["date"] = charge.nextDate.toString("yyyy-MM-dd");
+        obj["name"] = charge.name;
+        obj["amount"] = charge.amount;
+        obj["cadence"] = charge.cadence;
+        upcomingArray.append(obj);
     }
-    QString comment = db.getTopCategoryByWeekWithComment(currentYear,currentWeek,type);
-    //currentWeekObj["comment"] = (currentTransactionType == "支出") ? "节约是美德" : "加油赚钱！";
-    currentWeekObj["comment"] = comment;
+    currentWeekObj["upcoming"] = upcomingArray;
     response["currentWeek"] = currentWeekObj;
     response["previousWeek"] = previousWeekObj;
 
-    updateWeekData(response);
+    return response;
+}
 
+// 查询进行中的占位：金额和评价先显示加载中，图表保留上一次的内容直到新数据到达
+void WeekViewWidget::showLoadingState()
+{
+    if (QLabel *expLabel = expenseCard->findChild<QLabel*>("amountLabel"))
+        expLabel->setText("…");
+    if (QLabel *incLabel = incomeCard->findChild<QLabel*>("amountLabel"))
+        incLabel->setText("…");
+    commentLabel->setText("加载中…");
 }
 
 void WeekViewWidget::loadTestData()
@@ -747,6 +814,44 @@ void WeekViewWidget::updateWeekData(const QJsonObject &json)
             }
         });
 
+        // 滚动日均折线叠加在柱状图上，横轴沿用周一到周日的分类下标
+        QJsonArray rollingArray = current["rolling"].toArray();
+        QLineSeries *avg7Series = new QLineSeries();
+        QLineSeries *avg30Series = new QLineSeries();
+        avg7Series->setName("近7日日均");
+        avg30Series->setName("近30日日均");
+        avg7Series->setPen(QPen(QColor("#e07b39"), 2));
+        avg30Series->setPen(QPen(QColor("#5aa469"), 2, Qt::DashLine));
+        for (int i = 0; i < rollingArray.size() && i < 7; ++i) {
+            QJsonObject point = rollingArray[i].toObject();
+            avg7Series->append(i, point["average7"].toDouble());
+            avg30Series->append(i, point["average30"].toDouble());
+        }
+        for (QLineSeries *line : {avg7Series, avg30Series}) {
+            barChart->addSeries(line);
+            for (auto axis : barChart->axes()) line->attachAxis(axis);
+        }
+        connect(avg7Series, &QLineSeries::hovered, this, [this, rollingArray](const QPointF &point, bool state) {
+            int index = qRound(point.x());
+            if (state && index >= 0 && index < rollingArray.size()) {
+                QJsonObject day = rollingArray[index].toObject();
+                QString tooltip = QString(
+                    "<div style='font-family: DengXian; padding: 5px;'>"
+                    "<b style='color:#333;'>截至 %1</b><br/>"
+                    "近7日: ￥%2（日均 ￥%3）<br/>"
+                    "近30日: ￥%4（日均 ￥%5）<br/>"
+                    "近90日日均: ￥%6"
+                    "</div>"
+                ).arg(day["date"].toString())
+                 .arg(day["total7"].toDouble(), 0, 'f', 2).arg(day["average7"].toDouble(), 0, 'f', 2)
+                 .arg(day["total30"].toDouble(), 0, 'f', 2).arg(day["average30"].toDouble(), 0, 'f', 2)
+                 .arg(day["average90"].toDouble(), 0, 'f', 2);
+                QToolTip::showText(QCursor::pos(), tooltip, barChartView);
+            } else {
+                QToolTip::hideText();
+            }
+        });
+
         barChart->setAnimationOptions(QChart::SeriesAnimations);
 
     // --- D. 更新底部周历按钮 ---
@@ -768,6 +873,8 @@ void WeekViewWidget::updateWeekData(const QJsonObject &json)
         }
     }
 
+    updateUpcomingCharges(current["upcoming"].toArray(), weekStart);
+
     // --- E. 更新卡片总金额 ---
     double totalExp = current["weeklyExpenseTotal"].toDouble();
         double totalInc = current["weeklyIncomeTotal"].toDouble();
@@ -783,6 +890,30 @@ void WeekViewWidget::updateWeekData(const QJsonObject &json)
     commentLabel->setFont(QFont("DengXian", 11));
 }
 
+// 预计扣费：周历下方一行汇总，对应日期按钮的提示里逐笔列出
+void WeekViewWidget::updateUpcomingCharges(const QJsonArray &upcoming, const QDate &weekStart)
+{
+    QStringList summary;
+    QMap<QDate, QStringList> byDay;
+    for (const QJsonValue &value : upcoming) {
+        QJsonObject charge = value.toObject();
+        QDate day = QDate::fromString(charge["date"].toString(), "yyyy-MM-dd");
+        QString text = QString("%1 ￥%2（%3）")
+                           .arg(charge["name"].toString())
+                           .arg(charge["amount"].toDouble(), 0, 'f', 2)
+                           .arg(charge["cadence"].toString());
+        summary << day.toString("MM/dd") + " " + text;
+        byDay[day] << text;
+    }
+
+    upcomingLabel->setText(summary.isEmpty() ? QString() : "预计扣费：" + summary.join("；"));
+    upcomingLabel->setVisible(!summary.isEmpty());
+    for (int i = 0; i < dayButtons.size(); ++i) {
+        QStringList charges = byDay.value(weekStart.addDays(i));
+        dayButtons[i]->setToolTip(charges.isEmpty() ? QString() : "预计扣费：\n" + charges.join("\n"));
+    }
+}
+
 void WeekViewWidget::onDayClicked(const QString &date)
 {
     // 暂时为空实现，仅用于测试界面
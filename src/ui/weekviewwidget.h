@@ -6,6 +6,7 @@
 #include <QChartView>
 #include <QPieSeries>
 #include <QBarSeries>
+#include <QLineSeries>
 #include <QBarSet>
 #include <QBarCategoryAxis>
 #include <QValueAxis>
@@ -34,9 +35,10 @@
  *   1. 饼图：显示分类占比
  *   2. 排行榜：显示分类金额排名
  *   3. 评论卡片：显示对应分类的评价文本
- *   4. 柱状图：显示本周与上周的每日金额对比
+ *   4. 柱状图：显示本周与上周的每日金额对比，叠加近 7 / 30 日滚动日均折线
  *   5. 周历按钮：显示周一到周日的日期和金额，可点击查看详情
  *   6. 收支卡片：显示本周总收入/总支出
+ *   7. 预计扣费：周历下方列出本周按周期推算的订阅、房租等扣费，对应日期按钮带提示
  *
  * 数据接口：
  * - 槽函数 onQueryWeekData()：接收后端返回的周度数据
@@ -78,7 +80,22 @@
  *       }
  *       // ... 分类数据
  *     ],
- *     "comment": "实用才是第一原则！"
+ *     "comment": "实用才是第一原则！",
+ *     "rolling": [
+ *       {
+ *         "date": "2024-01-15",   // 以这一天结尾的滚动窗口
+ *         "total7": 700.00,
+ *         "total30": 3000.00,
+ *         "average7": 100.00,
+ *         "average30": 100.00,
+ *         "average90": 95.00
+ *       }
+ *       // ... 7条（周一到周日）
+ *     ],
+ *     "upcoming": [
+ *       { "date": "2024-01-17", "name": "某视频会员", "amount": 25.00, "cadence": "每月" }
+ *       // ... 本周内预计的周期性扣费，按日期升序
+ *     ]
  *   },
  *   "previousWeek": {
  *     // 同 currentWeek 结构
@@ -172,6 +189,7 @@ private:
     void setupBarChart();
     //void setupWeekCalendar();
     void setupWeekCalendarButtons();
+    void updateUpcomingCharges(const QJsonArray &upcoming, const QDate &weekStart);
 
     /**
      * @brief 加载周度数据（从后端）
@@ -182,6 +200,16 @@ private:
      */
     void loadWeekData();
 
+    /**
+     * @brief 查询某周的数据并组装成 API 响应格式
+     *
+     * 在数据库线程上执行，只使用参数，不访问界面组件
+     */
+    static QJsonObject fetchWeekData(int year, int week, const QDate &weekStart, const QString &transactionType);
+
+    // 查询进行中时显示占位
+    void showLoadingState();
+
     /**
      * @brief 更新周数显示文字
      *
@@ -237,10 +265,12 @@ private:
     // 日期按钮组相关
     QHBoxLayout *weekButtonsLayout;
     QList<QPushButton*> dayButtons;
+    QLabel *upcomingLabel;
 
     QString currentTransactionType;
     int currentYear;
     int currentWeek;
+    int loadGeneration = 0;  // 每次发起查询加一，用于丢弃过期的结果
 };
 
 #endif // WEEKVIEWWIDGET_H
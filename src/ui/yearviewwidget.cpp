@@ -15,8 +15,10 @@
 #include <QPen>
 #include <QBarSeries>
 #include <QDebug>
+#include <QElapsedTimer>
 #include <QSqlQuery>
 #include "../db/database_manager.h"
+#include "../db/db_executor.h"
 
 YearViewWidget::YearViewWidget(QWidget *parent)
     : QWidget(parent)
@@ -219,7 +221,7 @@ void YearViewWidget::setupTransactionTypeCards()
 // 辅助方法简化创建
 QPushButton* YearViewWidget::createCustomCard(const QString &title) {
     QPushButton *card = new QPushButton();
-    card->setFixedSize(160, 60);
+    card->setFixedSize(160, 76);
     card->setCheckable(true);
     QVBoxLayout *layout = new QVBoxLayout(card);
     layout->setContentsMargins(15, 8, 15, 8);
@@ -230,9 +232,13 @@ QPushButton* YearViewWidget::createCustomCard(const QString &title) {
     QLabel *vLabel = new QLabel("￥0.00");
     vLabel->setObjectName("amountLabel");
     vLabel->setStyleSheet("font-size: 18px; font-weight: bold; background-color: transparent;");
+    QLabel *dLabel = new QLabel();
+    dLabel->setObjectName("deltaLabel");
+    dLabel->setStyleSheet("font-size: 11px; color: #666; background-color: transparent;");
 
     layout->addWidget(tLabel);
     layout->addWidget(vLabel);
+    layout->addWidget(dLabel);
     layout->addStretch();
     return card;
 }
@@ -355,81 +361,111 @@ void YearViewWidget::loadYearData()
             return;
         }
     }
-    QSqlQuery query;
 
-    // 后端返回的 JSON
-    QJsonObject mockResponse;
-    mockResponse["year"] = currentYear;
+    int year = currentYear;
+    QString transactionType = currentTransactionType;
+
+    // 查询在数据库线程执行，先显示占位；结果回来时如果已经切到别的年份或类型就丢弃
+    int generation = ++loadGeneration;
+    showLoadingState();
+    QElapsedTimer timer;
+    timer.start();
+    DbExecutor::instance().run<QJsonObject>(
+        [year, transactionType]() {
+            return fetchYearData(year, transactionType);
+        },
+        this,
+        [this, generation, timer](const QJsonObject &response) {
+            if (generation != loadGeneration)
+                return;
+            DbExecutor::instance().recordLoadTime("year", timer.elapsed());
+            updateYearData(response);
+        });
+}
+
+// 在数据库线程上执行，只使用参数，不访问界面
+QJsonObject YearViewWidget::fetchYearData(int year, const QString &transactionType)
+{
+    DbExecutor &executor = DbExecutor::instance();
+    PeriodKey period = PeriodKey::ofYear(year);
     QString type;
-    if(currentTransactionType == "支出"){
+    if(transactionType == "支出"){
         type = "expense";
     }
     else{
         type = "income";
     }
-    QString comment = db.getTopCategoryByYearWithComment(currentYear,type);
-    mockResponse["comment"] = comment;
+
+    QFuture<QString> commentFuture = executor.fork<QString>([year, type]() {
+        return DatabaseManager::instance().getTopCategoryByYearWithComment(year, type);
+    });
+    // 今年与去年一次查出，卡片总额和同比都取自这里
+    QFuture<PeriodComparison> comparisonFuture = executor.fork<PeriodComparison>([year]() {
+        return DatabaseManager::instance().comparePeriods(QDate(year, 1, 1), CompareYear);
+    });
+    QFuture<QVector<double> > monthsFuture = executor.fork<QVector<double> >([year, type]() {
+        return DatabaseManager::instance().getMonthlySeries(year, type);
+    });
+    QFuture<QVector<CategoryStat> > statsFuture = executor.fork<QVector<CategoryStat> >([period, type]() {
+        return DatabaseManager::instance().getCategoryStats(period, type);
+    });
+
+    // 后端返回的 JSON
+    QJsonObject mockResponse;
+    mockResponse["year"] = year;
+    mockResponse["comment"] = commentFuture.result();
 
     // 卡片总额
-    query=db.getTotalExpenseByYear(currentYear);
-    query.next();
-    double expense = query.value(0).toDouble();
+    PeriodComparison comparison = comparisonFuture.result();
+    double expense = comparison.expense[PeriodComparison::Current];
     mockResponse["yearlyExpenseTotal"] = expense;
-    query=db.getTotalIncomeByYear(currentYear);
-    query.next();
-    double income = query.value(0).toDouble();
+    double income = comparison.income[PeriodComparison::Current];
     mockResponse["yearlyIncomeTotal"] = income;
-
-    //  12 个月的数据
-    if(currentTransactionType == "支出"){
-        QJsonArray months;
-        for (int i = 0; i < 12; ++i) {
-            QJsonObject m;
-            query = db.getTotalExpenseByMonth(currentYear,i+1);
-            query.next();
-            m["total"] =query.value(0).toDouble();
-            months.append(m);
-        }
-        mockResponse["months"] = months;
-    }
-    else{
-        QJsonArray months;
-        for (int i = 0; i < 12; ++i) {
-            QJsonObject m;
-            query = db.getTotalIncomeByMonth(currentYear,i+1);
-            query.next();
-            m["total"] =query.value(0).toDouble();
-            months.append(m);
-        }
-        mockResponse["months"] = months;
+    mockResponse["previousExpenseTotal"] = comparison.expense[PeriodComparison::Previous];
+    mockResponse["previousIncomeTotal"] = comparison.income[PeriodComparison::Previous];
+
+    //  12 个月的数据，一次查询
+    QJsonArray months;
+    for (double total : monthsFuture.result()) {
+        QJsonObject m;
+        m["total"] = total;
+        months.append(m);
     }
+    mockResponse["months"] = months;
 
     // 饼图数据
+    QHash<QString, double> previousByName;
+    for (const PeriodComparison::Category &category : comparison.categories) {
+        if (category.income == (type == "income"))
+            previousByName.insert(category.name, category.amount[PeriodComparison::Previous]);
+    }
+
     QJsonArray pie;
     QJsonObject p1;
-    if (currentTransactionType == "支出") {
-        query = db.getExpenseCategoryStatsByYear(currentYear);
-        while(query.next()){
-            p1["category"] = query.value(0).toString();
-            p1["totalAmount"] = query.value(2).toDouble();
-            p1["ratio"] = query.value(2).toDouble()/expense;
-            p1["count"] = query.value(1).toInt();
-            pie.append(p1);
-        }
-    } else {
-        query = db.getIncomeCategoryStatsByYear(currentYear);
-        while(query.next()){
-            p1["category"] = query.value(0).toString();
-            p1["totalAmount"] = query.value(2).toDouble();
-            p1["ratio"] = query.value(2).toDouble()/income;
-            p1["count"] = query.value(1).toInt();
-            pie.append(p1);
-        }
+    double total = (type == "expense") ? expense : income;
+    for (const CategoryStat &stat : statsFuture.result()) {
+        p1["category"] = stat.name;
+        p1["totalAmount"] = stat.total;
+        p1["ratio"] = stat.total/total;
+        p1["count"] = stat.count;
+        p1["previousAmount"] = previousByName.value(stat.name, 0);
+        pie.append(p1);
     }
     mockResponse["pie"] = pie;
 
-    // 关键：必须调用更新函数
-    updateYearData(mockResponse);
+    return mockResponse;
+}
+
+// 查询进行中的占位：金额和评价先显示加载中，图表保留上一次的内容直到新数据到达
+void YearViewWidget::showLoadingState()
+{
+    QLabel *expVal = expenseCard->findChild<QLabel*>("amountLabel");
+    if (expVal) expVal->setText("…");
+
+    QLabel *incVal = incomeCard->findChild<QLabel*>("amountLabel");
+    if (incVal) incVal->setText("…");
+
+    commentLabel->setText("加载中…");
 }
 
 void YearViewWidget::updateYearData(const QJsonObject &json)
@@ -454,6 +490,18 @@ void YearViewWidget::updateYearData(const QJsonObject &json)
     QLabel *incVal = incomeCard->findChild<QLabel*>("amountLabel");
     if (incVal) incVal->setText(QString("￥%1").arg(totalInc, 0, 'f', 2));
 
+    // 同比：与去年全年相比
+    double previousExp = json["previousExpenseTotal"].toDouble();
+    double previousInc = json["previousIncomeTotal"].toDouble();
+    if (QLabel *expDelta = expenseCard->findChild<QLabel*>("deltaLabel")) {
+        expDelta->setText("较去年 " + PeriodComparison::changeText(totalExp, previousExp));
+        expDelta->setToolTip(QString("去年 ￥%1").arg(previousExp, 0, 'f', 2));
+    }
+    if (QLabel *incDelta = incomeCard->findChild<QLabel*>("deltaLabel")) {
+        incDelta->setText("较去年 " + PeriodComparison::changeText(totalInc, previousInc));
+        incDelta->setToolTip(QString("去年 ￥%1").arg(previousInc, 0, 'f', 2));
+    }
+
     // --- C. 更新饼图与排行榜 ---
     QJsonArray pieArray = json["pie"].toArray();
     if (pieChartView->chart()->series().count() > 0) {
@@ -473,11 +521,14 @@ void YearViewWidget::updateYearData(const QJsonObject &json)
             sliceDataMap[slice] = item; // 存入 Map 供 Hover 逻辑读取
 
             // 排行榜列表项
-            QString rankText = QString("%1. %2 (%3%) - ￥%4")
+            QString rankText = QString("%1. %2 (%3%) - ￥%4  %5")
                                 .arg(rank++).arg(category)
                                 .arg(ratio * 100, 0, 'f', 1)
-                                .arg(amount, 0, 'f', 2);
-            rankListWidget->addItem(new QListWidgetItem(rankText));
+                                .arg(amount, 0, 'f', 2)
+                                .arg(PeriodComparison::changeText(amount, item["previousAmount"].toDouble()));
+            QListWidgetItem *rankItem = new QListWidgetItem(rankText);
+            rankItem->setToolTip(QString("去年 ￥%1").arg(item["previousAmount"].toDouble(), 0, 'f', 2));
+            rankListWidget->addItem(rankItem);
         }
     }
 
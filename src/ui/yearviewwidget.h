@@ -60,12 +60,15 @@ QT_CHARTS_USE_NAMESPACE
  *   ],
  *   "annuallyIncomeTotal": 90000.00,
  *   "annuallyExpenseTotal": 75000.00,
+ *   "previousExpenseTotal": 70000.00,   // 去年全年，用于同比
+ *   "previousIncomeTotal": 85000.00,
  *   "pie": [
  *     {
  *       "category": "日用百货",
  *       "totalAmount": 10000.00,
  *       "ratio": 0.13,
- *       "count": 30
+ *       "count": 30,
+ *       "previousAmount": 9000.00    // 去年该分类金额
  *     }
  *     // ... 分类数据
  *   ],
@@ -144,6 +147,16 @@ private:
      */
     void loadYearData();
 
+    /**
+     * @brief 查询某年数据并组装成 API 响应格式
+     *
+     * 在数据库线程上执行，只使用参数，不访问界面组件
+     */
+    static QJsonObject fetchYearData(int year, const QString &transactionType);
+
+    // 查询进行中时显示占位
+    void showLoadingState();
+
     /**
      * @brief 更新年度数据到UI组件
      * @param json QJsonObject，符合 API 响应格式
@@ -183,6 +196,7 @@ private:
 
     QString currentTransactionType;
     int currentYear;
+    int loadGeneration = 0;  // 每次发起查询加一，用于丢弃过期的结果
 };
 
 #endif // YEARVIEWWIDGET_H
@@ -0,0 +1,160 @@
+#include <QtTest>
+#include <QTemporaryDir>
+#include <QTextStream>
+#include <QFile>
+#include <QDir>
+#include "../src/db/database_manager.h"
+
+// 按年分区存储的往返测试：单库建数据 -> 迁移 -> 增删改、跨年移动、导入查重、只读分区
+class PartitionTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void convertKeepsRecords();
+    void addCreatesPartition();
+    void updateMovesAcrossYears();
+    void deleteRemovesRecord();
+    void importSkipsExistingOrders();
+    void readOnlyPartitionRejectsWrites();
+
+private:
+    static BillRecord recordOnDay(const QString &day);
+    void writeCsv(const QString &path, const QStringList &rows);
+
+    QTemporaryDir dir;
+};
+
+// 餐饮美食的分类 id 为 1，交易方式 2 为支付宝（保留交易单号）
+static const int FOOD = 1;
+static const int ALIPAY = 2;
+
+void PartitionTest::initTestCase()
+{
+    QVERIFY(dir.isValid());
+    // openDatabase 在当前目录下打开 app.db，分区文件与它放在同一目录
+    QVERIFY(QDir::setCurrent(dir.path()));
+
+    DatabaseManager &db = DatabaseManager::instance();
+    QVERIFY(db.openDatabase());
+    QVERIFY(db.createTables());
+    db.insertDefaultTables();
+    QVERIFY(!db.isPartitioned());
+
+    db.addRecord(10.0, "expense", "2023-03-01 12:00:00", FOOD, ALIPAY, "食堂", "午餐", "1001");
+    db.addRecord(20.0, "expense", "2023-12-31 18:00:00", FOOD, ALIPAY, "食堂", "晚餐", "1002");
+    db.addRecord(30.0, "expense", "2024-01-02 08:00:00", FOOD, ALIPAY, "早餐店", "早餐", "1003");
+    QCOMPARE(db.getTotalExpenseByYear(2023), 30.0);
+    QCOMPARE(db.getTotalExpenseByYear(2024), 30.0);
+}
+
+void PartitionTest::convertKeepsRecords()
+{
+    DatabaseManager &db = DatabaseManager::instance();
+    QVERIFY(db.convertToPartitionedLayout());
+    QVERIFY(db.isPartitioned());
+    QCOMPARE(db.partitionYearList(), QList<int>({ 2023, 2024 }));
+    QVERIFY(QFile::exists(dir.filePath("app_2023.db")));
+    QVERIFY(QFile::exists(dir.filePath("app_2024.db")));
+
+    QCOMPARE(db.getTotalExpenseByYear(2023), 30.0);
+    QCOMPARE(db.getTotalExpenseByYear(2024), 30.0);
+    QVERIFY(db.getBillIdByTransactionNumber("1001") > 0);
+}
+
+void PartitionTest::addCreatesPartition()
+{
+    DatabaseManager &db = DatabaseManager::instance();
+    db.addRecord(40.0, "expense", "2025-05-05 09:00:00", FOOD, ALIPAY, "食堂", "午餐", "1004");
+    QVERIFY(QFile::exists(dir.filePath("app_2025.db")));
+    QCOMPARE(db.getTotalExpenseByYear(2025), 40.0);
+
+    // 迁移后分配的 id 接着单库中的最大 id，不与已有记录冲突
+    int id = db.getBillIdByTransactionNumber("1004");
+    QVERIFY(id > db.getBillIdByTransactionNumber("1003"));
+}
+
+void PartitionTest::updateMovesAcrossYears()
+{
+    DatabaseManager &db = DatabaseManager::instance();
+    int id = db.getBillIdByTransactionNumber("1002");
+    QVERIFY(id > 0);
+
+    db.updateRecord(id, 25.0, "expense", "2024-01-03 19:00:00", FOOD, ALIPAY, "食堂", "晚餐", "1002", "");
+    QCOMPARE(db.getTotalExpenseByYear(2023), 10.0);
+    QCOMPARE(db.getTotalExpenseByYear(2024), 55.0);
+    QCOMPARE(db.getBillIdByTransactionNumber("1002"), id);
+
+    BillRecord moved = recordOnDay("2024-01-03");
+    QCOMPARE(moved.id, id);
+    QCOMPARE(moved.year, 2024);
+    QCOMPARE(moved.month, 1);
+    QCOMPARE(moved.amount, 25.0);
+    QCOMPARE(recordOnDay("2023-12-31").id, 0);
+}
+
+void PartitionTest::deleteRemovesRecord()
+{
+    DatabaseManager &db = DatabaseManager::instance();
+    int id = db.getBillIdByTransactionNumber("1004");
+    db.deleteRecord(id);
+    QCOMPARE(db.getTotalExpenseByYear(2025), 0.0);
+    QCOMPARE(db.getBillIdByTransactionNumber("1004"), -1);
+}
+
+void PartitionTest::importSkipsExistingOrders()
+{
+    DatabaseManager &db = DatabaseManager::instance();
+    QString path = dir.filePath("alipay.csv");
+    writeCsv(path, {
+        // 1001 已在 2023 分区中，导入时跳过；2001 是新的交易，落在新的 2022 分区
+        "2023-03-01 12:00:00,餐饮美食,食堂,x,午餐,支出,10.00,余额宝,交易成功,1001,,",
+        "2022-06-01 12:00:00,餐饮美食,面馆,x,午餐,支出,15.00,余额宝,交易成功,2001,,",
+    });
+
+    QVERIFY(db.importAlipayCsv(path));
+    QCOMPARE(db.getTotalExpenseByYear(2023), 10.0);
+    QCOMPARE(db.getTotalExpenseByYear(2022), 15.0);
+    QVERIFY(db.partitionYearList().contains(2022));
+
+    // 再导入一次不产生重复记录
+    QVERIFY(db.importAlipayCsv(path));
+    QCOMPARE(db.getTotalExpenseByYear(2022), 15.0);
+    QCOMPARE(db.getTotalExpenseByYear(2023), 10.0);
+}
+
+void PartitionTest::readOnlyPartitionRejectsWrites()
+{
+    DatabaseManager &db = DatabaseManager::instance();
+    QVERIFY(db.setPartitionMode(2022, DatabaseManager::PartitionReadOnly));
+    QCOMPARE(db.partitionMode(2022), DatabaseManager::PartitionReadOnly);
+
+    db.addRecord(99.0, "expense", "2022-07-01 12:00:00", FOOD, ALIPAY, "面馆", "午餐", "2002");
+    QCOMPARE(db.getTotalExpenseByYear(2022), 15.0);
+
+    QVERIFY(db.setPartitionMode(2022, DatabaseManager::PartitionReadWrite));
+    db.addRecord(99.0, "expense", "2022-07-01 12:00:00", FOOD, ALIPAY, "面馆", "午餐", "2002");
+    QCOMPARE(db.getTotalExpenseByYear(2022), 114.0);
+}
+
+BillRecord PartitionTest::recordOnDay(const QString &day)
+{
+    QVector<BillRecord> records = DatabaseManager::instance().getRecordsByDay(day);
+    return records.isEmpty() ? BillRecord() : records.first();
+}
+
+// 支付宝导出的 CSV 为 GBK 编码，数据行前有一行以“交易时间”开头的表头
+void PartitionTest::writeCsv(const QString &path, const QStringList &rows)
+{
+    QFile file(path);
+    QVERIFY(file.open(QIODevice::WriteOnly | QIODevice::Truncate));
+    QTextStream out(&file);
+    out.setCodec("GBK");
+    out << "交易时间,交易分类,交易对方,对方账号,商品说明,收/支,金额,收/付款方式,交易状态,交易订单号,商家订单号,备注\n";
+    for (const QString &row : rows)
+        out << row << "\n";
+}
+
+QTEST_GUILESS_MAIN(PartitionTest)
+#include "partition_test.moc"